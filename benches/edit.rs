@@ -0,0 +1,242 @@
+//! Benchmarks for editing the frames of a `Bvh`, changing the layout of its motion
+//! values, and looking up its joints.
+
+#[path = "../tests/common/mod.rs"]
+mod common;
+
+use bvh_anim::{frames::FrameCursor, generate::GenerateOptions, Bvh};
+use criterion::{
+    black_box, criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput,
+};
+
+const NUM_FRAMES: usize = 10_000;
+const NUM_INSERTED: usize = 100;
+/// The number of joints in the rig used to benchmark name lookups.
+const NUM_RIG_JOINTS: usize = 300;
+
+/// Where in the clip to move the cursor to before editing.
+const POSITIONS: &[&str] = &["start", "middle", "end"];
+
+fn move_to(cursor: &mut FrameCursor<'_>, position: &str) {
+    match position {
+        "start" => {
+            cursor.move_first();
+        }
+        "middle" => {
+            cursor.move_first();
+            for _ in 0..cursor.len() / 2 {
+                cursor.move_next();
+            }
+        }
+        _ => {
+            cursor.move_last().move_prev();
+        }
+    }
+}
+
+/// Returns a clone of `bvh` which does not share its frames with `bvh`, so that
+/// edits are timed without the cost of copying the frames on first write.
+fn unshared_clone(bvh: &Bvh) -> Bvh {
+    let mut clone = bvh.clone();
+    clone
+        .set_channel_major_motion(&bvh.to_channel_major())
+        .unwrap();
+    clone
+}
+
+fn frame_cursor(c: &mut Criterion) {
+    let bvh = bvh_anim::from_bytes(common::with_num_frames(NUM_FRAMES)).unwrap();
+    let new_frames = vec![vec![0.0; bvh.num_channels()]; NUM_INSERTED];
+
+    let mut group = c.benchmark_group("try_insert_frames");
+    group.throughput(Throughput::Elements(NUM_INSERTED as u64));
+    for &position in POSITIONS {
+        group.bench_with_input(BenchmarkId::new(position, NUM_FRAMES), &bvh, |b, bvh| {
+            b.iter_batched_ref(
+                || unshared_clone(bvh),
+                |bvh: &mut Bvh| {
+                    let mut cursor = bvh.frame_cursor();
+                    move_to(&mut cursor, position);
+                    cursor.try_insert_frames(black_box(&new_frames)).unwrap();
+                },
+                BatchSize::LargeInput,
+            )
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("remove_frame");
+    group.throughput(Throughput::Elements(1));
+    for &position in POSITIONS {
+        group.bench_with_input(BenchmarkId::new(position, NUM_FRAMES), &bvh, |b, bvh| {
+            b.iter_batched_ref(
+                || unshared_clone(bvh),
+                |bvh: &mut Bvh| {
+                    let mut cursor = bvh.frame_cursor();
+                    move_to(&mut cursor, position);
+                    cursor.remove_frame().unwrap();
+                },
+                BatchSize::LargeInput,
+            )
+        });
+    }
+    group.finish();
+
+    // Trims frames one at a time in a single session, as an interactive editor would.
+    let mut group = c.benchmark_group("trim_frames");
+    group.throughput(Throughput::Elements(NUM_INSERTED as u64));
+    for &position in POSITIONS {
+        group.bench_with_input(BenchmarkId::new(position, NUM_FRAMES), &bvh, |b, bvh| {
+            b.iter_batched_ref(
+                || unshared_clone(bvh),
+                |bvh: &mut Bvh| {
+                    let mut cursor = bvh.frame_cursor();
+                    move_to(&mut cursor, position);
+                    cursor.move_prev();
+                    for _ in 0..NUM_INSERTED {
+                        cursor.remove_frame().unwrap();
+                        cursor.move_prev();
+                    }
+                },
+                BatchSize::LargeInput,
+            )
+        });
+        group.bench_with_input(
+            BenchmarkId::new(format!("{}/range", position), NUM_FRAMES),
+            &bvh,
+            |b, bvh| {
+                b.iter_batched_ref(
+                    || unshared_clone(bvh),
+                    |bvh: &mut Bvh| {
+                        let mut cursor = bvh.frame_cursor();
+                        move_to(&mut cursor, position);
+                        let start = cursor.index().saturating_sub(NUM_INSERTED - 1);
+                        cursor.remove_frames(start..start + NUM_INSERTED).unwrap();
+                    },
+                    BatchSize::LargeInput,
+                )
+            },
+        );
+    }
+    group.finish();
+}
+
+/// Takes a snapshot of a clip and edits one frame of it, as an editor keeping
+/// an undo history would.
+fn snapshot(c: &mut Criterion) {
+    let bvh = bvh_anim::from_bytes(common::with_num_frames(NUM_FRAMES)).unwrap();
+
+    let mut group = c.benchmark_group("snapshot");
+    group.throughput(Throughput::Elements(1));
+    group.bench_function(BenchmarkId::new("clone", NUM_FRAMES), |b| {
+        b.iter(|| black_box(&bvh).clone())
+    });
+    group.bench_function(BenchmarkId::new("clone_and_edit_frame", NUM_FRAMES), |b| {
+        b.iter(|| {
+            let mut snapshot = black_box(&bvh).clone();
+            for value in snapshot
+                .frames_mut()
+                .nth(NUM_FRAMES / 2)
+                .unwrap()
+                .as_mut_slice()
+            {
+                *value += 1.0;
+            }
+            snapshot
+        })
+    });
+    group.finish();
+}
+
+fn channel_major(c: &mut Criterion) {
+    let bvh = bvh_anim::from_bytes(common::with_num_frames(NUM_FRAMES)).unwrap();
+    let motion = bvh.to_channel_major();
+    let num_values = (NUM_FRAMES * bvh.num_channels()) as u64;
+
+    let mut group = c.benchmark_group("channel_major");
+    group.throughput(Throughput::Elements(num_values));
+    group.bench_function("to_channel_major", |b| b.iter(|| bvh.to_channel_major()));
+    group.bench_function("to_frame_major", |b| b.iter(|| motion.to_frame_major()));
+    group.finish();
+
+    // Sums each channel, which is typical of passes such as filtering one curve.
+    let mut group = c.benchmark_group("sum_each_channel");
+    group.throughput(Throughput::Elements(num_values));
+    group.bench_function("frame_major", |b| {
+        b.iter(|| {
+            (0..bvh.num_channels())
+                .map(|channel| bvh.frames().map(|frame| frame[channel]).sum::<f32>())
+                .collect::<Vec<_>>()
+        })
+    });
+    group.bench_function("channel_major", |b| {
+        b.iter(|| {
+            motion
+                .tracks()
+                .map(|track| track.iter().sum::<f32>())
+                .collect::<Vec<_>>()
+        })
+    });
+    group.finish();
+
+    // Sums each frame, which is typical of per-frame kernels such as skinning.
+    let aligned = bvh.to_aligned_motion();
+    let mut group = c.benchmark_group("sum_each_frame");
+    group.throughput(Throughput::Elements(num_values));
+    group.bench_function("frames", |b| {
+        b.iter(|| {
+            bvh.frames()
+                .map(|frame| frame.as_slice().iter().sum::<f32>())
+                .collect::<Vec<_>>()
+        })
+    });
+    group.bench_function("aligned_padded_frames", |b| {
+        b.iter(|| {
+            aligned
+                .padded_frames()
+                .map(|frame| frame.iter().sum::<f32>())
+                .collect::<Vec<_>>()
+        })
+    });
+    group.finish();
+}
+
+fn find_by_name(c: &mut Criterion) {
+    let rig = GenerateOptions::new()
+        .with_num_joints(NUM_RIG_JOINTS)
+        .generate_skeleton();
+    let names: Vec<Vec<u8>> = rig.joints().map(|j| j.name().to_vec()).collect();
+
+    let lookups = [
+        ("first", &names[0][..]),
+        ("middle", &names[names.len() / 2][..]),
+        ("last", &names[names.len() - 1][..]),
+        ("missing", &b"NotAJoint"[..]),
+    ];
+
+    // `find_by_name` on `Bvh::joints` uses the cached name index, while the
+    // scan compares every name in turn.
+    let mut group = c.benchmark_group("find_by_name");
+    group.throughput(Throughput::Elements(1));
+    for &(name, joint_name) in &lookups {
+        group.bench_with_input(
+            BenchmarkId::new("index", name),
+            joint_name,
+            |b, joint_name| b.iter(|| rig.joints().find_by_name(black_box(joint_name))),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("scan", name),
+            joint_name,
+            |b, joint_name| {
+                b.iter(|| {
+                    rig.joints()
+                        .find(|joint| joint.name() == black_box(joint_name))
+                })
+            },
+        );
+    }
+    group.finish();
+}
+
+criterion_group!(benches, frame_cursor, snapshot, channel_major, find_by_name);
+criterion_main!(benches);
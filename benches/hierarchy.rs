@@ -0,0 +1,58 @@
+//! Benchmarks for parsing the `HIERARCHY` section of large skeletons.
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use std::fmt::Write;
+
+const NUM_JOINTS: usize = 10_000;
+
+/// Writes a `bvh` file with no frames, where the root joint has `num_chains`
+/// children, each of which is the start of a chain of `chain_len` joints.
+fn synthetic_hierarchy(num_chains: usize, chain_len: usize) -> String {
+    let mut out = String::from("HIERARCHY\nROOT Root\n{\n");
+    out.push_str("\tOFFSET 0.0 0.0 0.0\n");
+    out.push_str("\tCHANNELS 6 Xposition Yposition Zposition Zrotation Xrotation Yrotation\n");
+
+    for chain in 0..num_chains {
+        for link in 0..chain_len {
+            let indent = "\t".repeat(link + 1);
+            writeln!(out, "{}JOINT Joint_{}_{}", indent, chain, link).unwrap();
+            writeln!(out, "{}{{", indent).unwrap();
+            writeln!(out, "{}\tOFFSET 0.0 1.0 0.0", indent).unwrap();
+            writeln!(out, "{}\tCHANNELS 3 Zrotation Xrotation Yrotation", indent).unwrap();
+        }
+
+        let indent = "\t".repeat(chain_len + 1);
+        writeln!(out, "{}End Site", indent).unwrap();
+        writeln!(out, "{}{{", indent).unwrap();
+        writeln!(out, "{}\tOFFSET 0.0 1.0 0.0", indent).unwrap();
+        writeln!(out, "{}}}", indent).unwrap();
+
+        for link in (0..chain_len).rev() {
+            writeln!(out, "{}}}", "\t".repeat(link + 1)).unwrap();
+        }
+    }
+
+    out.push_str("}\nMOTION\nFrames: 0\nFrame Time: 0.033333\n");
+    out
+}
+
+fn parse_hierarchy(c: &mut Criterion) {
+    let mut group = c.benchmark_group("parse_hierarchy");
+
+    // A very wide skeleton, where every joint shares the same parent, and a
+    // bushier one, closer to a real rig.
+    let shapes = [("wide", NUM_JOINTS, 1), ("bushy", 100, NUM_JOINTS / 100)];
+
+    for &(name, num_chains, chain_len) in &shapes {
+        let bvh = synthetic_hierarchy(num_chains, chain_len);
+        group.throughput(Throughput::Elements(NUM_JOINTS as u64));
+        group.bench_with_input(BenchmarkId::new(name, NUM_JOINTS), &bvh, |b, bvh| {
+            b.iter(|| bvh_anim::from_bytes(black_box(bvh.as_bytes())).unwrap())
+        });
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, parse_hierarchy);
+criterion_main!(benches);
@@ -0,0 +1,39 @@
+//! Benchmarks for loading whole `bvh` files.
+
+#[path = "../tests/common/mod.rs"]
+mod common;
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+
+fn from_bytes(c: &mut Criterion) {
+    let mut group = c.benchmark_group("from_bytes");
+
+    group.throughput(Throughput::Bytes(common::BVH_BYTES.len() as u64));
+    group.bench_function("test_mocapbank", |b| {
+        b.iter(|| bvh_anim::from_bytes(black_box(common::BVH_BYTES)).unwrap())
+    });
+
+    for &num_frames in &[1_000, 100_000, 1_000_000] {
+        let bytes = common::with_num_frames(num_frames);
+        if num_frames >= 100_000 {
+            group.sample_size(10);
+        }
+
+        group.throughput(Throughput::Bytes(bytes.len() as u64));
+        group.bench_with_input(BenchmarkId::new("bytes", num_frames), &bytes, |b, bytes| {
+            b.iter(|| bvh_anim::from_bytes(black_box(&bytes[..])).unwrap())
+        });
+
+        group.throughput(Throughput::Elements(num_frames as u64));
+        group.bench_with_input(
+            BenchmarkId::new("frames", num_frames),
+            &bytes,
+            |b, bytes| b.iter(|| bvh_anim::from_bytes(black_box(&bytes[..])).unwrap()),
+        );
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, from_bytes);
+criterion_main!(benches);
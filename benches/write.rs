@@ -0,0 +1,47 @@
+//! Benchmarks for writing `bvh` files.
+
+#[path = "../tests/common/mod.rs"]
+mod common;
+
+use bvh_anim::write::WriteOptions;
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+
+fn write(c: &mut Criterion) {
+    let mut group = c.benchmark_group("write");
+
+    let options = [
+        ("default", WriteOptions::new()),
+        (
+            "significant_figures",
+            WriteOptions::new()
+                .with_offset_significant_figures(5)
+                .with_frame_time_significant_figures(5)
+                .with_motion_values_significant_figures(5),
+        ),
+    ];
+
+    for &num_frames in &[455, 100_000] {
+        let bvh = bvh_anim::from_bytes(common::with_num_frames(num_frames)).unwrap();
+        if num_frames >= 100_000 {
+            group.sample_size(10);
+        }
+
+        for &(name, ref options) in &options {
+            let mut out = Vec::new();
+            options.write(&bvh, &mut out).unwrap();
+
+            group.throughput(Throughput::Bytes(out.len() as u64));
+            group.bench_with_input(BenchmarkId::new(name, num_frames), &bvh, |b, bvh| {
+                b.iter(|| {
+                    out.clear();
+                    options.write(black_box(bvh), &mut out).unwrap();
+                })
+            });
+        }
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, write);
+criterion_main!(benches);
@@ -0,0 +1,110 @@
+//! Writes a synthetic `bvh` file, for testing the library at scale.
+//!
+//! ```text
+//! cargo run --release --example bvh_generate -- --frames 1000000 --output big.bvh
+//! ```
+//!
+//! Frames are generated and written one at a time, so files of any size can be
+//! produced without holding them in memory. Run with `--help` to see all of the
+//! options.
+
+use bvh_anim::{
+    generate::{GenerateOptions, ValueDistribution},
+    write::WriteOptions,
+};
+use std::{
+    env,
+    error::Error,
+    fs::File,
+    io::{self, BufWriter, Write},
+    process,
+};
+
+const USAGE: &str = "\
+Usage: bvh_generate [OPTIONS]
+
+Options:
+    --seed <N>            Seed of the random number generator [default: 0]
+    --joints <N>          Number of joints, including the root [default: 20]
+    --depth <N>           Greatest depth of any joint [default: 8]
+    --children <N>        Greatest number of children of any joint [default: 3]
+    --frames <N>          Number of frames [default: 100]
+    --values <DIST>       One of `uniform`, `normal`, `sine` or `constant` [default: uniform]
+    --significant-figures <N>
+                          Significant figures of the motion values
+    --output <PATH>       File to write to [default: stdout]
+    --help                Print this message
+";
+
+fn main() {
+    if let Err(e) = run() {
+        eprintln!("error: {}\n\n{}", e, USAGE);
+        process::exit(1);
+    }
+}
+
+fn run() -> Result<(), Box<dyn Error>> {
+    let mut options = GenerateOptions::new();
+    let mut write_options = WriteOptions::new();
+    let mut output = None;
+
+    let mut args = env::args().skip(1);
+    while let Some(arg) = args.next() {
+        if arg == "--help" {
+            print!("{}", USAGE);
+            return Ok(());
+        }
+
+        let value = args
+            .next()
+            .ok_or_else(|| format!("missing value for `{}`", arg))?;
+        match &arg[..] {
+            "--seed" => options.seed = value.parse()?,
+            "--joints" => options.num_joints = value.parse()?,
+            "--depth" => options.max_depth = value.parse()?,
+            "--children" => options.max_children = value.parse()?,
+            "--frames" => options.num_frames = value.parse()?,
+            "--values" => options.motion_values = parse_distribution(&value)?,
+            "--significant-figures" => {
+                write_options.motion_values_significant_figures = Some(value.parse()?)
+            }
+            "--output" => output = Some(value),
+            _ => return Err(format!("unknown option `{}`", arg).into()),
+        }
+    }
+
+    match output {
+        Some(path) => {
+            let mut file = BufWriter::new(File::create(path)?);
+            options.write(&write_options, &mut file)?;
+        }
+        None => {
+            let stdout = io::stdout();
+            let mut stdout = BufWriter::new(stdout.lock());
+            options.write(&write_options, &mut stdout)?;
+            stdout.flush()?;
+        }
+    }
+
+    Ok(())
+}
+
+fn parse_distribution(name: &str) -> Result<ValueDistribution, Box<dyn Error>> {
+    let distribution = match name {
+        "uniform" => ValueDistribution::Uniform {
+            min: -180.0,
+            max: 180.0,
+        },
+        "normal" => ValueDistribution::Normal {
+            mean: 0.0,
+            std_dev: 45.0,
+        },
+        "sine" => ValueDistribution::Sine {
+            amplitude: 90.0,
+            period: 120.0,
+        },
+        "constant" => ValueDistribution::Constant(0.0),
+        _ => return Err(format!("unknown value distribution `{}`", name).into()),
+    };
+    Ok(distribution)
+}
@@ -4,4 +4,7 @@ extern crate bvh_anim;
 
 fuzz_target!(|data: &[u8]| {
     let _ = bvh_anim::from_bytes(data);
+    let _ = bvh_anim::parse::ParseOptions::new()
+        .with_max_motion_bytes(1 << 20)
+        .parse_bytes(data);
 });
@@ -0,0 +1,446 @@
+//! Cache-line aligned storage for the motion values of a `Bvh`.
+
+use crate::frame_iter::{Frame, FrameMut};
+use std::{
+    fmt,
+    iter::{DoubleEndedIterator, ExactSizeIterator, FusedIterator, Iterator},
+    mem,
+    slice::{ChunksExact, ChunksExactMut},
+};
+
+/// The number of `f32`s in each aligned block.
+const LANES: usize = AlignedMotion::ALIGN / mem::size_of::<f32>();
+
+/// The motion values of a `Bvh`, with each frame starting on a cache line.
+///
+/// In the motion values of a [`Bvh`][`Bvh`], each frame starts straight after
+/// the last one, so unless the number of channels happens to be a multiple of
+/// the SIMD width, most frames start at an unaligned address. An `AlignedMotion`
+/// rounds the stride of each frame up to a multiple of [`ALIGN`][`ALIGN`] bytes,
+/// and starts the first frame on an `ALIGN` byte boundary, so that every frame
+/// is aligned for any SIMD width up to `ALIGN` bytes. The padding at the end of
+/// each frame is zeroed, so per-frame kernels may load whole blocks without
+/// handling the tail of the frame separately.
+///
+/// [`frames`][`AlignedMotion::frames`] yields the same [`Frame`][`Frame`]s as
+/// [`Bvh::frames`][`Bvh::frames`], which only contain the real channels, while
+/// [`padded_frames`][`AlignedMotion::padded_frames`] yields each frame with its
+/// padding.
+///
+/// # Examples
+///
+/// ```
+/// # use bvh_anim::frames::AlignedMotion;
+/// # let bvh = bvh_anim::from_path("./data/test_mocapbank.bvh")?;
+/// let motion = bvh.to_aligned_motion();
+/// assert_eq!(motion.stride() % 16, 0);
+///
+/// for frame in motion.padded_frames() {
+///     assert_eq!(frame.as_ptr() as usize % AlignedMotion::ALIGN, 0);
+///     assert_eq!(frame.len(), motion.stride());
+/// }
+///
+/// assert!(motion.frames().eq(bvh.frames()));
+/// # Result::<(), bvh_anim::errors::LoadError>::Ok(())
+/// ```
+///
+/// [`Bvh`]: ../struct.Bvh.html
+/// [`Bvh::frames`]: ../struct.Bvh.html#method.frames
+/// [`ALIGN`]: struct.AlignedMotion.html#associatedconstant.ALIGN
+/// [`AlignedMotion::frames`]: struct.AlignedMotion.html#method.frames
+/// [`AlignedMotion::padded_frames`]: struct.AlignedMotion.html#method.padded_frames
+/// [`Frame`]: struct.Frame.html
+#[derive(Default)]
+pub struct AlignedMotion {
+    /// The padded frames, starting at `offset`. The buffer has enough spare
+    /// capacity to move the start of the frames onto an `ALIGN` byte boundary
+    /// wherever the allocator places it.
+    buffer: Vec<f32>,
+    offset: usize,
+    num_channels: usize,
+    num_frames: usize,
+}
+
+impl AlignedMotion {
+    /// The alignment in bytes of the start and stride of each frame, which is
+    /// the size of a cache line, and the width of the widest SIMD registers.
+    pub const ALIGN: usize = 64;
+
+    /// Copies the frame-major `values`, which have `num_channels` values in
+    /// each frame, into a new `AlignedMotion`.
+    ///
+    /// Any values after the last complete frame are ignored.
+    pub fn from_frame_major(values: &[f32], num_channels: usize) -> Self {
+        let mut motion = AlignedMotion::default();
+        motion.copy_from_frame_major(values, num_channels);
+        motion
+    }
+
+    /// Replaces the contents of `self` with the frame-major `values`, reusing
+    /// the memory already allocated by `self`.
+    ///
+    /// Any values after the last complete frame are ignored.
+    pub fn copy_from_frame_major(&mut self, values: &[f32], num_channels: usize) {
+        let num_frames = if num_channels == 0 {
+            0
+        } else {
+            values.len() / num_channels
+        };
+        let stride = padded_stride(num_channels);
+
+        // The buffer is zeroed and then filled, so the spare space before the
+        // first frame and the padding after each frame are always zero.
+        self.buffer.clear();
+        self.buffer.resize(num_frames * stride + LANES - 1, 0.0);
+        self.offset = align_offset(&self.buffer);
+        self.num_channels = num_channels;
+        self.num_frames = num_frames;
+
+        if num_frames != 0 {
+            for (padded, frame) in self
+                .padded_frames_mut()
+                .zip(values.chunks_exact(num_channels))
+            {
+                padded[..num_channels].copy_from_slice(frame);
+            }
+        }
+    }
+
+    /// Copies the real channels of each frame into `out`, which is cleared
+    /// first, in the frame-major layout of the motion values of a `Bvh`.
+    pub fn to_frame_major_into(&self, out: &mut Vec<f32>) {
+        out.clear();
+        out.reserve(self.num_frames * self.num_channels);
+        for frame in self.frames() {
+            out.extend_from_slice(frame.as_slice());
+        }
+    }
+
+    /// Copies the real channels of each frame into a new `Vec`, in the
+    /// frame-major layout of the motion values of a `Bvh`.
+    #[inline]
+    pub fn to_frame_major(&self) -> Vec<f32> {
+        let mut out = Vec::new();
+        self.to_frame_major_into(&mut out);
+        out
+    }
+
+    /// Returns the number of real channels in each frame.
+    #[inline]
+    pub const fn num_channels(&self) -> usize {
+        self.num_channels
+    }
+
+    /// Returns the number of frames.
+    #[inline]
+    pub const fn num_frames(&self) -> usize {
+        self.num_frames
+    }
+
+    /// Returns the distance between the start of each frame, in `f32`s.
+    ///
+    /// This is `num_channels` rounded up to a multiple of `ALIGN / 4`.
+    #[inline]
+    pub fn stride(&self) -> usize {
+        padded_stride(self.num_channels)
+    }
+
+    /// Returns every padded frame, one after the other. The slice starts on an
+    /// `ALIGN` byte boundary.
+    #[inline]
+    pub fn as_padded_slice(&self) -> &[f32] {
+        let len = self.num_frames * self.stride();
+        &self.buffer[self.offset..self.offset + len]
+    }
+
+    /// Returns every padded frame mutably, one after the other. The slice starts
+    /// on an `ALIGN` byte boundary.
+    ///
+    /// Any values written to the padding are ignored by every other method, but
+    /// are not reset, so kernels which rely on the padding being zero must not
+    /// write to it.
+    #[inline]
+    pub fn as_padded_mut_slice(&mut self) -> &mut [f32] {
+        let len = self.num_frames * self.stride();
+        &mut self.buffer[self.offset..self.offset + len]
+    }
+
+    /// Returns an iterator over the real channels of each frame.
+    #[inline]
+    pub fn frames(&self) -> AlignedFrames<'_> {
+        AlignedFrames {
+            chunks: self.padded_chunks(),
+            num_channels: self.num_channels,
+        }
+    }
+
+    /// Returns a mutable iterator over the real channels of each frame.
+    #[inline]
+    pub fn frames_mut(&mut self) -> AlignedFramesMut<'_> {
+        let num_channels = self.num_channels;
+        AlignedFramesMut {
+            chunks: self.padded_chunks_mut(),
+            num_channels,
+        }
+    }
+
+    /// Returns an iterator over each frame, including its padding. Each frame
+    /// is `stride` values long, and starts on an `ALIGN` byte boundary.
+    #[inline]
+    pub fn padded_frames(&self) -> ChunksExact<'_, f32> {
+        // `stride` is never 0, so this never panics.
+        self.as_padded_slice().chunks_exact(self.stride())
+    }
+
+    /// Returns a mutable iterator over each frame, including its padding.
+    #[inline]
+    pub fn padded_frames_mut(&mut self) -> ChunksExactMut<'_, f32> {
+        let stride = self.stride();
+        self.as_padded_mut_slice().chunks_exact_mut(stride)
+    }
+
+    #[inline]
+    fn padded_chunks(&self) -> Option<ChunksExact<'_, f32>> {
+        if self.num_channels == 0 {
+            None
+        } else {
+            Some(self.padded_frames())
+        }
+    }
+
+    #[inline]
+    fn padded_chunks_mut(&mut self) -> Option<ChunksExactMut<'_, f32>> {
+        if self.num_channels == 0 {
+            None
+        } else {
+            Some(self.padded_frames_mut())
+        }
+    }
+}
+
+impl Clone for AlignedMotion {
+    #[inline]
+    fn clone(&self) -> Self {
+        // The new buffer may be allocated at a different alignment, so the
+        // frames are copied in again rather than copying the buffer.
+        AlignedMotion::from_frame_major(&self.to_frame_major(), self.num_channels)
+    }
+}
+
+impl PartialEq for AlignedMotion {
+    #[inline]
+    fn eq(&self, other: &Self) -> bool {
+        self.num_channels == other.num_channels
+            && self.num_frames == other.num_frames
+            && self.frames().eq(other.frames())
+    }
+}
+
+impl fmt::Debug for AlignedMotion {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("AlignedMotion")
+            .field("num_channels", &self.num_channels)
+            .field("num_frames", &self.num_frames)
+            .field("stride", &self.stride())
+            .finish()
+    }
+}
+
+/// An iterator over the frames of an [`AlignedMotion`][`AlignedMotion`].
+///
+/// This type is created using the [`AlignedMotion::frames`] method.
+///
+/// [`AlignedMotion`]: struct.AlignedMotion.html
+/// [`AlignedMotion::frames`]: struct.AlignedMotion.html#method.frames
+#[derive(Debug)]
+pub struct AlignedFrames<'a> {
+    /// Note: `chunks` is wrapped in an option for the same reason that
+    /// `Frames<'_>`'s `chunks` is wrapped.
+    chunks: Option<ChunksExact<'a, f32>>,
+    num_channels: usize,
+}
+
+impl<'a> Iterator for AlignedFrames<'a> {
+    type Item = Frame<'a>;
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        let num_channels = self.num_channels;
+        self.chunks
+            .as_mut()
+            .and_then(|c| c.next().map(|f| Frame(&f[..num_channels])))
+    }
+
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.chunks
+            .as_ref()
+            .map(|c| c.size_hint())
+            .unwrap_or((0, Some(0)))
+    }
+}
+
+impl<'a> DoubleEndedIterator for AlignedFrames<'a> {
+    #[inline]
+    fn next_back(&mut self) -> Option<Self::Item> {
+        let num_channels = self.num_channels;
+        self.chunks
+            .as_mut()
+            .and_then(|c| c.next_back().map(|f| Frame(&f[..num_channels])))
+    }
+}
+
+impl<'a> ExactSizeIterator for AlignedFrames<'a> {
+    #[inline]
+    fn len(&self) -> usize {
+        self.chunks.as_ref().map(|c| c.len()).unwrap_or(0)
+    }
+}
+
+impl<'a> FusedIterator for AlignedFrames<'a> {}
+
+/// A mutable iterator over the frames of an [`AlignedMotion`][`AlignedMotion`].
+///
+/// This type is created using the [`AlignedMotion::frames_mut`] method.
+///
+/// [`AlignedMotion`]: struct.AlignedMotion.html
+/// [`AlignedMotion::frames_mut`]: struct.AlignedMotion.html#method.frames_mut
+#[derive(Debug)]
+pub struct AlignedFramesMut<'a> {
+    chunks: Option<ChunksExactMut<'a, f32>>,
+    num_channels: usize,
+}
+
+impl<'a> Iterator for AlignedFramesMut<'a> {
+    type Item = FrameMut<'a>;
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        let num_channels = self.num_channels;
+        self.chunks
+            .as_mut()
+            .and_then(|c| c.next().map(|f| FrameMut(&mut f[..num_channels])))
+    }
+
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.chunks
+            .as_ref()
+            .map(|c| c.size_hint())
+            .unwrap_or((0, Some(0)))
+    }
+}
+
+impl<'a> DoubleEndedIterator for AlignedFramesMut<'a> {
+    #[inline]
+    fn next_back(&mut self) -> Option<Self::Item> {
+        let num_channels = self.num_channels;
+        self.chunks
+            .as_mut()
+            .and_then(|c| c.next_back().map(|f| FrameMut(&mut f[..num_channels])))
+    }
+}
+
+impl<'a> ExactSizeIterator for AlignedFramesMut<'a> {
+    #[inline]
+    fn len(&self) -> usize {
+        self.chunks.as_ref().map(|c| c.len()).unwrap_or(0)
+    }
+}
+
+impl<'a> FusedIterator for AlignedFramesMut<'a> {}
+
+/// Rounds `num_channels` up to a whole number of aligned blocks. Frames
+/// always take up at least one block, so that the stride is never `0`.
+#[inline]
+fn padded_stride(num_channels: usize) -> usize {
+    num_channels.max(1).saturating_add(LANES - 1) / LANES * LANES
+}
+
+/// Returns the index of the first value in `buffer` which is on an `ALIGN`
+/// byte boundary.
+#[inline]
+fn align_offset(buffer: &[f32]) -> usize {
+    let misalignment = buffer.as_ptr() as usize % AlignedMotion::ALIGN;
+    if misalignment == 0 {
+        0
+    } else {
+        (AlignedMotion::ALIGN - misalignment) / mem::size_of::<f32>()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn frames_are_aligned_and_padded() {
+        for &(num_frames, num_channels) in &[(0, 3), (0, 0), (5, 1), (7, 16), (9, 57), (3, 69)] {
+            let values = (0..num_frames * num_channels)
+                .map(|v| v as f32 + 1.0)
+                .collect::<Vec<_>>();
+
+            let motion = AlignedMotion::from_frame_major(&values, num_channels);
+            assert_eq!(motion.num_frames(), num_frames);
+            assert_eq!(motion.stride() % LANES, 0);
+            assert!(motion.stride() >= num_channels);
+            assert_eq!(
+                motion.as_padded_slice().as_ptr() as usize % AlignedMotion::ALIGN,
+                0
+            );
+
+            for padded in motion.padded_frames() {
+                assert_eq!(padded.as_ptr() as usize % AlignedMotion::ALIGN, 0);
+                assert!(padded[num_channels..].iter().all(|&v| v == 0.0));
+            }
+
+            assert_eq!(motion.to_frame_major(), values);
+            assert_eq!(motion.clone(), motion);
+        }
+    }
+
+    #[test]
+    fn padding_stays_zero_after_writing_frames() {
+        let values = (0..4 * 19).map(|v| v as f32).collect::<Vec<_>>();
+        let mut motion = AlignedMotion::from_frame_major(&values, 19);
+
+        for mut frame in motion.frames_mut() {
+            for value in frame.as_mut_slice() {
+                *value = -1.0;
+            }
+        }
+
+        for padded in motion.padded_frames() {
+            assert!(padded[..19].iter().all(|&v| v == -1.0));
+            assert!(padded[19..].iter().all(|&v| v == 0.0));
+        }
+    }
+
+    #[test]
+    fn copy_from_frame_major_reuses_the_buffer() {
+        let values = (0..8 * 21).map(|v| v as f32 + 1.0).collect::<Vec<_>>();
+        let mut motion = AlignedMotion::from_frame_major(&values, 21);
+        let buffer = motion.buffer.as_ptr();
+        let capacity = motion.buffer.capacity();
+
+        // Copy in fewer frames with fewer channels, then the same motion again,
+        // and check the padding left over from the wider frames is cleared.
+        for &(num_frames, num_channels) in &[(3, 5), (8, 21)] {
+            let values = &values[..num_frames * num_channels];
+            motion.copy_from_frame_major(values, num_channels);
+
+            assert_eq!(motion.buffer.as_ptr(), buffer);
+            assert_eq!(motion.buffer.capacity(), capacity);
+            assert_eq!(motion.num_frames(), num_frames);
+            assert_eq!(
+                motion.as_padded_slice().as_ptr() as usize % AlignedMotion::ALIGN,
+                0
+            );
+            for padded in motion.padded_frames() {
+                assert!(padded[num_channels..].iter().all(|&v| v == 0.0));
+            }
+            assert_eq!(motion.to_frame_major(), values);
+        }
+    }
+}
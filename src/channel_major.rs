@@ -0,0 +1,457 @@
+//! Channel-major storage for the motion values of a `Bvh`.
+
+use crate::frame_iter::FrameIndex;
+use std::{
+    iter::{DoubleEndedIterator, ExactSizeIterator, FusedIterator, Iterator},
+    mem,
+    ops::{Index, IndexMut},
+};
+
+/// The width and height of the tiles which are copied during a transpose.
+///
+/// A tile of `f32`s this size fits comfortably in the L1 cache, so that both
+/// the reads and the writes of each tile touch a small number of cache lines.
+const TILE_SIZE: usize = 16;
+
+/// The motion values of a `Bvh`, stored one channel after the other.
+///
+/// The motion values of a [`Bvh`][`Bvh`] are stored frame by frame, so the
+/// values of a single channel are spread out across the whole buffer. A
+/// `ChannelMajorMotion` stores all of the values of each channel together in
+/// a contiguous *track*, which makes passes over a single channel (such as
+/// filtering a curve, or computing its range) read memory sequentially.
+///
+/// A `ChannelMajorMotion` is created with [`Bvh::to_channel_major`]
+/// [`Bvh::to_channel_major`], and can be copied back into a `Bvh` with
+/// [`Bvh::set_channel_major_motion`][`Bvh::set_channel_major_motion`].
+///
+/// # Examples
+///
+/// ```
+/// # use bvh_anim::bvh;
+/// let bvh = bvh! {
+///     HIERARCHY
+///     ROOT Hips
+///     {
+///         OFFSET 0.0 0.0 0.0
+///         CHANNELS 3 Xposition Yposition Zposition
+///         End Site
+///         {
+///             OFFSET 0.0 0.0 0.0
+///         }
+///     }
+///     MOTION
+///     Frames: 2
+///     Frame Time: 0.033333333
+///     0.0 1.0 2.0
+///     3.0 4.0 5.0
+/// };
+///
+/// let motion = bvh.to_channel_major();
+/// assert_eq!(motion.track(1), Some(&[1.0, 4.0][..]));
+///
+/// let root = bvh.root_joint().unwrap();
+/// assert_eq!(motion[&root.channels()[2]], [2.0, 5.0]);
+/// ```
+///
+/// [`Bvh`]: ../struct.Bvh.html
+/// [`Bvh::to_channel_major`]: ../struct.Bvh.html#method.to_channel_major
+/// [`Bvh::set_channel_major_motion`]: ../struct.Bvh.html#method.set_channel_major_motion
+#[derive(Clone, Debug, Default, PartialEq)]
+pub struct ChannelMajorMotion {
+    /// The tracks of each channel, one after the other.
+    values: Vec<f32>,
+    num_channels: usize,
+    num_frames: usize,
+}
+
+impl ChannelMajorMotion {
+    /// Transposes the frame-major `values`, which have `num_channels` values
+    /// in each frame, into a new `ChannelMajorMotion`.
+    ///
+    /// Any values after the last complete frame are ignored.
+    pub fn from_frame_major(values: &[f32], num_channels: usize) -> Self {
+        let mut motion = ChannelMajorMotion::default();
+        motion.copy_from_frame_major(values, num_channels);
+        motion
+    }
+
+    /// Replaces the contents of `self` with the transpose of the frame-major
+    /// `values`, reusing the memory already allocated by `self`.
+    ///
+    /// Any values after the last complete frame are ignored.
+    pub fn copy_from_frame_major(&mut self, values: &[f32], num_channels: usize) {
+        let num_frames = if num_channels == 0 {
+            0
+        } else {
+            values.len() / num_channels
+        };
+
+        let len = num_frames * num_channels;
+        self.values.clear();
+        self.values.resize(len, 0.0);
+        transpose(&values[..len], num_frames, num_channels, &mut self.values);
+
+        self.num_channels = num_channels;
+        self.num_frames = num_frames;
+    }
+
+    /// Transposes `self` back into frame-major order, writing the values into
+    /// `out`, which is cleared first.
+    pub fn to_frame_major_into(&self, out: &mut Vec<f32>) {
+        out.clear();
+        out.resize(self.values.len(), 0.0);
+        transpose(&self.values, self.num_channels, self.num_frames, out);
+    }
+
+    /// Transposes `self` back into frame-major order, which is the layout of
+    /// the motion values of a `Bvh`.
+    #[inline]
+    pub fn to_frame_major(&self) -> Vec<f32> {
+        let mut out = Vec::new();
+        self.to_frame_major_into(&mut out);
+        out
+    }
+
+    /// Returns the number of channels, which is the number of tracks.
+    #[inline]
+    pub const fn num_channels(&self) -> usize {
+        self.num_channels
+    }
+
+    /// Returns the number of frames, which is the length of each track.
+    #[inline]
+    pub const fn num_frames(&self) -> usize {
+        self.num_frames
+    }
+
+    /// Returns every track, one after the other.
+    #[inline]
+    pub fn as_slice(&self) -> &[f32] {
+        &self.values[..]
+    }
+
+    /// Returns every track mutably, one after the other.
+    #[inline]
+    pub fn as_mut_slice(&mut self) -> &mut [f32] {
+        &mut self.values[..]
+    }
+
+    /// Returns the values of `channel` in every frame, or `None` if `channel`
+    /// is out of bounds.
+    ///
+    /// `channel` may either be a [`Channel`][`Channel`], or the index of a
+    /// channel.
+    ///
+    /// [`Channel`]: ../struct.Channel.html
+    #[inline]
+    pub fn track<I: FrameIndex<SliceIndex = usize>>(&self, channel: I) -> Option<&[f32]> {
+        let start = self.track_start(channel.to_slice_index())?;
+        Some(&self.values[start..start + self.num_frames])
+    }
+
+    /// Returns the values of `channel` in every frame mutably, or `None` if
+    /// `channel` is out of bounds.
+    #[inline]
+    pub fn track_mut<I: FrameIndex<SliceIndex = usize>>(
+        &mut self,
+        channel: I,
+    ) -> Option<&mut [f32]> {
+        let start = self.track_start(channel.to_slice_index())?;
+        Some(&mut self.values[start..start + self.num_frames])
+    }
+
+    /// Returns the value of `channel` in the frame at `frame`, or `None` if
+    /// either is out of bounds.
+    #[inline]
+    pub fn get<I: FrameIndex<SliceIndex = usize>>(&self, frame: usize, channel: I) -> Option<f32> {
+        self.track(channel)?.get(frame).copied()
+    }
+
+    /// Returns an iterator over the track of each channel, in channel order.
+    #[inline]
+    pub fn tracks(&self) -> Tracks<'_> {
+        Tracks {
+            values: &self.values[..],
+            track_len: self.num_frames,
+            remaining: self.num_channels,
+        }
+    }
+
+    /// Returns a mutable iterator over the track of each channel, in channel
+    /// order.
+    #[inline]
+    pub fn tracks_mut(&mut self) -> TracksMut<'_> {
+        TracksMut {
+            values: &mut self.values[..],
+            track_len: self.num_frames,
+            remaining: self.num_channels,
+        }
+    }
+
+    #[inline]
+    fn track_start(&self, channel: usize) -> Option<usize> {
+        if channel < self.num_channels {
+            Some(channel * self.num_frames)
+        } else {
+            None
+        }
+    }
+}
+
+impl<I: FrameIndex<SliceIndex = usize>> Index<I> for ChannelMajorMotion {
+    type Output = [f32];
+
+    #[inline]
+    fn index(&self, channel: I) -> &Self::Output {
+        let channel = channel.to_slice_index();
+        let num_channels = self.num_channels;
+        self.track(channel).unwrap_or_else(|| {
+            panic!(
+                "channel {} is out of bounds for {} channels",
+                channel, num_channels
+            )
+        })
+    }
+}
+
+impl<I: FrameIndex<SliceIndex = usize>> IndexMut<I> for ChannelMajorMotion {
+    #[inline]
+    fn index_mut(&mut self, channel: I) -> &mut Self::Output {
+        let channel = channel.to_slice_index();
+        let num_channels = self.num_channels;
+        self.track_mut(channel).unwrap_or_else(|| {
+            panic!(
+                "channel {} is out of bounds for {} channels",
+                channel, num_channels
+            )
+        })
+    }
+}
+
+/// An iterator over the tracks of a [`ChannelMajorMotion`][`ChannelMajorMotion`].
+///
+/// This type is created using the [`ChannelMajorMotion::tracks`] method.
+///
+/// [`ChannelMajorMotion`]: struct.ChannelMajorMotion.html
+/// [`ChannelMajorMotion::tracks`]: struct.ChannelMajorMotion.html#method.tracks
+#[derive(Debug)]
+pub struct Tracks<'a> {
+    /// The tracks which have not been yielded yet.
+    ///
+    /// Note: the tracks are counted with `remaining` rather than by
+    /// chunking `values`, so that a motion with no frames still yields one
+    /// empty track per channel.
+    values: &'a [f32],
+    track_len: usize,
+    remaining: usize,
+}
+
+impl<'a> Iterator for Tracks<'a> {
+    type Item = &'a [f32];
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.remaining == 0 {
+            return None;
+        }
+
+        self.remaining -= 1;
+        let (track, rest) = self.values.split_at(self.track_len);
+        self.values = rest;
+        Some(track)
+    }
+
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        (self.remaining, Some(self.remaining))
+    }
+}
+
+impl<'a> DoubleEndedIterator for Tracks<'a> {
+    #[inline]
+    fn next_back(&mut self) -> Option<Self::Item> {
+        if self.remaining == 0 {
+            return None;
+        }
+
+        self.remaining -= 1;
+        let (rest, track) = self.values.split_at(self.values.len() - self.track_len);
+        self.values = rest;
+        Some(track)
+    }
+}
+
+impl<'a> ExactSizeIterator for Tracks<'a> {
+    #[inline]
+    fn len(&self) -> usize {
+        self.remaining
+    }
+}
+
+impl<'a> FusedIterator for Tracks<'a> {}
+
+/// A mutable iterator over the tracks of a [`ChannelMajorMotion`]
+/// [`ChannelMajorMotion`].
+///
+/// This type is created using the [`ChannelMajorMotion::tracks_mut`] method.
+///
+/// [`ChannelMajorMotion`]: struct.ChannelMajorMotion.html
+/// [`ChannelMajorMotion::tracks_mut`]: struct.ChannelMajorMotion.html#method.tracks_mut
+#[derive(Debug)]
+pub struct TracksMut<'a> {
+    values: &'a mut [f32],
+    track_len: usize,
+    remaining: usize,
+}
+
+impl<'a> Iterator for TracksMut<'a> {
+    type Item = &'a mut [f32];
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.remaining == 0 {
+            return None;
+        }
+
+        self.remaining -= 1;
+        let (track, rest) = mem::replace(&mut self.values, &mut []).split_at_mut(self.track_len);
+        self.values = rest;
+        Some(track)
+    }
+
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        (self.remaining, Some(self.remaining))
+    }
+}
+
+impl<'a> DoubleEndedIterator for TracksMut<'a> {
+    #[inline]
+    fn next_back(&mut self) -> Option<Self::Item> {
+        if self.remaining == 0 {
+            return None;
+        }
+
+        self.remaining -= 1;
+        let values = mem::replace(&mut self.values, &mut []);
+        let split = values.len() - self.track_len;
+        let (rest, track) = values.split_at_mut(split);
+        self.values = rest;
+        Some(track)
+    }
+}
+
+impl<'a> ExactSizeIterator for TracksMut<'a> {
+    #[inline]
+    fn len(&self) -> usize {
+        self.remaining
+    }
+}
+
+impl<'a> FusedIterator for TracksMut<'a> {}
+
+/// Writes the transpose of the `rows` by `cols` matrix `src` into `dst`.
+///
+/// The matrix is copied in square tiles, so that the strided side of the copy
+/// stays within a few cache lines for the length of each tile.
+fn transpose(src: &[f32], rows: usize, cols: usize, dst: &mut [f32]) {
+    debug_assert_eq!(src.len(), rows * cols);
+    debug_assert_eq!(dst.len(), rows * cols);
+
+    for row_start in (0..rows).step_by(TILE_SIZE) {
+        let row_end = (row_start + TILE_SIZE).min(rows);
+        for col_start in (0..cols).step_by(TILE_SIZE) {
+            let col_end = (col_start + TILE_SIZE).min(cols);
+            for row in row_start..row_end {
+                for col in col_start..col_end {
+                    dst[col * rows + row] = src[row * cols + col];
+                }
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn transpose_round_trips() {
+        for &(num_frames, num_channels) in &[(0, 3), (0, 0), (1, 1), (17, 33), (40, 7)] {
+            let values = (0..num_frames * num_channels)
+                .map(|v| v as f32)
+                .collect::<Vec<_>>();
+
+            let motion = ChannelMajorMotion::from_frame_major(&values, num_channels);
+            assert_eq!(motion.num_frames(), num_frames);
+            assert_eq!(motion.num_channels(), num_channels);
+            assert_eq!(motion.tracks().len(), num_channels);
+            assert_eq!(motion.tracks().rev().count(), num_channels);
+            for track in motion.tracks() {
+                assert_eq!(track.len(), num_frames);
+            }
+
+            let mut motion_mut = motion.clone();
+            assert_eq!(motion_mut.tracks_mut().len(), num_channels);
+            assert_eq!(motion_mut.tracks_mut().rev().count(), num_channels);
+
+            for (channel, track) in motion.tracks().enumerate() {
+                for (frame, &value) in track.iter().enumerate() {
+                    assert_eq!(value, values[frame * num_channels + channel]);
+                }
+            }
+
+            assert_eq!(motion.to_frame_major(), values);
+        }
+    }
+
+    #[test]
+    fn bvh_round_trips() {
+        use crate::{errors::SetMotionError, Bvh};
+
+        const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let expected = bvh.clone();
+
+        let mut motion = bvh.to_channel_major();
+        assert_eq!(motion.num_channels(), bvh.num_channels());
+        for (channel, track) in motion.tracks().enumerate() {
+            let column = bvh.frames().map(|f| f[channel]).collect::<Vec<_>>();
+            assert_eq!(track, &column[..]);
+        }
+
+        for track in motion.tracks_mut() {
+            track.reverse();
+        }
+        bvh.set_channel_major_motion(&motion).unwrap();
+        assert_eq!(
+            bvh.frames().next().unwrap(),
+            expected.frames().next_back().unwrap()
+        );
+
+        for track in motion.tracks_mut() {
+            track.reverse();
+        }
+        bvh.set_channel_major_motion(&motion).unwrap();
+        assert_eq!(bvh, expected);
+
+        let other = ChannelMajorMotion::from_frame_major(&[0.0; 4], 2);
+        match bvh.set_channel_major_motion(&other) {
+            Err(SetMotionError::ChannelCountMismatch {
+                expected,
+                actual: 2,
+            }) if expected == bvh.num_channels() => {}
+            result => panic!("unexpected result: {:?}", result),
+        }
+    }
+
+    #[test]
+    fn partial_frames_are_ignored() {
+        let motion = ChannelMajorMotion::from_frame_major(&[0.0, 1.0, 2.0, 3.0, 4.0], 2);
+        assert_eq!(motion.num_frames(), 2);
+        assert_eq!(motion.as_slice(), &[0.0, 2.0, 1.0, 3.0]);
+        assert_eq!(motion.track(2), None);
+        assert_eq!(motion.get(1, 1), Some(3.0));
+    }
+}
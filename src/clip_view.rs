@@ -0,0 +1,437 @@
+//! A borrowed window over the frames of a `Bvh`.
+
+use crate::{
+    frames::Frames, joint::Skeleton, motion::Motion, write::WriteOptions, Bvh, Joint, Joints,
+};
+use std::{
+    convert::TryFrom,
+    io::{self, Write},
+    iter::{DoubleEndedIterator, ExactSizeIterator, FusedIterator, Iterator, StepBy},
+    ops::{Bound, Range, RangeBounds},
+    sync::Arc,
+    time::Duration,
+};
+
+/// A read-only view of a range of the frames of a [`Bvh`][`Bvh`], optionally
+/// taking only every `stride`th frame of the range.
+///
+/// A `ClipView` borrows the skeleton and motion values of the `Bvh` it was
+/// created from, so creating one does not copy any frames. It has the same
+/// methods for reading the clip as a `Bvh`, and can be written with
+/// [`write_to`][`write_to`] or any of the methods of
+/// [`WriteOptions`][`WriteOptions`], so a window of a long clip can be
+/// analysed or exported without first being copied into a new `Bvh`.
+///
+/// This type is created using the [`Bvh::slice_frames`][`Bvh::slice_frames`]
+/// method, and every `Bvh` can also be converted into a view of all of its
+/// frames with `ClipView::from`.
+///
+/// # Examples
+///
+/// ```
+/// # use bvh_anim::Bvh;
+/// # use std::time::Duration;
+/// const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+/// let bvh = Bvh::from_bytes(BVH_BYTES)?;
+///
+/// let view = bvh.slice_frames(100..200).with_stride(2);
+/// assert_eq!(view.frames().len(), 50);
+/// assert_eq!(*view.frame_time(), *bvh.frame_time() * 2);
+///
+/// let first = view.frames().next().unwrap();
+/// assert_eq!(first.as_slice(), bvh.frames().nth(100).unwrap().as_slice());
+///
+/// let mut out = Vec::new();
+/// view.write_to(&mut out)?;
+/// let windowed = Bvh::from_bytes(&out)?;
+/// assert_eq!(windowed.frames().len(), 50);
+/// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+/// ```
+///
+/// [`Bvh`]: struct.Bvh.html
+/// [`write_to`]: struct.ClipView.html#method.write_to
+/// [`WriteOptions`]: write/struct.WriteOptions.html
+/// [`Bvh::slice_frames`]: struct.Bvh.html#method.slice_frames
+#[derive(Clone, Copy, Debug)]
+pub struct ClipView<'a> {
+    bvh: &'a Bvh,
+    /// The index of the first frame of the view in `bvh`.
+    start: usize,
+    /// The index one past the last frame of the range in `bvh`.
+    end: usize,
+    stride: usize,
+    /// The frame time of `bvh`, multiplied by `stride`.
+    frame_time: Duration,
+}
+
+impl<'a> ClipView<'a> {
+    /// Create a view of the frames of `bvh` in `range`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the start of `range` is greater than its end, or if its end is
+    /// greater than the number of frames in `bvh`.
+    pub(crate) fn new<R: RangeBounds<usize>>(bvh: &'a Bvh, range: R) -> Self {
+        let Range { start, end } = resolve_range(range, bvh.frames().len());
+        ClipView {
+            bvh,
+            start,
+            end,
+            stride: 1,
+            frame_time: *bvh.frame_time(),
+        }
+    }
+
+    /// Returns the view with only every `stride`th frame of its range, starting
+    /// with the first frame. The frame time of the view is scaled by `stride`,
+    /// so that the view plays back at the same speed as the original clip.
+    ///
+    /// A stride of `0` is treated as `1`.
+    #[inline]
+    pub fn with_stride(self, stride: usize) -> Self {
+        let stride = stride.max(1);
+        let frame_time = u32::try_from(stride)
+            .ok()
+            .and_then(|stride| self.bvh.frame_time().checked_mul(stride))
+            .unwrap_or(Duration::MAX);
+
+        ClipView {
+            stride,
+            frame_time,
+            ..self
+        }
+    }
+
+    /// Returns a view of the frames of this view in `range`, which keeps the
+    /// stride of this view. The indices in `range` are indices into
+    /// [`frames`][`frames`], not into the original `Bvh`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the start of `range` is greater than its end, or if its end is
+    /// greater than the number of frames in the view.
+    ///
+    /// [`frames`]: struct.ClipView.html#method.frames
+    pub fn slice_frames<R: RangeBounds<usize>>(&self, range: R) -> Self {
+        let Range { start, end } = resolve_range(range, self.frames().len());
+        let new_start = self.start + start * self.stride;
+        let new_end = if end > start {
+            self.start + (end - 1) * self.stride + 1
+        } else {
+            new_start
+        };
+
+        ClipView {
+            start: new_start,
+            end: new_end,
+            ..*self
+        }
+    }
+
+    /// Returns the `Bvh` this view was created from.
+    #[inline]
+    pub const fn bvh(&self) -> &'a Bvh {
+        self.bvh
+    }
+
+    /// Returns the range of frames of the original `Bvh` which the view covers.
+    /// If the stride of the view is greater than `1`, then not every frame in
+    /// the range is in the view.
+    #[inline]
+    pub const fn frame_range(&self) -> Range<usize> {
+        self.start..self.end
+    }
+
+    /// Returns the number of frames of the original `Bvh` which are skipped
+    /// between each frame of the view, plus one.
+    #[inline]
+    pub const fn stride(&self) -> usize {
+        self.stride
+    }
+
+    /// Returns the root joint if it exists, or `None` if the skeleton is empty.
+    #[inline]
+    pub fn root_joint(&self) -> Option<Joint<'a>> {
+        self.bvh.root_joint()
+    }
+
+    /// Returns an iterator over all the `Joint`s in the view.
+    #[inline]
+    pub fn joints(&self) -> Joints<'a> {
+        self.bvh.joints()
+    }
+
+    /// Returns the skeleton shared by the view and the original `Bvh`.
+    #[inline]
+    pub fn skeleton(&self) -> &'a Arc<Skeleton> {
+        self.bvh.skeleton()
+    }
+
+    /// Returns the number of channels in each frame of the view.
+    #[inline]
+    pub fn num_channels(&self) -> usize {
+        self.bvh.num_channels()
+    }
+
+    /// Returns an iterator over the frames of the view.
+    #[inline]
+    pub fn frames(&self) -> ClipFrames<'a> {
+        let mut frames = self.bvh.frames();
+        let num_trailing = frames.len() - self.end;
+        if num_trailing > 0 {
+            frames.nth_back(num_trailing - 1);
+        }
+        if self.start > 0 {
+            frames.nth(self.start - 1);
+        }
+
+        ClipFrames {
+            frames: frames.step_by(self.stride),
+        }
+    }
+
+    /// Gets the time each frame of the view takes to play, which is the
+    /// frame time of the original `Bvh` multiplied by the stride of the view.
+    #[inline]
+    pub const fn frame_time(&self) -> &Duration {
+        &self.frame_time
+    }
+
+    /// Copies the frames of the view into a new `Bvh`, which shares its
+    /// skeleton with the original `Bvh`.
+    pub fn to_bvh(&self) -> Bvh {
+        let frames = self.frames();
+        let mut values = Vec::with_capacity(frames.len() * self.num_channels());
+        for frame in frames {
+            values.extend_from_slice(frame.as_slice());
+        }
+
+        let mut bvh = Bvh::new();
+        bvh.skeleton = Some(Arc::clone(self.skeleton()));
+        bvh.num_channels = self.bvh.num_channels;
+        bvh.motion = Motion::from_vec(values);
+        bvh.frame_time = self.frame_time;
+        bvh
+    }
+
+    /// Writes the view using the `bvh` file format to the `writer`, with
+    /// the default formatting options.
+    ///
+    /// To customise the formatting, see the [`WriteOptions`][`WriteOptions`] type.
+    ///
+    /// [`WriteOptions`]: write/struct.WriteOptions.html
+    #[inline]
+    pub fn write_to<W: Write>(&self, writer: &mut W) -> io::Result<()> {
+        WriteOptions::default().write(*self, writer)
+    }
+
+    /// Writes the view using the `bvh` file format into a `Vec<u8>` with
+    /// the default formatting options.
+    ///
+    /// To customise the formatting, see the [`WriteOptions`][`WriteOptions`] type.
+    ///
+    /// [`WriteOptions`]: write/struct.WriteOptions.html
+    #[inline]
+    pub fn to_string(&self) -> Vec<u8> {
+        WriteOptions::default().write_to_string(*self)
+    }
+}
+
+impl<'a> From<&'a Bvh> for ClipView<'a> {
+    /// Create a view of all of the frames of `bvh`.
+    #[inline]
+    fn from(bvh: &'a Bvh) -> Self {
+        ClipView::new(bvh, ..)
+    }
+}
+
+impl<'a> From<&'_ ClipView<'a>> for ClipView<'a> {
+    #[inline]
+    fn from(view: &'_ ClipView<'a>) -> Self {
+        *view
+    }
+}
+
+/// Converts `range` into a range of indices into a sequence of `len` items.
+///
+/// # Panics
+///
+/// Panics if the start of `range` is greater than its end, or if its end is
+/// greater than `len`.
+fn resolve_range<R: RangeBounds<usize>>(range: R, len: usize) -> Range<usize> {
+    let start = match range.start_bound() {
+        Bound::Included(&start) => start,
+        Bound::Excluded(&start) => start.saturating_add(1),
+        Bound::Unbounded => 0,
+    };
+    let end = match range.end_bound() {
+        Bound::Included(&end) => end.saturating_add(1),
+        Bound::Excluded(&end) => end,
+        Bound::Unbounded => len,
+    };
+
+    assert!(
+        start <= end,
+        "frame range starts at {} but ends at {}",
+        start,
+        end
+    );
+    assert!(
+        end <= len,
+        "frame range end {} is out of range for a clip of {} frames",
+        end,
+        len
+    );
+    start..end
+}
+
+/// An iterator over the frames of a [`ClipView`].
+///
+/// This type is created using the [`ClipView::frames`] method.
+///
+/// [`ClipView`]: ../struct.ClipView.html
+/// [`ClipView::frames`]: ../struct.ClipView.html#method.frames
+#[derive(Debug)]
+pub struct ClipFrames<'a> {
+    frames: StepBy<Frames<'a>>,
+}
+
+impl<'a> Iterator for ClipFrames<'a> {
+    type Item = <Frames<'a> as Iterator>::Item;
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        self.frames.next()
+    }
+
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.frames.size_hint()
+    }
+
+    #[inline]
+    fn nth(&mut self, n: usize) -> Option<Self::Item> {
+        self.frames.nth(n)
+    }
+}
+
+impl<'a> DoubleEndedIterator for ClipFrames<'a> {
+    #[inline]
+    fn next_back(&mut self) -> Option<Self::Item> {
+        self.frames.next_back()
+    }
+
+    #[inline]
+    fn nth_back(&mut self, n: usize) -> Option<Self::Item> {
+        self.frames.nth_back(n)
+    }
+}
+
+impl<'a> ExactSizeIterator for ClipFrames<'a> {}
+
+impl<'a> FusedIterator for ClipFrames<'a> {}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::generate::GenerateOptions;
+    use crate::motion::BLOCK_FRAMES;
+
+    fn generate() -> Bvh {
+        GenerateOptions::new()
+            .with_seed(3)
+            .with_num_joints(3)
+            .with_num_frames(BLOCK_FRAMES * 2 + 17)
+            .generate()
+    }
+
+    fn model(bvh: &Bvh, range: Range<usize>, stride: usize) -> Vec<Vec<f32>> {
+        bvh.frames()
+            .skip(range.start)
+            .take(range.end - range.start)
+            .step_by(stride)
+            .map(|frame| frame.as_slice().to_vec())
+            .collect()
+    }
+
+    fn collect(view: &ClipView<'_>) -> Vec<Vec<f32>> {
+        view.frames()
+            .map(|frame| frame.as_slice().to_vec())
+            .collect()
+    }
+
+    #[test]
+    fn frames_match_model() {
+        let mut bvh = generate();
+        let len = bvh.frames().len();
+
+        // Copy one block, so that the frames are split into blocks.
+        let mut clone = bvh.clone();
+        clone.frames_mut().nth(BLOCK_FRAMES).unwrap().as_mut_slice()[0] = 1.0;
+        bvh = clone;
+
+        let ranges = [
+            0..len,
+            0..0,
+            len..len,
+            3..BLOCK_FRAMES + 5,
+            BLOCK_FRAMES..BLOCK_FRAMES + 1,
+            BLOCK_FRAMES - 1..len - 1,
+        ];
+        for range in ranges.iter().cloned() {
+            for &stride in &[1, 2, 7, len + 1] {
+                let view = bvh.slice_frames(range.clone()).with_stride(stride);
+                let expected = model(&bvh, range.clone(), stride);
+                assert_eq!(view.frames().len(), expected.len());
+                assert_eq!(collect(&view), expected);
+
+                let mut reversed = view
+                    .frames()
+                    .rev()
+                    .map(|frame| frame.as_slice().to_vec())
+                    .collect::<Vec<_>>();
+                reversed.reverse();
+                assert_eq!(reversed, expected);
+            }
+        }
+    }
+
+    #[test]
+    fn nested_slices_keep_stride() {
+        let bvh = generate();
+        let view = bvh.slice_frames(10..=200).with_stride(3);
+        let nested = view.slice_frames(4..20);
+        assert_eq!(nested.stride(), 3);
+        assert_eq!(nested.frame_range(), 22..68);
+        assert_eq!(collect(&nested), collect(&view)[4..20].to_vec());
+        assert_eq!(nested.frames().len(), 16);
+        assert_eq!(view.slice_frames(5..5).frames().len(), 0);
+    }
+
+    #[test]
+    fn to_bvh_and_write_match() {
+        let bvh = generate();
+        let view = bvh.slice_frames(BLOCK_FRAMES - 8..).with_stride(4);
+        let copied = view.to_bvh();
+
+        assert!(Arc::ptr_eq(copied.skeleton(), bvh.skeleton()));
+        assert_eq!(*copied.frame_time(), *bvh.frame_time() * 4);
+        assert_eq!(
+            copied
+                .frames()
+                .map(|frame| frame.as_slice().to_vec())
+                .collect::<Vec<_>>(),
+            collect(&view)
+        );
+        assert_eq!(view.to_string(), copied.to_string());
+        assert_eq!(ClipView::from(&bvh).to_string(), bvh.to_string());
+    }
+
+    #[test]
+    #[should_panic]
+    fn slice_out_of_bounds() {
+        let bvh = generate();
+        let len = bvh.frames().len();
+        let _ = bvh.slice_frames(1..len + 1);
+    }
+}
@@ -20,6 +20,8 @@ impl LoadError {
         match self.kind {
             LoadErrorKind::Joints(ref e) => e.line(),
             LoadErrorKind::Motion(ref e) => e.line(),
+            LoadErrorKind::ParserFailed { line } => line,
+            LoadErrorKind::Panicked { .. } => None,
         }
     }
 
@@ -49,6 +51,15 @@ impl fmt::Display for LoadError {
         let desc = match self.kind {
             LoadErrorKind::Joints(_) => "Could not load hierarchy",
             LoadErrorKind::Motion(_) => "Could not load motion",
+            LoadErrorKind::ParserFailed { line: Some(line) } => {
+                return write!(fmtr, "The parser already failed at line {}", line);
+            }
+            LoadErrorKind::ParserFailed { line: None } => {
+                return fmtr.write_str("The parser already failed");
+            }
+            LoadErrorKind::Panicked { ref message } => {
+                return write!(fmtr, "The parser panicked: {}", message);
+            }
         };
 
         write!(fmtr, "{}: {}", desc, self.source().unwrap())
@@ -61,6 +72,7 @@ impl StdError for LoadError {
         match self.kind {
             LoadErrorKind::Joints(ref e) => Some(e),
             LoadErrorKind::Motion(ref e) => Some(e),
+            LoadErrorKind::ParserFailed { .. } | LoadErrorKind::Panicked { .. } => None,
         }
     }
 }
@@ -72,6 +84,23 @@ pub enum LoadErrorKind {
     Joints(LoadJointsError),
     /// An error occurred when loading the motion values.
     Motion(LoadMotionError),
+    /// A [`BvhParser`][`BvhParser`] was fed more data, or finished, after it
+    /// had already returned an error.
+    ///
+    /// [`BvhParser`]: ../struct.BvhParser.html
+    ParserFailed {
+        /// The line of the error which the parser first returned, if it had one.
+        line: Option<usize>,
+    },
+    /// The parser panicked while a [`BatchLoader`][`BatchLoader`] was loading
+    /// the file. This is a bug in this crate, rather than a problem with the
+    /// file.
+    ///
+    /// [`BatchLoader`]: ../struct.BatchLoader.html
+    Panicked {
+        /// The message of the panic, if it had one.
+        message: String,
+    },
 }
 
 impl From<LoadJointsError> for LoadErrorKind {
@@ -96,6 +125,13 @@ pub enum LoadJointsError {
     Io(io::Error),
     /// The skeletal hierarchy is missing the `Root` joint.
     MissingRoot,
+    /// A line was encountered which is not valid at its position in the
+    /// hierarchy, such as a `JOINT` outside of any braces, or an unmatched
+    /// closing brace.
+    UnexpectedLine {
+        /// Line number in the source bvh where the error occurred.
+        line: usize,
+    },
     /// A name could not be found for the `Joint`.
     MissingJointName {
         /// Line number in the source bvh where the error occurred.
@@ -141,6 +177,13 @@ pub enum LoadJointsError {
         /// Line number in the source bvh where the error occurred.
         line: usize,
     },
+    /// A line of the hierarchy was longer than the limit set when loading.
+    LineTooLong {
+        /// The maximum number of bytes in a line.
+        limit: usize,
+        /// Line number in the source bvh where the error occurred.
+        line: usize,
+    },
 }
 
 impl LoadJointsError {
@@ -149,13 +192,15 @@ impl LoadJointsError {
     #[inline]
     pub fn line(&self) -> Option<usize> {
         match *self {
-            LoadJointsError::MissingJointName { line }
+            LoadJointsError::UnexpectedLine { line }
+            | LoadJointsError::MissingJointName { line }
             | LoadJointsError::UnexpectedChannelsSection { line }
             | LoadJointsError::ParseNumChannelsError { line, .. }
             | LoadJointsError::ParseChannelError { line, .. }
             | LoadJointsError::UnexpectedOffsetSection { line }
             | LoadJointsError::ParseOffsetError { line, .. }
-            | LoadJointsError::MissingOffsetAxis { line, .. } => Some(line),
+            | LoadJointsError::MissingOffsetAxis { line, .. }
+            | LoadJointsError::LineTooLong { line, .. } => Some(line),
             _ => None,
         }
     }
@@ -174,6 +219,9 @@ impl fmt::Display for LoadJointsError {
         match *self {
             LoadJointsError::Io(ref e) => fmt::Display::fmt(&e, f),
             LoadJointsError::MissingRoot => f.write_str("The root heirarchy could not be found"),
+            LoadJointsError::UnexpectedLine { line } => {
+                write!(f, "{}: the line is not valid here in the hierarchy", line)
+            }
             LoadJointsError::MissingJointName { line } => {
                 write!(f, "{}: the name is missing from the joints section", line)
             }
@@ -199,6 +247,13 @@ impl fmt::Display for LoadJointsError {
             LoadJointsError::MissingOffsetAxis { axis, line } => {
                 write!(f, "{}: the {}-axis offset value is missing", line, axis)
             }
+            LoadJointsError::LineTooLong { limit, line } => {
+                write!(
+                    f,
+                    "{}: the line is longer than the limit of {} bytes",
+                    line, limit
+                )
+            }
         }
     }
 }
@@ -271,6 +326,13 @@ pub enum LoadMotionError {
         /// Expected number of clips.
         expected_num_clips: usize,
     },
+    /// The motion values took up more memory than the limit set when loading.
+    MotionLimitExceeded {
+        /// The maximum number of bytes of motion values.
+        limit: usize,
+        /// The line where the limit was exceeded.
+        line: usize,
+    },
 }
 
 impl LoadMotionError {
@@ -281,7 +343,8 @@ impl LoadMotionError {
             LoadMotionError::MissingMotionSection { line }
             | LoadMotionError::MissingNumFrames { line, .. }
             | LoadMotionError::MissingFrameTime { line, .. }
-            | LoadMotionError::ParseMotionSection { line, .. } => Some(line),
+            | LoadMotionError::ParseMotionSection { line, .. }
+            | LoadMotionError::MotionLimitExceeded { line, .. } => Some(line),
             _ => None,
         }
     }
@@ -339,6 +402,11 @@ impl fmt::Display for LoadMotionError {
                     expected_num_frames,
                     expected_num_clips)
             }
+            LoadMotionError::MotionLimitExceeded { limit, line } => write!(
+                fmtr,
+                "{}: the motion values exceed the limit of {} bytes",
+                line, limit
+            ),
         }
     }
 }
@@ -381,6 +449,13 @@ pub enum SetMotionError {
     BadFrame(usize),
     /// The channel was out of bounds.
     BadChannel(usize),
+    /// The motion did not have the same number of channels as the `Bvh`.
+    ChannelCountMismatch {
+        /// The number of channels of the `Bvh`.
+        expected: usize,
+        /// The number of channels of the motion.
+        actual: usize,
+    },
 }
 
 impl fmt::Display for SetMotionError {
@@ -391,6 +466,11 @@ impl fmt::Display for SetMotionError {
             SetMotionError::BadChannel(channel) => {
                 write!(fmtr, "Channel {} of the bvh was out of bounds", channel,)
             }
+            SetMotionError::ChannelCountMismatch { expected, actual } => write!(
+                fmtr,
+                "Expected {} channels in the motion, but it has {}",
+                expected, actual
+            ),
         }
     }
 }
@@ -401,6 +481,9 @@ impl StdError for SetMotionError {
         match *self {
             SetMotionError::BadFrame(_) => "The frame was out of bounds",
             SetMotionError::BadChannel(_) => "The channel was out of bounds",
+            SetMotionError::ChannelCountMismatch { .. } => {
+                "The motion has the wrong number of channels"
+            }
         }
     }
 }
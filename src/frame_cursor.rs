@@ -1,9 +1,17 @@
 use crate::{
     errors::{FrameInsertError, FrameRemoveError},
     frames::{Frame, FrameMut, Frames, FramesMut},
+    motion::Motion,
     Bvh,
 };
-use std::cmp::min;
+use std::{
+    cmp::{max, min},
+    mem,
+    ops::{Bound, Range, RangeBounds},
+};
+
+/// The smallest gap, in frames, which is opened when frames are inserted.
+const MIN_GAP_FRAMES: usize = 16;
 
 /// A `FrameCursor` is used to insert frames into a [`Bvh`]. It operates
 /// similarly to a [`linked_list::Cursor`]: methods are provided to move
@@ -11,13 +19,37 @@ use std::cmp::min;
 ///
 /// You can create a `FrameCursor` using the [`Bvh::frame_cursor`] method.
 ///
+/// Once frames have been inserted or removed, the cursor takes the motion
+/// values out of the `Bvh`, and keeps them as a gap buffer, with a gap of
+/// unused values at the index of the cursor. Inserting or removing frames at
+/// the cursor only changes the size of the gap, and moving the cursor by one
+/// frame only moves one frame across the gap, so editing near the cursor takes
+/// time proportional to the size of a frame rather than the length of the clip.
+/// The gap is closed, and the values are given back to the `Bvh`, when the
+/// cursor is dropped, or converted into a [`Frames`] iterator. If the cursor
+/// is leaked instead (for example with `mem::forget`), then the `Bvh` is left
+/// without any frames, rather than with the unused values of the gap.
+///
 /// [`Bvh`]: ../struct.Bvh.html
 /// [`linked_list::Cursor`]: http://doc.rust-lang.org/stable/std/collections/linked_list/struct.Cursor.html
 /// [`Bvh::frame_cursor`]: ../struct.Bvh.html#method.frame_cursor
+/// [`Frames`]: struct.Frames.html
 #[derive(Debug)]
 pub struct FrameCursor<'bvh> {
-    bvh: &'bvh mut Bvh,
+    /// The `Bvh` being edited, which is only `None` once the cursor has been
+    /// converted into an iterator.
+    bvh: Option<&'bvh mut Bvh>,
     index: usize,
+    num_channels: usize,
+    /// The motion values of the `Bvh`, which are taken out of it when
+    /// frames are first inserted or removed, and are only given back when the
+    /// gap is closed. While this is `None`, the cursor edits the motion values
+    /// of the `Bvh` in place.
+    values: Option<Vec<f32>>,
+    /// The number of unused motion values in `values` which start at the
+    /// index of the cursor. This is always a multiple of `num_channels`, and
+    /// is only non-zero if `values` is `Some`.
+    gap_len: usize,
 }
 
 impl<'bvh> FrameCursor<'bvh> {
@@ -33,7 +65,18 @@ impl<'bvh> FrameCursor<'bvh> {
     /// [`Bvh`]: ../struct.Bvh.html
     #[inline]
     pub fn len(&self) -> usize {
-        self.bvh.frames().len()
+        (self.values_len() - self.gap_len)
+            .checked_div(self.num_channels)
+            .unwrap_or(0)
+    }
+
+    /// Returns `true` if the [`Bvh`] the cursor is currently pointing to has
+    /// no frames.
+    ///
+    /// [`Bvh`]: ../struct.Bvh.html
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
     }
 
     /// Returns the number of channels in the [`Bvh`] the cursor is is currently
@@ -42,7 +85,7 @@ impl<'bvh> FrameCursor<'bvh> {
     /// [`Bvh`]: ../struct.Bvh.html
     #[inline]
     pub const fn num_channels(&self) -> usize {
-        self.bvh.num_channels
+        self.num_channels
     }
 
     /// Move the `FrameCursor` to the next frame of the `Bvh`'s motion values.
@@ -51,8 +94,8 @@ impl<'bvh> FrameCursor<'bvh> {
     /// do nothing.
     #[inline]
     pub fn move_next(&mut self) -> &mut Self {
-        self.index = min(self.index + 1, self.bvh.frames().len());
-        self
+        let index = min(self.index + 1, self.len());
+        self.move_to(index)
     }
 
     /// Move the `FrameCursor` to the previous frame of the `Bvh`'s motion values.
@@ -61,8 +104,8 @@ impl<'bvh> FrameCursor<'bvh> {
     /// do nothing.
     #[inline]
     pub fn move_prev(&mut self) -> &mut Self {
-        self.index = self.index.saturating_sub(1);
-        self
+        let index = self.index.saturating_sub(1);
+        self.move_to(index)
     }
 
     /// Move the `FrameCursor` to the first frame of the `Bvh`'s motion values.
@@ -71,8 +114,7 @@ impl<'bvh> FrameCursor<'bvh> {
     /// do nothing.
     #[inline]
     pub fn move_first(&mut self) -> &mut Self {
-        self.index = 0;
-        self
+        self.move_to(0)
     }
 
     /// Move the `FrameCursor` to the last frame of the `Bvh`'s motion values.
@@ -81,8 +123,8 @@ impl<'bvh> FrameCursor<'bvh> {
     /// do nothing.
     #[inline]
     pub fn move_last(&mut self) -> &mut Self {
-        self.index = self.len();
-        self
+        let index = self.len();
+        self.move_to(index)
     }
 
     /// Returns the frame next to the current index of the `FrameCursor`.
@@ -90,7 +132,8 @@ impl<'bvh> FrameCursor<'bvh> {
     /// Returns `None` if there is no frame available.
     #[inline]
     pub fn peek_next(&self) -> Option<Frame<'_>> {
-        self.bvh.frames().nth(self.index)
+        let range = self.next_frame_range()?;
+        Some(Frame(self.frame(range)))
     }
 
     /// Returns the frame before the current index of the `FrameCursor`.
@@ -98,11 +141,8 @@ impl<'bvh> FrameCursor<'bvh> {
     /// Returns `None` if there is no frame available.
     #[inline]
     pub fn peek_prev(&self) -> Option<Frame<'_>> {
-        if self.index() > 0 {
-            self.bvh.frames().nth(self.index - 1)
-        } else {
-            None
-        }
+        let range = self.prev_frame_range()?;
+        Some(Frame(self.frame(range)))
     }
 
     /// Returns a mutable reference to the frame next to the current
@@ -111,7 +151,8 @@ impl<'bvh> FrameCursor<'bvh> {
     /// Returns `None` if there is no frame available.
     #[inline]
     pub fn peek_next_mut(&mut self) -> Option<FrameMut<'_>> {
-        self.bvh.frames_mut().nth(self.index)
+        let range = self.next_frame_range()?;
+        Some(FrameMut(self.frame_mut(range)))
     }
 
     /// Returns a mutable reference to the frame before the current index
@@ -120,11 +161,8 @@ impl<'bvh> FrameCursor<'bvh> {
     /// Returns `None` if there is no frame available.
     #[inline]
     pub fn peek_prev_mut(&mut self) -> Option<FrameMut<'_>> {
-        if self.index() > 0 {
-            self.bvh.frames_mut().nth(self.index - 1)
-        } else {
-            None
-        }
+        let range = self.prev_frame_range()?;
+        Some(FrameMut(self.frame_mut(range)))
     }
 
     /// Returns the frames surrounding the current index of the `FrameCursor`.
@@ -226,10 +264,17 @@ impl<'bvh> FrameCursor<'bvh> {
             ));
         }
 
-        let idx = self.index * self.num_channels();
-        vec_insert_slice(&mut self.bvh.motion_values, idx, frame);
+        if self.num_channels == 0 {
+            return Ok(self);
+        }
+
+        self.reserve_gap(frame.len());
+        let gap_start = self.gap_start();
+        self.values_mut()[gap_start..gap_start + frame.len()].copy_from_slice(frame);
+        self.gap_len -= frame.len();
+        self.index += 1;
 
-        Ok(self.move_next())
+        Ok(self)
     }
 
     /// Insert multiple frames contiguously at the current index. This is generally more
@@ -310,22 +355,52 @@ impl<'bvh> FrameCursor<'bvh> {
     /// ```
     ///
     ///[`try_insert_frame`]: ./struct.FrameInserter.html#method.try_insert_frame
+    #[inline]
     pub fn try_insert_frames<'f, I, F>(&mut self, frames: I) -> Result<&mut Self, FrameInsertError>
     where
         I: IntoIterator<Item = &'f F>,
         F: 'f + AsRef<[f32]> + ?Sized,
     {
-        let frames = frames.into_iter();
-        let num_channels = self.num_channels();
-        let num_frames = {
-            let (low, up) = frames.size_hint();
-            up.unwrap_or(low)
-        };
+        self.insert_frames_from_iter(frames)
+    }
 
-        self.bvh.motion_values.reserve(num_frames * num_channels);
+    /// Insert each frame yielded by `frames` contiguously at the current index.
+    ///
+    /// Space for all of the frames is made with a single move of the frames
+    /// after the cursor, using the lower bound of the size hint of `frames`.
+    /// The index of the cursor will be advanced to the end of the frames
+    /// inserted.
+    ///
+    /// # Errors
+    ///
+    /// If any of the frames could not be inserted (because they were an incorrect size),
+    /// then an error will be returned. The frames before it are still inserted.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use bvh_anim::Bvh;
+    /// # const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    /// let mut bvh = Bvh::from_bytes(BVH_BYTES)?;
+    /// let num_channels = bvh.num_channels();
+    ///
+    /// bvh.frame_cursor()
+    ///     .insert_frames_from_iter((0..10).map(|i| vec![i as f32; num_channels]))?;
+    ///
+    /// assert_eq!(bvh.frames().len(), 465);
+    /// assert_eq!(bvh.frames().nth(9).unwrap().as_slice()[0], 9.0);
+    /// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+    /// ```
+    pub fn insert_frames_from_iter<I>(&mut self, frames: I) -> Result<&mut Self, FrameInsertError>
+    where
+        I: IntoIterator,
+        I::Item: AsRef<[f32]>,
+    {
+        let frames = frames.into_iter();
+        let (num_frames, _) = frames.size_hint();
+        self.reserve_gap(num_frames.saturating_mul(self.num_channels));
 
-        for frame in frames.into_iter() {
-            let frame = frame.as_ref();
+        for frame in frames {
             self.try_insert_frame(&frame)?;
         }
 
@@ -403,17 +478,71 @@ impl<'bvh> FrameCursor<'bvh> {
     /// # } // fn main()
     /// ```
     pub fn remove_frame(&mut self) -> Result<&mut Self, FrameRemoveError> {
-        if self.len() == 0 {
+        if self.index >= self.len() {
             return Err(FrameRemoveError::new(self.index));
         }
 
-        let bnd = |idx| idx * self.num_channels();
-        let frame_bound = bnd(self.index)..bnd(self.index + 1);
+        self.values_mut();
+        self.gap_len += self.num_channels;
+        Ok(self)
+    }
 
-        let mut i = 0;
-        self.bvh
-            .motion_values
-            .retain(|_| (!frame_bound.contains(&i), i += 1).0);
+    /// Removes the frames in `range`, and moves the cursor to the start of
+    /// `range`.
+    ///
+    /// The indices in `range` are the indices of the frames in the [`Bvh`],
+    /// rather than offsets from the cursor. At most one move of the frames
+    /// between the cursor and the range is made.
+    ///
+    /// # Errors
+    ///
+    /// If `range` extends past the last frame, then no frames are removed and
+    /// an error will be returned.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use bvh_anim::Bvh;
+    /// # const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    /// let mut bvh = Bvh::from_bytes(BVH_BYTES)?;
+    /// let last_frame = bvh.frames().last().unwrap().as_slice().to_vec();
+    ///
+    /// let mut frame_cursor = bvh.frame_cursor();
+    /// frame_cursor.remove_frames(..450)?;
+    /// assert_eq!(frame_cursor.index(), 0);
+    /// assert_eq!(frame_cursor.len(), 5);
+    /// # drop(frame_cursor);
+    ///
+    /// assert_eq!(bvh.frames().last().unwrap().as_slice(), &last_frame[..]);
+    /// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+    /// ```
+    ///
+    /// [`Bvh`]: ../struct.Bvh.html
+    pub fn remove_frames<R>(&mut self, range: R) -> Result<&mut Self, FrameRemoveError>
+    where
+        R: RangeBounds<usize>,
+    {
+        let len = self.len();
+        let start = match range.start_bound() {
+            Bound::Included(&start) => start,
+            Bound::Excluded(&start) => start.saturating_add(1),
+            Bound::Unbounded => 0,
+        };
+        let end = match range.end_bound() {
+            Bound::Included(&end) => end.saturating_add(1),
+            Bound::Excluded(&end) => end,
+            Bound::Unbounded => len,
+        };
+
+        if end > len {
+            return Err(FrameRemoveError::new(len));
+        }
+
+        if start < end {
+            self.move_to(start);
+            self.values_mut();
+            self.gap_len += (end - start) * self.num_channels;
+        }
 
         Ok(self)
     }
@@ -480,7 +609,10 @@ impl<'bvh> FrameCursor<'bvh> {
     /// [`Bvh`]: ../struct.Bvh.html
     #[inline]
     pub fn remove_all_frames(&mut self) -> &mut Self {
-        self.bvh.motion_values.clear();
+        self.values = None;
+        self.motion_mut().clear();
+        self.index = 0;
+        self.gap_len = 0;
         self
     }
 
@@ -489,19 +621,22 @@ impl<'bvh> FrameCursor<'bvh> {
     /// [`Bvh`]: ../struct.Bvh.html
     #[inline]
     pub fn shrink_to_fit(&mut self) {
-        self.bvh.motion_values.shrink_to_fit();
+        self.close_gap();
+        self.motion_mut().vec_mut().shrink_to_fit();
     }
 
     /// Create a new `Frames` iterator from the `FramesCursor`, starting at the current
     /// index.
     #[inline]
-    pub fn into_frames(self) -> Frames<'bvh> {
-        // @TODO: Replace with `Iterator::advance_by` when stable.
-        let mut frames = self.bvh.frames();
-        for _ in 0..self.index {
-            if frames.next().is_none() {
-                break;
-            }
+    pub fn into_frames(mut self) -> Frames<'bvh> {
+        self.close_gap();
+        let bvh: &'bvh Bvh = self.bvh.take().expect("the cursor has a bvh");
+
+        // Skipping whole blocks with `nth` avoids copying shared frames
+        // which are never reached.
+        let mut frames = bvh.frames();
+        if self.index > 0 {
+            frames.nth(self.index - 1);
         }
 
         frames
@@ -510,23 +645,182 @@ impl<'bvh> FrameCursor<'bvh> {
     /// Create a new `FramesMut` iterator from the `FramesCursor`, starting at the current
     /// index.
     #[inline]
-    pub fn into_frames_mut(self) -> FramesMut<'bvh> {
-        // @TODO: Replace with `Iterator::advance_by` when stable.
-        let mut frames = self.bvh.frames_mut();
-        for _ in 0..self.index {
-            if frames.next().is_none() {
-                break;
-            }
+    pub fn into_frames_mut(mut self) -> FramesMut<'bvh> {
+        self.close_gap();
+        let bvh = self.bvh.take().expect("the cursor has a bvh");
+
+        // Skipping whole blocks with `nth` avoids copying shared frames
+        // which are never reached.
+        let mut frames = bvh.frames_mut();
+        if self.index > 0 {
+            frames.nth(self.index - 1);
         }
 
         frames
     }
+
+    #[inline]
+    fn motion(&self) -> &Motion {
+        &self.bvh.as_ref().expect("the cursor has a bvh").motion
+    }
+
+    /// Returns the total number of motion values, including the gap.
+    #[inline]
+    fn values_len(&self) -> usize {
+        match self.values {
+            Some(ref values) => values.len(),
+            None => self.motion().len(),
+        }
+    }
+
+    /// Returns the motion values in `range`.
+    #[inline]
+    fn frame(&self, range: Range<usize>) -> &[f32] {
+        match self.values {
+            Some(ref values) => &values[range],
+            None => self.motion().range(range),
+        }
+    }
+
+    /// Returns the motion values in `range` for modification. If the values
+    /// are still in the `Bvh`, then only the block containing `range` is
+    /// copied if it is shared.
+    #[inline]
+    fn frame_mut(&mut self, range: Range<usize>) -> &mut [f32] {
+        let num_channels = self.num_channels;
+        if self.values.is_none() {
+            return self.motion_mut().range_mut(range, num_channels);
+        }
+
+        &mut self.values.as_mut().expect("the values were taken")[range]
+    }
+
+    /// Returns the motion values so that frames can be inserted and removed,
+    /// taking them out of the `Bvh` first if they are still there.
+    #[inline]
+    fn values_mut(&mut self) -> &mut Vec<f32> {
+        if self.values.is_none() {
+            let values = mem::take(self.motion_mut().vec_mut());
+            self.values = Some(values);
+        }
+
+        self.values.as_mut().expect("the values were taken")
+    }
+
+    /// Returns the motion of the `Bvh`. If the motion is shared with a clone
+    /// of the `Bvh`, then modifying a frame with `Motion::range_mut` only
+    /// copies the block which contains it, while inserting or removing frames
+    /// with `Motion::vec_mut` copies all of them.
+    #[inline]
+    fn motion_mut(&mut self) -> &mut Motion {
+        &mut self.bvh.as_mut().expect("the cursor has a bvh").motion
+    }
+
+    /// Returns the index of the first motion value in the gap.
+    #[inline]
+    const fn gap_start(&self) -> usize {
+        self.index * self.num_channels
+    }
+
+    /// Returns the range of the motion values of the frame after the gap.
+    #[inline]
+    fn next_frame_range(&self) -> Option<Range<usize>> {
+        if self.index < self.len() {
+            let start = self.gap_start() + self.gap_len;
+            Some(start..start + self.num_channels)
+        } else {
+            None
+        }
+    }
+
+    /// Returns the range of the motion values of the frame before the gap.
+    #[inline]
+    fn prev_frame_range(&self) -> Option<Range<usize>> {
+        if self.index > 0 && self.num_channels > 0 {
+            let end = self.gap_start();
+            Some(end - self.num_channels..end)
+        } else {
+            None
+        }
+    }
+
+    /// Moves the cursor to the frame at `index`, moving the frames between
+    /// the old and new index to the other side of the gap.
+    fn move_to(&mut self, index: usize) -> &mut Self {
+        let gap_start = self.gap_start();
+        let gap_len = self.gap_len;
+        let new_start = index * self.num_channels;
+
+        if gap_len != 0 {
+            let values = self.values_mut();
+            if new_start < gap_start {
+                values.copy_within(new_start..gap_start, new_start + gap_len);
+            } else if new_start > gap_start {
+                values.copy_within(gap_start + gap_len..new_start + gap_len, gap_start);
+            }
+        }
+
+        self.index = index;
+        self
+    }
+
+    /// Makes sure that the gap has room for at least `additional` motion
+    /// values. The gap is grown geometrically, so inserting frames one at a
+    /// time only moves the frames after the cursor a few times.
+    fn reserve_gap(&mut self, additional: usize) {
+        if additional <= self.gap_len {
+            return;
+        }
+
+        let new_gap_len = max(
+            max(additional, 2 * self.gap_len),
+            MIN_GAP_FRAMES * self.num_channels,
+        );
+        let grow_by = new_gap_len - self.gap_len;
+        let gap_end = self.gap_start() + self.gap_len;
+
+        let values = self.values_mut();
+        let old_len = values.len();
+        values.resize(old_len + grow_by, 0.0);
+        values.copy_within(gap_end..old_len, gap_end + grow_by);
+
+        self.gap_len = new_gap_len;
+    }
+
+    /// Removes the gap from the motion values, so that they are contiguous,
+    /// and gives them back to the `Bvh`.
+    fn close_gap(&mut self) {
+        let mut values = match self.values.take() {
+            Some(values) => values,
+            None => return,
+        };
+
+        let gap_start = self.gap_start();
+        values.drain(gap_start..gap_start + self.gap_len);
+        self.gap_len = 0;
+        *self.motion_mut() = Motion::from_vec(values);
+    }
 }
 
 impl<'bvh> From<&'bvh mut Bvh> for FrameCursor<'bvh> {
     #[inline]
     fn from(bvh: &'bvh mut Bvh) -> Self {
-        Self { bvh, index: 0 }
+        Self {
+            num_channels: bvh.num_channels,
+            bvh: Some(bvh),
+            index: 0,
+            values: None,
+            gap_len: 0,
+        }
+    }
+}
+
+impl Drop for FrameCursor<'_> {
+    #[inline]
+    fn drop(&mut self) {
+        if self.bvh.is_some() {
+            self.close_gap();
+        }
     }
 }
 
@@ -544,57 +838,155 @@ impl<'bvh> From<FrameCursor<'bvh>> for FramesMut<'bvh> {
     }
 }
 
-/// A utility function which inserts the `slice` into the `vec` at the given `index`.
-///
-/// # Panics
-///
-/// Panics if `index` is out of bounds.
-fn vec_insert_slice<T: Clone + Default>(vec: &mut Vec<T>, index: usize, slice: &[T]) {
-    assert!(
-        index <= vec.len(),
-        "attempted to insert a slice at index {} into a vec of length {}",
-        index,
-        vec.len(),
-    );
+#[cfg(test)]
+mod tests {
+    use crate::Bvh;
+    use std::mem;
 
-    let spare_capacity = vec.capacity().saturating_sub(vec.len());
-    if slice.len() > spare_capacity {
-        vec.reserve(slice.len() - spare_capacity);
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+
+    /// Returns a single frame where every channel is `value`.
+    fn frame(bvh: &Bvh, value: f32) -> Vec<f32> {
+        vec![value; bvh.num_channels()]
     }
 
-    let old_len = vec.len();
-    let new_len = vec.len() + slice.len();
-    vec.resize_with(new_len, T::default);
+    #[test]
+    fn edits_match_vec_model() {
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let num_channels = bvh.num_channels();
+        let mut model = bvh
+            .frames()
+            .map(|f| f.as_slice().to_vec())
+            .collect::<Vec<_>>();
+
+        let mut cursor = bvh.frame_cursor();
+        let mut index = 0;
+        for step in 0..2000 {
+            match step % 7 {
+                0 | 1 => {
+                    let new_frame = vec![step as f32; num_channels];
+                    cursor.try_insert_frame(&new_frame).unwrap();
+                    model.insert(index, new_frame);
+                    index += 1;
+                }
+                2 => {
+                    if cursor.remove_frame().is_ok() {
+                        model.remove(index);
+                    } else {
+                        assert_eq!(index, model.len());
+                    }
+                }
+                3 => {
+                    cursor.move_next();
+                    index = (index + 1).min(model.len());
+                }
+                4 | 5 => {
+                    cursor.move_prev();
+                    index = index.saturating_sub(1);
+                }
+                _ => {
+                    let end = (index + 3).min(model.len());
+                    let start = end.saturating_sub(5);
+                    cursor.remove_frames(start..end).unwrap();
+                    model.drain(start..end);
+                    index = start;
+                }
+            }
 
-    // Move the existing items to the end
-    for (to_move, end_index) in (index..old_len).into_iter().zip(old_len + index..new_len) {
-        vec.swap(to_move, end_index);
-    }
+            assert_eq!(cursor.index(), index);
+            assert_eq!(cursor.len(), model.len());
+            assert_eq!(
+                cursor.peek_next().map(|f| f.as_slice().to_vec()),
+                model.get(index).cloned()
+            );
+            assert_eq!(
+                cursor.peek_prev().map(|f| f.as_slice().to_vec()),
+                index.checked_sub(1).map(|i| model[i].clone())
+            );
+        }
+        drop(cursor);
 
-    // Clone the slice into the new area
-    for (i, item) in slice.iter().enumerate() {
-        vec[i + index] = item.clone();
+        assert!(bvh.frames().map(|f| f.as_slice().to_vec()).eq(model));
     }
-}
-
-#[test]
-fn test_vec_insert_slice() {
-    let mut v;
-    let sl = &[100, 200, 300];
 
-    v = vec![1, 2, 3];
-    vec_insert_slice(&mut v, 0, sl);
-    assert_eq!(v, &[100, 200, 300, 1, 2, 3]);
+    #[test]
+    fn insert_frames_from_iter_at_cursor() {
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let mut expected = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let new_frames = (0..100).map(|i| frame(&bvh, i as f32)).collect::<Vec<_>>();
 
-    v = vec![1, 2, 3];
-    vec_insert_slice(&mut v, 1, sl);
-    assert_eq!(v, &[1, 100, 200, 300, 2, 3]);
+        let mut cursor = bvh.frame_cursor();
+        cursor.move_last();
+        for _ in 0..200 {
+            cursor.move_prev();
+        }
+        cursor.insert_frames_from_iter(&new_frames).unwrap();
+        assert_eq!(cursor.index(), 355);
+        assert_eq!(cursor.len(), 555);
+        let frames = cursor.into_frames();
+        assert_eq!(frames.len(), 200);
+
+        let mut cursor = expected.frame_cursor();
+        for _ in 0..255 {
+            cursor.move_next();
+        }
+        for new_frame in &new_frames {
+            cursor.try_insert_frame(new_frame).unwrap();
+        }
+        drop(cursor);
+        assert_eq!(bvh, expected);
+
+        let wrong_len = vec![0.0; bvh.num_channels() + 1];
+        let mut cursor = bvh.frame_cursor();
+        let result = cursor.insert_frames_from_iter(vec![frame(&expected, 1.0), wrong_len]);
+        assert!(result.is_err());
+        assert_eq!(cursor.len(), 556);
+    }
 
-    v = vec![1, 2, 3];
-    vec_insert_slice(&mut v, 2, sl);
-    assert_eq!(v, &[1, 2, 100, 200, 300, 3]);
+    #[test]
+    fn leaked_cursor_does_not_expose_the_gap() {
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let expected = bvh.clone();
+
+        // Editing frames in place leaves the frames in the `Bvh`.
+        let mut cursor = bvh.frame_cursor();
+        cursor.move_next();
+        cursor.peek_next_mut().unwrap().as_mut_slice()[0] += 0.0;
+        mem::forget(cursor);
+        assert_eq!(bvh, expected);
+
+        // Once there is a gap, leaking the cursor loses the frames instead of
+        // counting the gap as frames.
+        let new_frame = frame(&bvh, 1.0);
+        let mut cursor = bvh.frame_cursor();
+        cursor.move_next();
+        cursor.try_insert_frame(&new_frame).unwrap();
+        cursor.remove_frame().unwrap();
+        mem::forget(cursor);
+        assert_eq!(bvh.frames().len(), 0);
+        assert_eq!(bvh.num_channels(), expected.num_channels());
+
+        // The `Bvh` can still be edited afterwards.
+        bvh.frame_cursor().try_insert_frame(&new_frame).unwrap();
+        assert_eq!(bvh.frames().len(), 1);
+        assert_eq!(bvh.frames().next().unwrap().as_slice(), &new_frame[..]);
+    }
 
-    v = vec![1, 2, 3];
-    vec_insert_slice(&mut v, 3, sl);
-    assert_eq!(v, &[1, 2, 3, 100, 200, 300]);
+    #[test]
+    fn remove_frames_out_of_bounds() {
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let expected = bvh.clone();
+
+        let mut cursor = bvh.frame_cursor();
+        assert!(cursor.remove_frames(450..456).is_err());
+        assert!(cursor.remove_frames(..=455).is_err());
+        assert!(cursor.remove_frames(455..455).is_ok());
+        cursor.move_last();
+        assert!(cursor.remove_frame().is_err());
+        drop(cursor);
+        assert_eq!(bvh, expected);
+
+        bvh.frame_cursor().remove_frames(..).unwrap();
+        assert_eq!(bvh.frames().len(), 0);
+    }
 }
@@ -1,4 +1,8 @@
-use crate::{errors::SetMotionError, Channel};
+use crate::{
+    errors::SetMotionError,
+    motion::{Blocks, BlocksMut},
+    Channel,
+};
 use std::{
     borrow::{Borrow, BorrowMut},
     iter::{DoubleEndedIterator, ExactSizeIterator, FusedIterator, Iterator},
@@ -14,10 +18,33 @@ use std::{
 /// [`Bvh::frames`]: ../struct.Bvh.html#method.frames
 #[derive(Debug)]
 pub struct Frames<'a> {
-    /// Note: `chunks` is wrapped in an option because having a `ChunksExact`
-    /// iterator over 0-length chunks panics, and empty `Bvh`s have empty
-    /// frames.
-    pub(crate) chunks: Option<ChunksExact<'a, f32>>,
+    /// The blocks of motion values between `front` and `back`.
+    blocks: Blocks<'a>,
+    /// The frames remaining in the block at the front of the iterator.
+    front: Option<ChunksExact<'a, f32>>,
+    /// The frames remaining in the block at the back of the iterator.
+    back: Option<ChunksExact<'a, f32>>,
+    num_channels: usize,
+    /// The number of frames remaining.
+    len: usize,
+}
+
+impl<'a> Frames<'a> {
+    /// Create a `Frames` iterator over the frames of `num_channels` values in
+    /// each of `blocks`, which holds `num_values` values in total.
+    ///
+    /// Note: if `num_channels` is `0`, then the iterator is empty, because
+    /// a `ChunksExact` iterator over 0-length chunks panics.
+    #[inline]
+    pub(crate) fn new(blocks: Blocks<'a>, num_values: usize, num_channels: usize) -> Self {
+        Frames {
+            blocks,
+            front: None,
+            back: None,
+            num_channels,
+            len: num_values.checked_div(num_channels).unwrap_or(0),
+        }
+    }
 }
 
 impl<'a> Iterator for Frames<'a> {
@@ -25,29 +52,101 @@ impl<'a> Iterator for Frames<'a> {
 
     #[inline]
     fn next(&mut self) -> Option<Self::Item> {
-        self.chunks.as_mut().and_then(|c| c.next().map(Frame))
+        self.nth(0)
     }
 
     #[inline]
     fn size_hint(&self) -> (usize, Option<usize>) {
-        self.chunks
-            .as_ref()
-            .map(|c| c.size_hint())
-            .unwrap_or((0, Some(0)))
+        (self.len, Some(self.len))
+    }
+
+    fn nth(&mut self, mut n: usize) -> Option<Self::Item> {
+        if n >= self.len {
+            self.len = 0;
+            self.front = None;
+            self.back = None;
+            return None;
+        }
+
+        self.len -= n + 1;
+        loop {
+            if let Some(ref mut front) = self.front {
+                if n < front.len() {
+                    return front.nth(n).map(Frame);
+                }
+                n -= front.len();
+                self.front = None;
+            }
+
+            match self.blocks.peek_len() {
+                // Whole blocks are skipped without looking at their frames.
+                Some(len) if n >= len / self.num_channels => {
+                    n -= len / self.num_channels;
+                    self.blocks.next();
+                }
+                Some(_) => {
+                    self.front = self
+                        .blocks
+                        .next()
+                        .map(|block| block.chunks_exact(self.num_channels));
+                }
+                None => return self.back.as_mut().and_then(|back| back.nth(n)).map(Frame),
+            }
+        }
     }
 }
 
 impl<'a> DoubleEndedIterator for Frames<'a> {
     #[inline]
     fn next_back(&mut self) -> Option<Self::Item> {
-        self.chunks.as_mut().and_then(|c| c.next_back().map(Frame))
+        self.nth_back(0)
+    }
+
+    fn nth_back(&mut self, mut n: usize) -> Option<Self::Item> {
+        if n >= self.len {
+            self.len = 0;
+            self.front = None;
+            self.back = None;
+            return None;
+        }
+
+        self.len -= n + 1;
+        loop {
+            if let Some(ref mut back) = self.back {
+                if n < back.len() {
+                    return back.nth_back(n).map(Frame);
+                }
+                n -= back.len();
+                self.back = None;
+            }
+
+            match self.blocks.peek_back_len() {
+                Some(len) if n >= len / self.num_channels => {
+                    n -= len / self.num_channels;
+                    self.blocks.next_back();
+                }
+                Some(_) => {
+                    self.back = self
+                        .blocks
+                        .next_back()
+                        .map(|block| block.chunks_exact(self.num_channels));
+                }
+                None => {
+                    return self
+                        .front
+                        .as_mut()
+                        .and_then(|front| front.nth_back(n))
+                        .map(Frame)
+                }
+            }
+        }
     }
 }
 
 impl<'a> ExactSizeIterator for Frames<'a> {
     #[inline]
     fn len(&self) -> usize {
-        self.chunks.as_ref().map(|c| c.len()).unwrap_or(0)
+        self.len
     }
 }
 
@@ -55,15 +154,40 @@ impl<'a> FusedIterator for Frames<'a> {}
 
 /// A mutable iterator over the frames of a [`Bvh`].
 ///
-/// This type is created using the [`Bvh::frames_mut`] method.
+/// This type is created using the [`Bvh::frames_mut`] method. If the frames
+/// are shared with a clone of the `Bvh`, then each block of frames is copied
+/// when the iterator first reaches it, and blocks which are skipped over with
+/// [`Iterator::nth`] are not copied.
 ///
 /// [`Bvh`]: ../struct.Bvh.html
 /// [`Bvh::frames_mut`]: ../struct.Bvh.html#method.frames_mut
+/// [`Iterator::nth`]: https://doc.rust-lang.org/std/iter/trait.Iterator.html#method.nth
 #[derive(Debug)]
 pub struct FramesMut<'a> {
-    /// Note: `chunks` is wrapped in an option for the same reason
-    /// that `Frames<'_>`'s `chunks` is wrapped.
-    pub(crate) chunks: Option<ChunksExactMut<'a, f32>>,
+    /// The blocks of motion values between `front` and `back`.
+    blocks: BlocksMut<'a>,
+    /// The frames remaining in the block at the front of the iterator.
+    front: Option<ChunksExactMut<'a, f32>>,
+    /// The frames remaining in the block at the back of the iterator.
+    back: Option<ChunksExactMut<'a, f32>>,
+    num_channels: usize,
+    /// The number of frames remaining.
+    len: usize,
+}
+
+impl<'a> FramesMut<'a> {
+    /// Create a `FramesMut` iterator over the frames of `num_channels` values
+    /// in each of `blocks`, which holds `num_values` values in total.
+    #[inline]
+    pub(crate) fn new(blocks: BlocksMut<'a>, num_values: usize, num_channels: usize) -> Self {
+        FramesMut {
+            blocks,
+            front: None,
+            back: None,
+            num_channels,
+            len: num_values.checked_div(num_channels).unwrap_or(0),
+        }
+    }
 }
 
 impl<'a> Iterator for FramesMut<'a> {
@@ -71,31 +195,87 @@ impl<'a> Iterator for FramesMut<'a> {
 
     #[inline]
     fn next(&mut self) -> Option<Self::Item> {
-        self.chunks.as_mut().and_then(|c| c.next().map(FrameMut))
+        self.nth(0)
     }
 
     #[inline]
     fn size_hint(&self) -> (usize, Option<usize>) {
-        self.chunks
-            .as_ref()
-            .map(|c| c.size_hint())
-            .unwrap_or((0, Some(0)))
+        (self.len, Some(self.len))
+    }
+
+    fn nth(&mut self, mut n: usize) -> Option<Self::Item> {
+        if n >= self.len {
+            self.len = 0;
+            self.front = None;
+            self.back = None;
+            return None;
+        }
+
+        self.len -= n + 1;
+        loop {
+            if let Some(ref mut front) = self.front {
+                if n < front.len() {
+                    return front.nth(n).map(FrameMut);
+                }
+                n -= front.len();
+                self.front = None;
+            }
+
+            match self.blocks.peek_len() {
+                // Whole blocks are skipped without copying them.
+                Some(len) if n >= len / self.num_channels => {
+                    n -= len / self.num_channels;
+                    self.blocks.skip_block();
+                }
+                Some(_) => {
+                    self.front = self
+                        .blocks
+                        .next()
+                        .map(|block| block.chunks_exact_mut(self.num_channels));
+                }
+                None => {
+                    return self
+                        .back
+                        .as_mut()
+                        .and_then(|back| back.nth(n))
+                        .map(FrameMut)
+                }
+            }
+        }
     }
 }
 
 impl<'a> DoubleEndedIterator for FramesMut<'a> {
     #[inline]
     fn next_back(&mut self) -> Option<Self::Item> {
-        self.chunks
-            .as_mut()
-            .and_then(|c| c.next_back().map(FrameMut))
+        if self.len == 0 {
+            return None;
+        }
+
+        self.len -= 1;
+        loop {
+            if let Some(frame) = self.back.as_mut().and_then(|back| back.next_back()) {
+                return Some(FrameMut(frame));
+            }
+
+            match self.blocks.next_back() {
+                Some(block) => self.back = Some(block.chunks_exact_mut(self.num_channels)),
+                None => {
+                    return self
+                        .front
+                        .as_mut()
+                        .and_then(|f| f.next_back())
+                        .map(FrameMut)
+                }
+            }
+        }
     }
 }
 
 impl<'a> ExactSizeIterator for FramesMut<'a> {
     #[inline]
     fn len(&self) -> usize {
-        self.chunks.as_ref().map(|c| c.len()).unwrap_or(0)
+        self.len
     }
 }
 
@@ -105,7 +285,7 @@ impl<'a> FusedIterator for FramesMut<'a> {}
 ///
 /// [`Channel`]: ./struct.Channel.html
 #[derive(Clone, Copy, Debug, PartialEq)]
-pub struct Frame<'a>(&'a [f32]);
+pub struct Frame<'a>(pub(crate) &'a [f32]);
 
 impl<'a> Frame<'a> {
     /// Return the number of values in the `Frame`.
@@ -160,7 +340,7 @@ impl<'a, I: FrameIndex> Index<I> for Frame<'a> {
 ///
 /// [`Channel`]: ./struct.Channel.html
 #[derive(Debug, PartialEq)]
-pub struct FrameMut<'a>(&'a mut [f32]);
+pub struct FrameMut<'a>(pub(crate) &'a mut [f32]);
 
 impl<'a> FrameMut<'a> {
     /// Return the number of values in the `FrameMut`.
@@ -0,0 +1,538 @@
+//! Contains options for generating synthetic `bvh` files.
+//!
+//! Generated files are useful for testing and benchmarking at sizes well
+//! beyond those of the sample files. Generation is deterministic: the same
+//! [`GenerateOptions`][`GenerateOptions`] (including the seed) always produce
+//! the same skeleton and motion values.
+//!
+//! [`GenerateOptions`]: struct.GenerateOptions.html
+
+use crate::{motion::Motion, write::WriteOptions, Bvh, BvhLiteralBuilder, ChannelType};
+use std::{
+    f32::consts::PI,
+    fmt::Write as _,
+    io::{self, Write},
+    time::Duration,
+};
+
+/// The distribution that generated motion values are drawn from.
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub enum ValueDistribution {
+    /// Every motion value is the same.
+    Constant(f32),
+    /// Each motion value is drawn uniformly from `min..max`.
+    Uniform {
+        /// The smallest value which may be generated.
+        min: f32,
+        /// The upper bound of the generated values.
+        max: f32,
+    },
+    /// Each motion value is drawn from a normal distribution.
+    Normal {
+        /// The mean of the distribution.
+        mean: f32,
+        /// The standard deviation of the distribution.
+        std_dev: f32,
+    },
+    /// Each channel follows a sine wave with a random phase, so that the
+    /// values change smoothly from frame to frame, as in real motion.
+    Sine {
+        /// The amplitude of the sine waves.
+        amplitude: f32,
+        /// The number of frames in one period of the sine waves.
+        period: f32,
+    },
+}
+
+/// Specify the shape and contents of a generated `Bvh`.
+///
+/// # Examples
+///
+/// ```
+/// # use bvh_anim::generate::{GenerateOptions, ValueDistribution};
+/// let options = GenerateOptions::new()
+///     .with_seed(42)
+///     .with_num_joints(50)
+///     .with_num_frames(10)
+///     .with_motion_values(ValueDistribution::Sine {
+///         amplitude: 90.0,
+///         period: 60.0,
+///     });
+///
+/// let bvh = options.generate();
+/// assert_eq!(bvh.joints().count(), 50);
+/// assert_eq!(bvh.frames().len(), 10);
+/// assert_eq!(bvh, options.generate());
+/// ```
+///
+/// Large files can be streamed to disk without holding them in memory:
+///
+/// ```no_run
+/// # use bvh_anim::{generate::GenerateOptions, write::WriteOptions};
+/// # use std::{fs::File, io::BufWriter};
+/// let mut file = BufWriter::new(File::create("./big_anim.bvh")?);
+/// GenerateOptions::new()
+///     .with_num_frames(10_000_000)
+///     .write(&WriteOptions::new(), &mut file)?;
+/// # Result::<(), std::io::Error>::Ok(())
+/// ```
+#[derive(Clone, Debug, PartialEq)]
+pub struct GenerateOptions {
+    /// The seed of the random number generator.
+    pub seed: u64,
+    /// The number of joints in the skeleton, including the root.
+    ///
+    /// Fewer joints are generated if `max_depth` and `max_children` do not
+    /// allow for this many.
+    pub num_joints: usize,
+    /// The greatest depth of any joint, where the root joint has a depth of `0`.
+    pub max_depth: usize,
+    /// The greatest number of children of any joint.
+    pub max_children: usize,
+    /// The orders of channels to choose from for each joint.
+    ///
+    /// Each joint picks one of these at random. The root joint also has
+    /// `Xposition`, `Yposition` and `Zposition` channels before its chosen
+    /// channels.
+    pub channel_orders: Vec<Vec<ChannelType>>,
+    /// The largest magnitude of each component of a joint's offset.
+    pub bone_length: f32,
+    /// The number of frames to generate.
+    pub num_frames: usize,
+    /// The duration of each frame.
+    pub frame_time: Duration,
+    /// The distribution of the motion values.
+    pub motion_values: ValueDistribution,
+    #[doc(hidden)]
+    _nonexhaustive: (),
+}
+
+impl Default for GenerateOptions {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl GenerateOptions {
+    /// Create a new `GenerateOptions` with default values, which generates a
+    /// skeleton of 20 joints, with 100 frames of uniformly distributed angles.
+    #[inline]
+    pub fn new() -> Self {
+        GenerateOptions {
+            seed: 0,
+            num_joints: 20,
+            max_depth: 8,
+            max_children: 3,
+            channel_orders: vec![vec![
+                ChannelType::RotationZ,
+                ChannelType::RotationX,
+                ChannelType::RotationY,
+            ]],
+            bone_length: 10.0,
+            num_frames: 100,
+            frame_time: Duration::from_secs_f64(1.0 / 30.0),
+            motion_values: ValueDistribution::Uniform {
+                min: -180.0,
+                max: 180.0,
+            },
+            _nonexhaustive: (),
+        }
+    }
+
+    /// Sets `seed` on `self` to the new `seed`.
+    #[inline]
+    pub fn with_seed(self, seed: u64) -> Self {
+        Self { seed, ..self }
+    }
+
+    /// Sets `num_joints` on `self` to the new `num_joints`.
+    #[inline]
+    pub fn with_num_joints(self, num_joints: usize) -> Self {
+        Self { num_joints, ..self }
+    }
+
+    /// Sets `max_depth` on `self` to the new `max_depth`.
+    #[inline]
+    pub fn with_max_depth(self, max_depth: usize) -> Self {
+        Self { max_depth, ..self }
+    }
+
+    /// Sets `max_children` on `self` to the new `max_children`.
+    #[inline]
+    pub fn with_max_children(self, max_children: usize) -> Self {
+        Self {
+            max_children,
+            ..self
+        }
+    }
+
+    /// Sets `channel_orders` on `self` to the new `channel_orders`.
+    #[inline]
+    pub fn with_channel_orders<I>(self, channel_orders: I) -> Self
+    where
+        I: IntoIterator,
+        I::Item: AsRef<[ChannelType]>,
+    {
+        Self {
+            channel_orders: channel_orders
+                .into_iter()
+                .map(|order| order.as_ref().to_vec())
+                .collect(),
+            ..self
+        }
+    }
+
+    /// Sets `bone_length` on `self` to the new `bone_length`.
+    #[inline]
+    pub fn with_bone_length(self, bone_length: f32) -> Self {
+        Self {
+            bone_length,
+            ..self
+        }
+    }
+
+    /// Sets `num_frames` on `self` to the new `num_frames`.
+    #[inline]
+    pub fn with_num_frames(self, num_frames: usize) -> Self {
+        Self { num_frames, ..self }
+    }
+
+    /// Sets `frame_time` on `self` to the new `frame_time`.
+    #[inline]
+    pub fn with_frame_time(self, frame_time: Duration) -> Self {
+        Self { frame_time, ..self }
+    }
+
+    /// Sets `motion_values` on `self` to the new `ValueDistribution`.
+    #[inline]
+    pub fn with_motion_values(self, motion_values: ValueDistribution) -> Self {
+        Self {
+            motion_values,
+            ..self
+        }
+    }
+
+    /// Generate the complete `Bvh` in memory.
+    pub fn generate(&self) -> Bvh {
+        let mut bvh = self.generate_skeleton();
+        let num_channels = bvh.num_channels;
+
+        let mut motion = MotionGenerator::new(self, num_channels);
+        let mut values = vec![0.0; num_channels.saturating_mul(self.num_frames)];
+        if num_channels != 0 {
+            for frame in values.chunks_mut(num_channels) {
+                motion.fill_frame(frame);
+            }
+        }
+        bvh.motion = Motion::from_vec(values);
+
+        bvh
+    }
+
+    /// Generate only the skeleton, with no frames.
+    pub fn generate_skeleton(&self) -> Bvh {
+        let mut rng = SplitMix64::new(self.seed);
+        let mut builder = BvhLiteralBuilder::default();
+        builder.bvh.set_frame_time(self.frame_time);
+
+        if self.num_joints == 0 {
+            return builder.bvh;
+        }
+
+        // Grow a random tree by attaching each new joint to a random joint
+        // which still has room for children.
+        let mut depths = vec![0usize];
+        let mut children: Vec<Vec<usize>> = vec![vec![]];
+        let mut open = vec![];
+        if self.max_depth > 0 && self.max_children > 0 {
+            open.push(0);
+        }
+
+        while depths.len() < self.num_joints && !open.is_empty() {
+            let slot = rng.below(open.len());
+            let parent = open[slot];
+            let child = depths.len();
+
+            depths.push(depths[parent] + 1);
+            children.push(vec![]);
+            children[parent].push(child);
+
+            if children[parent].len() == self.max_children {
+                open.swap_remove(slot);
+            }
+            if depths[child] < self.max_depth {
+                open.push(child);
+            }
+        }
+
+        // Push the joints to the builder in depth-first order.
+        let mut name = String::new();
+        let mut stack = vec![0usize];
+        while let Some(joint) = stack.pop() {
+            name.clear();
+            if joint == 0 {
+                name.push_str("Root");
+                builder.push_root(&name);
+            } else {
+                let _ = write!(name, "Joint{}", joint);
+                builder.current_depth = depths[joint];
+                builder.push_joint(&name);
+            }
+
+            let offset = rng.offset(self.bone_length);
+            builder.push_joint_offset(offset, false);
+
+            if joint == 0 {
+                builder.push_channel(ChannelType::PositionX);
+                builder.push_channel(ChannelType::PositionY);
+                builder.push_channel(ChannelType::PositionZ);
+            }
+            if !self.channel_orders.is_empty() {
+                let order = &self.channel_orders[rng.below(self.channel_orders.len())];
+                for &channel in order {
+                    builder.push_channel(channel);
+                }
+            }
+
+            if joint != 0 && children[joint].is_empty() {
+                let end_site = rng.offset(self.bone_length);
+                builder.push_joint_offset(end_site, true);
+            }
+
+            stack.extend(children[joint].iter().rev());
+        }
+
+        builder.set_num_channels();
+        builder.bvh
+    }
+
+    /// Generate the `Bvh`, and output it to the `writer` with the given
+    /// `write_options`.
+    ///
+    /// The frames are generated and written one at a time, so the memory used
+    /// does not depend on the number of frames. The output is the same as
+    /// writing the result of [`generate`][`GenerateOptions::generate`].
+    ///
+    /// [`GenerateOptions::generate`]: struct.GenerateOptions.html#method.generate
+    pub fn write<W: Write>(&self, write_options: &WriteOptions, writer: &mut W) -> io::Result<()> {
+        let skeleton = self.generate_skeleton();
+        let num_channels = skeleton.num_channels;
+        write_options.write_header(&skeleton, self.num_frames, writer)?;
+
+        if num_channels == 0 {
+            return writer.flush();
+        }
+
+        let mut motion = MotionGenerator::new(self, num_channels);
+        let mut frame = vec![0.0; num_channels];
+        let mut chunk = Vec::new();
+        for _ in 0..self.num_frames {
+            motion.fill_frame(&mut frame);
+            chunk.clear();
+            write_options.frame_chunk(&frame, &mut chunk);
+            writer.write_all(&chunk)?;
+        }
+
+        writer.flush()
+    }
+}
+
+/// Generates the motion values of each frame in turn.
+struct MotionGenerator {
+    rng: SplitMix64,
+    distribution: ValueDistribution,
+    /// The phase of each channel, for the `Sine` distribution.
+    phases: Vec<f32>,
+    frame_index: usize,
+}
+
+impl MotionGenerator {
+    fn new(options: &GenerateOptions, num_channels: usize) -> Self {
+        // Use a separate stream from the skeleton, so that the skeleton does
+        // not depend on the number of frames.
+        let mut rng = SplitMix64::new(options.seed ^ 0x6d6f_7469_6f6e);
+
+        let phases = match options.motion_values {
+            ValueDistribution::Sine { .. } => (0..num_channels)
+                .map(|_| rng.next_f32() * 2.0 * PI)
+                .collect(),
+            _ => vec![],
+        };
+
+        MotionGenerator {
+            rng,
+            distribution: options.motion_values,
+            phases,
+            frame_index: 0,
+        }
+    }
+
+    fn fill_frame(&mut self, frame: &mut [f32]) {
+        match self.distribution {
+            ValueDistribution::Constant(value) => {
+                for motion in frame.iter_mut() {
+                    *motion = value;
+                }
+            }
+            ValueDistribution::Uniform { min, max } => {
+                for motion in frame.iter_mut() {
+                    *motion = self.rng.range(min, max);
+                }
+            }
+            ValueDistribution::Normal { mean, std_dev } => {
+                for motion in frame.iter_mut() {
+                    *motion = mean + std_dev * self.rng.standard_normal();
+                }
+            }
+            ValueDistribution::Sine { amplitude, period } => {
+                let t = 2.0 * PI * (self.frame_index as f32) / period;
+                for (motion, phase) in frame.iter_mut().zip(&self.phases) {
+                    *motion = amplitude * (t + phase).sin();
+                }
+            }
+        }
+
+        self.frame_index += 1;
+    }
+}
+
+/// A small, fast, seedable pseudo-random number generator.
+///
+/// See <http://xoshiro.di.unimi.it/splitmix64.c>.
+struct SplitMix64(u64);
+
+impl SplitMix64 {
+    #[inline]
+    fn new(seed: u64) -> Self {
+        SplitMix64(seed)
+    }
+
+    #[inline]
+    fn next_u64(&mut self) -> u64 {
+        self.0 = self.0.wrapping_add(0x9e37_79b9_7f4a_7c15);
+        let mut z = self.0;
+        z = (z ^ (z >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+        z ^ (z >> 31)
+    }
+
+    /// Returns a value in `0.0..1.0`.
+    #[inline]
+    fn next_f32(&mut self) -> f32 {
+        (self.next_u64() >> 40) as f32 / (1u64 << 24) as f32
+    }
+
+    /// Returns a value in `0..n`.
+    #[inline]
+    fn below(&mut self, n: usize) -> usize {
+        (self.next_u64() % n as u64) as usize
+    }
+
+    #[inline]
+    fn range(&mut self, min: f32, max: f32) -> f32 {
+        min + (max - min) * self.next_f32()
+    }
+
+    /// Returns a normally distributed value, using the Box-Muller transform.
+    #[inline]
+    fn standard_normal(&mut self) -> f32 {
+        let u1 = 1.0 - self.next_f32();
+        let u2 = self.next_f32();
+        (-2.0 * u1.ln()).sqrt() * (2.0 * PI * u2).cos()
+    }
+
+    #[inline]
+    fn offset(&mut self, bone_length: f32) -> [f32; 3] {
+        [
+            self.range(-bone_length, bone_length),
+            self.range(-bone_length, bone_length),
+            self.range(-bone_length, bone_length),
+        ]
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::{GenerateOptions, ValueDistribution};
+    use crate::{write::WriteOptions, ChannelType};
+
+    #[test]
+    fn generate_is_deterministic() {
+        let options = GenerateOptions::new().with_seed(7).with_num_joints(100);
+        assert_eq!(options.generate(), options.generate());
+        assert_ne!(options.generate(), options.clone().with_seed(8).generate());
+
+        // The skeleton does not depend on the number of frames.
+        assert_eq!(
+            options.generate_skeleton(),
+            options.clone().with_num_frames(5).generate_skeleton()
+        );
+    }
+
+    #[test]
+    fn generate_respects_shape() {
+        let options = GenerateOptions::new()
+            .with_num_joints(200)
+            .with_max_depth(4)
+            .with_max_children(5)
+            .with_channel_orders(&[[
+                ChannelType::RotationX,
+                ChannelType::RotationY,
+                ChannelType::RotationZ,
+            ]]);
+        let bvh = options.generate();
+
+        assert_eq!(bvh.joints().count(), 200);
+        assert_eq!(bvh.num_channels(), 3 + 200 * 3);
+        assert_eq!(bvh.frames().len(), 100);
+        let mut num_children = vec![0; 200];
+        for joint in bvh.joints() {
+            assert!(joint.data().depth() <= 4);
+            if let Some(parent) = joint.parent_index() {
+                num_children[parent] += 1;
+            }
+        }
+        assert!(num_children.iter().all(|&n| n <= 5));
+
+        // A binary tree of depth 2 has room for 7 joints.
+        let small = GenerateOptions::new()
+            .with_num_joints(100)
+            .with_max_depth(2)
+            .with_max_children(2)
+            .generate();
+        assert_eq!(small.joints().count(), 7);
+    }
+
+    #[test]
+    fn write_matches_generate() {
+        for &distribution in &[
+            ValueDistribution::Constant(1.5),
+            ValueDistribution::Uniform {
+                min: -10.0,
+                max: 10.0,
+            },
+            ValueDistribution::Normal {
+                mean: 0.0,
+                std_dev: 45.0,
+            },
+            ValueDistribution::Sine {
+                amplitude: 90.0,
+                period: 30.0,
+            },
+        ] {
+            let options = GenerateOptions::new()
+                .with_seed(3)
+                .with_num_frames(20)
+                .with_motion_values(distribution);
+            let write_options = WriteOptions::new();
+
+            let mut streamed = vec![];
+            options.write(&write_options, &mut streamed).unwrap();
+            assert_eq!(streamed, write_options.write_to_string(&options.generate()));
+
+            let parsed = crate::from_bytes(&streamed[..]).unwrap();
+            assert_eq!(parsed, options.generate());
+        }
+    }
+}
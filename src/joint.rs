@@ -4,13 +4,23 @@ use crate::Channel;
 use bstr::{BStr, BString, ByteSlice};
 use smallvec::SmallVec;
 use std::{
+    borrow::Borrow,
     cmp::{Ordering, PartialEq, PartialOrd},
+    collections::{HashMap, VecDeque},
     ffi::{CStr, CString},
-    fmt, mem,
+    fmt,
+    iter::FusedIterator,
+    mem,
     ops::{Deref, DerefMut},
-    str,
+    slice, str,
+    sync::OnceLock,
 };
 
+pub use crate::packed_skeleton::{
+    PackedChannels, PackedChildren, PackedJoint, PackedJoints, PackedSkeleton,
+};
+pub use crate::skeleton::{Skeleton, SkeletonCache};
+
 /// A 3-element point representing the location of a joint offset or
 /// end site.
 pub type Offset = [f32; 3];
@@ -167,6 +177,14 @@ impl JointData {
         }
     }
 
+    /// Consumes the `JointData`, returning its name.
+    #[inline]
+    pub(crate) fn into_name(self) -> JointName {
+        match self {
+            JointData::Root { name, .. } | JointData::Child { name, .. } => name,
+        }
+    }
+
     pub(crate) fn set_offset(&mut self, new_offset: impl Into<Offset>, is_site: bool) {
         let new_offset = new_offset.into();
         match *self {
@@ -239,6 +257,13 @@ impl DerefMut for JointName {
     }
 }
 
+impl Borrow<[u8]> for JointName {
+    #[inline]
+    fn borrow(&self) -> &[u8] {
+        &self.0[..]
+    }
+}
+
 impl<B: ?Sized + AsRef<[u8]>> PartialEq<B> for JointName {
     #[inline]
     fn eq(&self, rhs: &B) -> bool {
@@ -387,12 +412,176 @@ impl fmt::Debug for JointPrivateData {
     }
 }
 
+/// Lookup tables over the joints of a `Bvh`, which are built the first time they
+/// are needed.
+///
+/// The tables must be invalidated whenever the joints they were built from may
+/// have been modified.
+pub(crate) struct JointIndex {
+    /// A map from each joint name to the index of the first joint with that
+    /// name.
+    names: OnceLock<HashMap<JointName, usize>>,
+    children: OnceLock<ChildIndex>,
+    /// The hash of the joints, used to compare skeletons.
+    content_hash: OnceLock<u64>,
+}
+
+/// The children of every joint, stored in compressed sparse row form.
+///
+/// The children of the joint at index `i` are
+/// `children[offsets[i]..offsets[i + 1]]`, in the order they appear in the
+/// joints array.
+#[derive(Debug, Default)]
+struct ChildIndex {
+    offsets: Vec<usize>,
+    children: Vec<usize>,
+}
+
+impl ChildIndex {
+    /// Rebuilds the child lists from `joints`, reusing the memory which is
+    /// already allocated.
+    fn rebuild(&mut self, joints: &[JointData]) {
+        let ChildIndex {
+            ref mut offsets,
+            ref mut children,
+        } = *self;
+
+        // Count the children of each joint, then turn the counts into the
+        // offset of the first child of each joint.
+        offsets.clear();
+        offsets.resize(joints.len() + 1, 0);
+        for parent in joints.iter().filter_map(JointData::parent_index) {
+            offsets[parent + 1] += 1;
+        }
+        for i in 1..offsets.len() {
+            offsets[i] += offsets[i - 1];
+        }
+
+        // Place each child, using the offset of its parent as a cursor. This
+        // leaves the offset of each joint at the start of the next joint.
+        children.clear();
+        children.resize(offsets[joints.len()], 0);
+        for (index, joint) in joints.iter().enumerate() {
+            if let Some(parent) = joint.parent_index() {
+                children[offsets[parent]] = index;
+                offsets[parent] += 1;
+            }
+        }
+
+        for i in (1..offsets.len()).rev() {
+            offsets[i] = offsets[i - 1];
+        }
+        offsets[0] = 0;
+    }
+}
+
+impl JointIndex {
+    #[inline]
+    pub(crate) const fn new() -> Self {
+        JointIndex {
+            names: OnceLock::new(),
+            children: OnceLock::new(),
+            content_hash: OnceLock::new(),
+        }
+    }
+
+    /// Returns the index of the first joint in `joints` named `name`, building
+    /// the name map from `joints` if it has not been built yet.
+    #[inline]
+    pub(crate) fn find_name(&self, joints: &[JointData], name: &[u8]) -> Option<usize> {
+        self.names
+            .get_or_init(|| {
+                let mut map = HashMap::with_capacity(joints.len());
+                for (index, joint) in joints.iter().enumerate() {
+                    map.entry(JointName(joint.name().into())).or_insert(index);
+                }
+                map
+            })
+            .get(name)
+            .copied()
+    }
+
+    /// Returns the indices of the children of the joint at `index`, building
+    /// the child lists from `joints` if they have not been built yet.
+    #[inline]
+    pub(crate) fn children(&self, joints: &[JointData], index: usize) -> &[usize] {
+        let child_index = self.children.get_or_init(|| {
+            let mut child_index = ChildIndex::default();
+            child_index.rebuild(joints);
+            child_index
+        });
+        match child_index.offsets.get(index..index + 2) {
+            Some(&[start, end]) => &child_index.children[start..end],
+            _ => &[],
+        }
+    }
+
+    /// Returns the hash of the joints, calling `hash` to compute it if it has
+    /// not been computed yet.
+    #[inline]
+    pub(crate) fn content_hash<F: FnOnce() -> u64>(&self, hash: F) -> u64 {
+        *self.content_hash.get_or_init(hash)
+    }
+
+    /// Invalidates the tables, and rebuilds the child lists from `joints`
+    /// straight away, reusing the memory of the previous child lists.
+    pub(crate) fn rebuild_children(&mut self, joints: &[JointData]) {
+        self.names.take();
+        self.content_hash.take();
+        let mut child_index = self.children.take().unwrap_or_default();
+        child_index.rebuild(joints);
+        let _ = self.children.set(child_index);
+    }
+
+    /// Discards the tables, so that they are rebuilt on the next lookup.
+    #[inline]
+    pub(crate) fn invalidate(&mut self) {
+        self.names.take();
+        self.children.take();
+        self.content_hash.take();
+    }
+}
+
+impl Default for JointIndex {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Clone for JointIndex {
+    /// The clone is rebuilt lazily, as it is likely that the joints of the
+    /// clone are about to be modified.
+    #[inline]
+    fn clone(&self) -> Self {
+        Self::new()
+    }
+}
+
+impl PartialEq for JointIndex {
+    /// The tables are derived from the joints, so they never affect equality.
+    #[inline]
+    fn eq(&self, _: &Self) -> bool {
+        true
+    }
+}
+
+impl fmt::Debug for JointIndex {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str("JointIndex { .. }")
+    }
+}
+
 /// An iterator over the `Joint`s of a `Bvh` skeleton.
 pub struct Joints<'a> {
     pub(crate) joints: &'a [JointData],
-    // pub(crate) motion_values: &'a [f32],
+    /// The lookup tables of the `Bvh` which owns `joints`.
+    pub(crate) joint_index: &'a JointIndex,
     pub(crate) current_joint: usize,
-    pub(crate) from_child: Option<usize>,
+    /// The indices of the remaining children, if this iterates over the
+    /// children of a joint, rather than every joint.
+    pub(crate) children: Option<slice::Iter<'a, usize>>,
 }
 
 impl fmt::Debug for Joints<'_> {
@@ -404,12 +593,12 @@ impl fmt::Debug for Joints<'_> {
 
 impl<'a> Joints<'a> {
     /// Create a `Joints` iterator over all the `joints` in a `Bvh` file.
-    pub(crate) const fn iter_root(joints: &'a [JointData]) -> Self {
+    pub(crate) const fn iter_root(joints: &'a [JointData], joint_index: &'a JointIndex) -> Self {
         Joints {
             joints,
-            // clips,
+            joint_index,
             current_joint: 0,
-            from_child: None,
+            children: None,
         }
     }
 
@@ -421,63 +610,172 @@ impl<'a> Joints<'a> {
     /// need to iterate through to the end sites of all children, you will
     /// need to continually call `iter_children` on each `Joint` in the iterator.
     pub(crate) fn iter_children(joint: &Joint<'a>) -> Self {
-        let first_child = joint
-            .joints
-            .iter()
-            .find(|jd| {
-                if let Some(p) = jd.private_data() {
-                    p.parent_index == joint.index
-                } else {
-                    false
-                }
-            })
-            .map(JointData::index)
-            .unwrap();
-
         Joints {
             joints: joint.joints,
-            // clips: joint.clips,
-            current_joint: joint.data().index(),
-            from_child: Some(first_child),
+            joint_index: joint.joint_index,
+            current_joint: 0,
+            children: Some(joint.child_indices().iter()),
         }
     }
 
     /// Finds the `Joint` named `joint_name`, or `None` if it doesn't exist.
+    ///
+    /// Like [`Iterator::find`][`Iterator::find`], this consumes the joints up
+    /// to and including the joint which is found.
+    ///
+    /// # Notes
+    ///
+    /// When called on the iterator returned from [`Bvh::joints`][`Bvh::joints`],
+    /// the joint is found in constant time using a map from names to joints,
+    /// which is built on the first call, and kept by the `Bvh` until its joints
+    /// are next modified. Otherwise, each joint is compared in turn.
+    ///
+    /// [`Iterator::find`]: https://doc.rust-lang.org/std/iter/trait.Iterator.html#method.find
+    /// [`Bvh::joints`]: ../struct.Bvh.html#method.joints
     #[inline]
     pub fn find_by_name<B>(&mut self, joint_name: &B) -> Option<Joint<'a>>
     where
         B: ?Sized + AsRef<[u8]>,
     {
-        self.find(|b| b.data().name() == joint_name.as_ref())
+        let joint_name = joint_name.as_ref();
+        if self.children.is_none() {
+            match self.joint_index.find_name(self.joints, joint_name) {
+                // Joints which have already been passed can't be returned, but
+                // a later joint may have the same name.
+                Some(index) if index < self.current_joint => {}
+                Some(index) => {
+                    self.current_joint = index + 1;
+                    return Some(self.joint(index));
+                }
+                None => {
+                    self.current_joint = self.joints.len();
+                    return None;
+                }
+            }
+        }
+
+        self.find(|b| b.data().name() == joint_name)
     }
 
     #[allow(unused)]
     pub(crate) fn nth_child(joint: &Joint<'a>, child: usize) -> Option<usize> {
-        Joints::iter_children(joint)
-            .nth(child)
-            .map(|joint| joint.index)
+        joint.child_indices().get(child).copied()
+    }
+
+    #[inline]
+    fn joint(&self, index: usize) -> Joint<'a> {
+        Joint {
+            index,
+            joints: self.joints,
+            joint_index: self.joint_index,
+        }
     }
 }
 
 impl<'a> Iterator for Joints<'a> {
     type Item = Joint<'a>;
+
+    #[inline]
     fn next(&mut self) -> Option<Self::Item> {
-        if self.current_joint >= self.joints.len() {
-            return None;
-        }
+        let index = match self.children {
+            Some(ref mut children) => *children.next()?,
+            None if self.current_joint < self.joints.len() => {
+                self.current_joint += 1;
+                self.current_joint - 1
+            }
+            None => return None,
+        };
+
+        Some(self.joint(index))
+    }
+
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let len = match self.children {
+            Some(ref children) => children.len(),
+            None => self.joints.len().saturating_sub(self.current_joint),
+        };
+        (len, Some(len))
+    }
+}
+
+impl ExactSizeIterator for Joints<'_> {}
 
-        let joint = Some(Joint {
-            index: self.current_joint,
+impl FusedIterator for Joints<'_> {}
+
+/// A depth-first, pre-order iterator over a `Joint` and all of its descendants.
+///
+/// This type is created using the [`Joint::depth_first`] method.
+///
+/// [`Joint::depth_first`]: struct.Joint.html#method.depth_first
+pub struct DepthFirst<'a> {
+    joints: &'a [JointData],
+    joint_index: &'a JointIndex,
+    /// The joints which are still to be visited, with the next on top.
+    stack: Vec<usize>,
+}
+
+impl<'a> Iterator for DepthFirst<'a> {
+    type Item = Joint<'a>;
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        let index = self.stack.pop()?;
+        let children = self.joint_index.children(self.joints, index);
+        self.stack.extend(children.iter().rev());
+
+        Some(Joint {
+            index,
             joints: self.joints,
-        });
+            joint_index: self.joint_index,
+        })
+    }
+}
 
-        if self.from_child.is_none() {
-            self.current_joint += 1;
-        } else {
-            unimplemented!()
-        }
+impl FusedIterator for DepthFirst<'_> {}
 
-        joint
+impl fmt::Debug for DepthFirst<'_> {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str("DepthFirst { .. }")
+    }
+}
+
+/// A breadth-first iterator over a `Joint` and all of its descendants.
+///
+/// This type is created using the [`Joint::breadth_first`] method.
+///
+/// [`Joint::breadth_first`]: struct.Joint.html#method.breadth_first
+pub struct BreadthFirst<'a> {
+    joints: &'a [JointData],
+    joint_index: &'a JointIndex,
+    /// The joints which are still to be visited, with the next at the front.
+    queue: VecDeque<usize>,
+}
+
+impl<'a> Iterator for BreadthFirst<'a> {
+    type Item = Joint<'a>;
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        let index = self.queue.pop_front()?;
+        let children = self.joint_index.children(self.joints, index);
+        self.queue.extend(children.iter());
+
+        Some(Joint {
+            index,
+            joints: self.joints,
+            joint_index: self.joint_index,
+        })
+    }
+}
+
+impl FusedIterator for BreadthFirst<'_> {}
+
+impl fmt::Debug for BreadthFirst<'_> {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str("BreadthFirst { .. }")
     }
 }
 
@@ -533,6 +831,8 @@ pub struct Joint<'a> {
     pub(crate) index: usize,
     /// `Joints` array which the joint is part of.
     pub(crate) joints: &'a [JointData],
+    /// The lookup tables of the `Bvh` which owns `joints`.
+    pub(crate) joint_index: &'a JointIndex,
 }
 
 impl PartialEq for Joint<'_> {
@@ -543,7 +843,7 @@ impl PartialEq for Joint<'_> {
     }
 }
 
-impl Joint<'_> {
+impl<'a> Joint<'a> {
     /// Returns `true` if the `Joint` is the root `Joint`, or `false` if it isn't.
     ///
     /// # Examples
@@ -780,22 +1080,107 @@ impl Joint<'_> {
 
     /// Return the parent `Joint` if it exists, or `None` if it doesn't.
     #[inline]
-    pub fn parent(&self) -> Option<Joint<'_>> {
+    pub fn parent(&self) -> Option<Joint<'a>> {
         self.data().parent_index().map(|idx| Joint {
             index: idx,
             joints: self.joints,
+            joint_index: self.joint_index,
         })
     }
 
-    /// Returns an iterator over the children of `self`.
+    /// Returns an iterator over the direct children of `self`.
+    ///
+    /// The children of every joint are found once, and kept by the `Bvh`
+    /// until its joints are next modified, so this takes time proportional to
+    /// the number of children.
     #[inline]
-    pub fn children(&self) -> Joints<'_> {
-        Joints::iter_children(&self)
+    pub fn children(&self) -> Joints<'a> {
+        Joints::iter_children(self)
+    }
+
+    /// Returns a depth-first iterator over `self` and all of its descendants.
+    ///
+    /// Each joint is visited before its children, and each child's whole
+    /// subtree is visited before its next sibling.
+    ///
+    /// # Examples
+    ///
+    /// ```
+    /// # use bvh_anim::bvh;
+    /// let bvh = bvh! {
+    ///     HIERARCHY
+    ///     ROOT Hips
+    ///     {
+    ///         OFFSET 0.0 0.0 0.0
+    ///         CHANNELS 0
+    ///         JOINT Chest
+    ///         {
+    ///             OFFSET 0.0 0.0 0.0
+    ///             CHANNELS 0
+    ///             JOINT Neck
+    ///             {
+    ///                 OFFSET 0.0 0.0 0.0
+    ///                 CHANNELS 0
+    ///                 End Site
+    ///                 {
+    ///                     OFFSET 0.0 0.0 0.0
+    ///                 }
+    ///             }
+    ///         }
+    ///         JOINT Leg
+    ///         {
+    ///             OFFSET 0.0 0.0 0.0
+    ///             CHANNELS 0
+    ///             End Site
+    ///             {
+    ///                 OFFSET 0.0 0.0 0.0
+    ///             }
+    ///         }
+    ///     }
+    ///     MOTION
+    ///     Frames: 0
+    ///     Frame Time: 0.033333333
+    /// };
+    ///
+    /// let root = bvh.root_joint().unwrap();
+    /// let depth_first = root.depth_first().map(|j| j.name().to_vec()).collect::<Vec<_>>();
+    /// assert_eq!(depth_first, [&b"Hips"[..], b"Chest", b"Neck", b"Leg"]);
+    ///
+    /// let breadth_first = root.breadth_first().map(|j| j.name().to_vec()).collect::<Vec<_>>();
+    /// assert_eq!(breadth_first, [&b"Hips"[..], b"Chest", b"Leg", b"Neck"]);
+    /// ```
+    #[inline]
+    pub fn depth_first(&self) -> DepthFirst<'a> {
+        DepthFirst {
+            joints: self.joints,
+            joint_index: self.joint_index,
+            stack: vec![self.index],
+        }
+    }
+
+    /// Returns a breadth-first iterator over `self` and all of its descendants.
+    ///
+    /// Each joint is visited after every joint which is closer to `self`.
+    #[inline]
+    pub fn breadth_first(&self) -> BreadthFirst<'a> {
+        let mut queue = VecDeque::new();
+        queue.push_back(self.index);
+        BreadthFirst {
+            joints: self.joints,
+            joint_index: self.joint_index,
+            queue,
+        }
+    }
+
+    /// Returns the indices of the direct children of `self`.
+    #[inline]
+    pub(crate) fn child_indices(&self) -> &'a [usize] {
+        self.joint_index.children(self.joints, self.index)
     }
 
     /// Access a read-only view of the internal data of the `Joint`.
     #[inline]
-    pub(crate) const fn data(&self) -> &JointData {
+    pub(crate) const fn data(&self) -> &'a JointData {
         &self.joints[self.index]
     }
 }
@@ -850,3 +1235,95 @@ impl<'a> JointMut<'a> {
         &mut self.joints[self.index]
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use crate::Bvh;
+
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+
+    #[test]
+    fn find_by_name_matches_scan() {
+        let bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+
+        for joint in bvh.joints() {
+            let mut joints = bvh.joints();
+            let found = joints.find_by_name(joint.name()).unwrap();
+            assert_eq!(found.index(), joint.index());
+            assert_eq!(
+                joints.next().map(|j| j.index()),
+                bvh.joints().nth(joint.index() + 1).map(|j| j.index())
+            );
+        }
+
+        let mut joints = bvh.joints();
+        assert!(joints.find_by_name("NotAJoint").is_none());
+        assert!(joints.next().is_none());
+    }
+
+    #[test]
+    fn find_by_name_finds_later_duplicates() {
+        let text = std::str::from_utf8(BVH_BYTES).unwrap();
+        let bvh = Bvh::from_bytes(text.replace("JOINT RightCollar", "JOINT Chest2")).unwrap();
+
+        let mut joints = bvh.joints();
+        let first = joints.find_by_name("Chest2").unwrap();
+        let second = joints.find_by_name("Chest2").unwrap();
+        assert!(first.index() < second.index());
+        assert!(joints.find_by_name("Chest2").is_none());
+    }
+
+    #[test]
+    fn children_and_traversals() {
+        let bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+
+        for joint in bvh.joints() {
+            let expected = bvh
+                .joints()
+                .filter(|j| j.parent_index() == Some(joint.index()))
+                .map(|j| j.index())
+                .collect::<Vec<_>>();
+            let children = joint.children();
+            assert_eq!(children.len(), expected.len());
+            assert_eq!(children.map(|j| j.index()).collect::<Vec<_>>(), expected);
+        }
+
+        // The joints are stored in depth-first order.
+        let root = bvh.root_joint().unwrap();
+        assert!(root
+            .depth_first()
+            .map(|j| j.index())
+            .eq(bvh.joints().map(|j| j.index())));
+
+        let breadth_first = root
+            .breadth_first()
+            .map(|j| (j.data().depth(), j.index()))
+            .collect::<Vec<_>>();
+        let mut by_depth = breadth_first.clone();
+        by_depth.sort_by_key(|&(depth, _)| depth);
+        assert_eq!(breadth_first.len(), bvh.joints().len());
+        assert_eq!(breadth_first, by_depth);
+
+        // A subtree only contains the descendants of its root.
+        let chest = bvh.joints().find_by_name("Chest2").unwrap();
+        for joint in chest.depth_first().skip(1) {
+            let mut ancestor = joint.parent();
+            while ancestor.as_ref().map(|a| a.index()) != Some(chest.index()) {
+                ancestor = ancestor.expect("not a descendant").parent();
+            }
+        }
+        assert_eq!(chest.depth_first().count(), chest.breadth_first().count());
+    }
+
+    #[test]
+    fn reparsing_invalidates_name_index() {
+        let text = std::str::from_utf8(BVH_BYTES).unwrap();
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        assert!(bvh.joints().find_by_name("Chest2").is_some());
+
+        bvh.parse_from_bytes(text.replace("JOINT Chest2", "JOINT Back"))
+            .unwrap();
+        assert!(bvh.joints().find_by_name("Chest2").is_none());
+        assert!(bvh.joints().find_by_name("Back").is_some());
+    }
+}
@@ -125,6 +125,31 @@
 //!   also available as associated methods on the `Bvh` type directly as [`Bvh::from_reader`]
 //!   [`Bvh::from_reader`] and [`Bvh::from_bytes`][`Bvh::from_bytes`]
 //!
+//! * You can use the [`from_path`][`from_path`] function to load a `bvh` file from disk. This
+//!   reads the whole file at once, and parses it without copying each line. Very large files can be parsed on several threads
+//!   with [`Bvh::from_bytes_parallel`][`Bvh::from_bytes_parallel`].
+//!
+//! * You can use a [`MotionStream`][`MotionStream`] to load the hierarchy of a `bvh` file, and
+//!   then read its frames one batch at a time, without holding every frame in memory. If you
+//!   only need the joints and frame metadata, a [`BvhHeader`][`BvhHeader`] can be loaded without
+//!   reading any motion values at all.
+//!
+//! * You can use a [`BvhParser`][`BvhParser`] to parse a `bvh` file which arrives in chunks,
+//!   such as over a network connection. Each frame is available as soon as its line has been
+//!   fed to the parser, without waiting for the rest of the file. A [`PipelinedLoader`][`PipelinedLoader`]
+//!   uses one to parse each block of a file while the next block is read on another thread,
+//!   which helps when loading from slow storage.
+//!
+//! * With the `async` feature, you can use [`Bvh::from_async_reader`][`Bvh::from_async_reader`]
+//!   to load a `bvh` file from an `AsyncBufRead` without blocking the executor.
+//!
+//! * You can use the [`load_many`][`load_many`] function to load a whole directory of `bvh`
+//!   files on a pool of threads.
+//!
+//! * You can use the [`ParseOptions`][`ParseOptions`] type to load only some of the frames
+//!   or channels of a `bvh` file. The motion values which are not needed are skipped over
+//!   without being parsed.
+//!
 //! * You can use the [`bvh!`][`bvh!`] macro to construct a [`Bvh`][`Bvh`] instance in your source files
 //!   using the same syntax as you would use for a standard bvh file.
 //!
@@ -148,12 +173,25 @@
 //!   belonging to an associated [`Joint`][`Joint`] of the [`Bvh`][`Bvh`], although you can convert
 //!   it into an [`&[`][`slice`][`f32`][`f32`][`]`][`slice`] using the [`Frame::as_slice`][`Frame::as_slice`] method.
 //!
+//! * The [`Bvh::slice_frames`][`Bvh::slice_frames`] method returns a [`ClipView`][`ClipView`] of a
+//!   range of the frames of a [`Bvh`][`Bvh`], optionally skipping frames with a stride. A view
+//!   borrows the frames of the [`Bvh`][`Bvh`] rather than copying them, and can be written out in
+//!   the same way as a [`Bvh`][`Bvh`].
+//!
+//! * The [`Bvh::skeleton`][`Bvh::skeleton`] method returns the joint hierarchy of the
+//!   [`Bvh`][`Bvh`], which can be shared between many clips recorded on the same rig. A
+//!   [`SkeletonCache`][`SkeletonCache`] makes clips with equal skeletons share one copy.
+//!
 //! * You can serialise the [`Bvh`][`Bvh`] into a [`Write`][`Write`] type using the [`Bvh::write_to`]
 //!   [`Bvh::write_to`] method. There is also the [`Bvh::to_bstring`][`Bvh::to_bstring`] method, which
 //!   converts the [`Bvh`][`Bvh`] into a [`BString`][`BString`]. Various aspects of the formatting
 //!   can be customised using the [`WriteOptions`][`WriteOptions`] type, such as the line termination
 //!   style, indentation method, and floating point accuracy.
 //!
+//! * You can create synthetic [`Bvh`][`Bvh`] files of any size with the [`generate`][`generate`]
+//!   module, which is useful for testing at scale. Generated files can be written straight to
+//!   disk, one frame at a time.
+//!
 //! ## Examples
 //!
 //! This library comes with some example applications, which can be viewed on [Github][Github].
@@ -168,8 +206,17 @@
 //! [`bvh`]: struct.Bvh.html
 //! [`from_reader`]: fn.from_reader.html
 //! [`from_bytes`]: fn.from_bytes.html
+//! [`from_path`]: fn.from_path.html
+//! [`load_many`]: fn.load_many.html
+//! [`Bvh::from_async_reader`]: struct.Bvh.html#method.from_async_reader
 //! [`Bvh::from_reader`]: struct.Bvh.html#method.from_reader
 //! [`Bvh::from_bytes`]:  struct.Bvh.html#method.from_bytes
+//! [`Bvh::from_bytes_parallel`]: struct.Bvh.html#method.from_bytes_parallel
+//! [`MotionStream`]: struct.MotionStream.html
+//! [`BvhHeader`]: struct.BvhHeader.html
+//! [`BvhParser`]: struct.BvhParser.html
+//! [`ParseOptions`]: parse/struct.ParseOptions.html
+//! [`PipelinedLoader`]: parse/struct.PipelinedLoader.html
 //! [`bvh!`]: macro.bvh.html
 //! [`builder`]: builder/index.html
 //! [`Bvh::new`]: struct.Bvh.html#method.new
@@ -178,6 +225,10 @@
 //! [`Joint`]: struct.Joint.html
 //! [`JointData`]: enum.JointData.html
 //! [`Joint::data`]: struct.Joint.html#method.data
+//! [`Bvh::slice_frames`]: struct.Bvh.html#method.slice_frames
+//! [`ClipView`]: struct.ClipView.html
+//! [`Bvh::skeleton`]: struct.Bvh.html#method.skeleton
+//! [`SkeletonCache`]: joint/struct.SkeletonCache.html
 //! [`Bvh::frames`]: struct.Bvh.html#method.frames
 //! [`Frames`]: struct.Frames.html
 //! [`Frame`]: struct.Frame.html
@@ -190,6 +241,7 @@
 //! [`Bvh::to_bstring`]: struct.Bvh.html#method.to_bstring
 //! [`BString`]: https://docs.rs/bstr/0.1.2/bstr/struct.BString.html
 //! [`WriteOptions`]: write/struct.WriteOptions.html
+//! [`generate`]: generate/index.html
 //! [Github]: https://github.com/burtonageo/bvh_anim/tree/master/examples
 //! [bvh_html]: https://research.cs.wisc.edu/graphics/Courses/cs-838-1999/Jeff/BVH.html
 //! [CMU's motion capture database]: https://sites.google.com/a/cgspeed.com/cgspeed/motion-capture/daz-friendly-release
@@ -199,30 +251,40 @@ mod macros;
 
 pub mod errors;
 
+pub mod generate;
 pub mod write;
 
+mod aligned_motion;
+mod channel_major;
+mod clip_view;
 mod frame_cursor;
 mod frame_iter;
 pub mod joint;
-mod parse;
+mod motion;
+mod packed_skeleton;
+pub mod parse;
+mod skeleton;
 
 use crate::{
-    errors::{LoadError, ParseChannelError},
-    frames::{FrameCursor, Frames, FramesMut},
-    joint::{JointData, Offset},
-};
-use bstr::{
-    io::{BufReadExt, ByteLines},
-    BStr, ByteSlice,
+    errors::{LoadError, LoadJointsError, ParseChannelError, SetMotionError},
+    frames::{AlignedMotion, ChannelMajorMotion, FrameCursor, Frames, FramesMut},
+    joint::{Offset, Skeleton},
+    motion::Motion,
+    parse::{BatchLoader, EnumeratedLines},
 };
+use bstr::{io::BufReadExt, BStr, ByteSlice};
+#[cfg(feature = "mmap")]
+use std::fs::File;
 use std::{
     convert::TryFrom,
     fmt,
-    io::{self, Cursor, Write},
-    iter::Enumerate,
+    io::{self, Write},
     mem,
-    num::NonZeroUsize,
+    ops::RangeBounds,
+    path::{Path, PathBuf},
     str::{self, FromStr},
+    sync::Arc,
+    thread,
     time::Duration,
 };
 
@@ -230,77 +292,48 @@ pub mod frames {
     //! This module contains types and functions used for accessing and modifying
     //! frame data.
 
+    pub use crate::aligned_motion::{AlignedFrames, AlignedFramesMut, AlignedMotion};
+    pub use crate::channel_major::{ChannelMajorMotion, Tracks, TracksMut};
+    pub use crate::clip_view::ClipFrames;
     pub use crate::frame_cursor::FrameCursor;
     pub use crate::frame_iter::{Frame, FrameIndex, FrameMut, Frames, FramesMut};
 }
 
-pub use joint::{Joint, JointMut, Joints, JointsMut};
+pub use clip_view::ClipView;
+pub use joint::{BreadthFirst, DepthFirst, Joint, JointMut, Joints, JointsMut};
 #[doc(hidden)]
 pub use macros::BvhLiteralBuilder;
+pub use parse::{BvhHeader, BvhParser, LoadMany, MotionStream};
 
-struct CachedEnumerate<I> {
-    iter: Enumerate<I>,
-    last_enumerator: Option<usize>,
-}
-
-impl<I> CachedEnumerate<I> {
-    #[inline]
-    fn new(iter: Enumerate<I>) -> Self {
-        CachedEnumerate {
-            iter,
-            last_enumerator: None,
-        }
-    }
-
-    #[inline]
-    fn last_enumerator(&self) -> Option<usize> {
-        self.last_enumerator
-    }
-}
-
-impl<I: Iterator> Iterator for CachedEnumerate<I> {
-    type Item = <Enumerate<I> as Iterator>::Item;
-    #[inline]
-    fn next(&mut self) -> Option<Self::Item> {
-        let (curr, item) = self.iter.next()?;
-        self.last_enumerator = Some(curr);
-        Some((curr, item))
-    }
-
-    #[inline]
-    fn size_hint(&self) -> (usize, Option<usize>) {
-        self.iter.size_hint()
-    }
+/// Loads the `Bvh` from the `reader`.
+#[inline]
+pub fn from_reader<R: BufReadExt>(data: R) -> Result<Bvh, LoadError> {
+    Bvh::from_reader(data)
 }
 
-type EnumeratedLines<'a> = CachedEnumerate<ByteLines<&'a mut dyn BufReadExt>>;
-
-impl EnumeratedLines<'_> {
-    pub(crate) fn next_non_empty_line(&mut self) -> Option<<Self as Iterator>::Item> {
-        let mut next = self.next();
-        loop {
-            match next {
-                None => return None,
-                Some((idx, result)) => {
-                    let string = match result {
-                        Ok(s) => s,
-                        Err(e) => return Some((idx, Err(e))),
-                    };
-                    if string.trim().is_empty() {
-                        next = self.next()
-                    } else {
-                        return Some((idx, Ok(string)));
-                    }
-                }
-            }
-        }
-    }
+/// Loads the `Bvh` from the file at `path`.
+///
+/// See [`Bvh::from_path`][`Bvh::from_path`] for more information.
+///
+/// [`Bvh::from_path`]: struct.Bvh.html#method.from_path
+#[inline]
+pub fn from_path<P: AsRef<Path>>(path: P) -> Result<Bvh, LoadError> {
+    Bvh::from_path(path)
 }
 
-/// Loads the `Bvh` from the `reader`.
+/// Loads each of the files in `paths` in parallel, and returns an iterator over
+/// the results in the order in which the files finish loading.
+///
+/// See [`BatchLoader`][`BatchLoader`] for more information.
+///
+/// [`BatchLoader`]: parse/struct.BatchLoader.html
 #[inline]
-pub fn from_reader<R: BufReadExt>(data: R) -> Result<Bvh, LoadError> {
-    Bvh::from_reader(data)
+pub fn load_many<I>(paths: I) -> LoadMany
+where
+    I: IntoIterator,
+    I::Item: Into<PathBuf>,
+{
+    BatchLoader::new().load_many(paths)
 }
 
 /// Parse a sequence of bytes as if it were an in-memory `Bvh` file.
@@ -371,13 +404,23 @@ pub fn from_str(string: &str) -> Result<Bvh, LoadError> {
 ///
 /// See the [module documentation](index.html#using-this-library)
 /// for more information.
-#[derive(Clone, Debug, PartialEq)]
+///
+/// Cloning a `Bvh` is cheap: the clone shares its skeleton and frames with
+/// the original, and the frames are only copied when one of them is modified.
+/// Modifying frames through [`frames_mut`][`frames_mut`] or a
+/// [`FrameCursor`][`FrameCursor`] copies only the blocks of frames which are
+/// touched, while operations which insert or remove frames copy all of them.
+///
+/// [`frames_mut`]: struct.Bvh.html#method.frames_mut
+/// [`FrameCursor`]: frames/struct.FrameCursor.html
+#[derive(Clone, Debug)]
 pub struct Bvh {
-    /// The list of joints. If the root joint exists, it is always at
-    /// index `0`.
-    joints: Vec<JointData>,
-    /// The motion values of the `Frame`.
-    motion_values: Vec<f32>,
+    /// The joint hierarchy, which may be shared with other `Bvh`s. `None` is
+    /// an empty skeleton, so that `Bvh::new` does not need to allocate one.
+    skeleton: Option<Arc<Skeleton>>,
+    /// The motion values of the `Frame`, which may be shared with clones of
+    /// the `Bvh`.
+    motion: Motion,
     /// The number of `Channel`s in the bvh.
     num_channels: usize,
     /// The total time it takes to play one frame.
@@ -389,8 +432,8 @@ impl Bvh {
     #[inline]
     pub const fn new() -> Self {
         Self {
-            joints: Vec::new(),
-            motion_values: Vec::new(),
+            skeleton: None,
+            motion: Motion::new(),
             num_channels: 0,
             frame_time: Duration::from_secs(0),
         }
@@ -425,25 +468,147 @@ impl Bvh {
     /// ```
     #[inline]
     pub fn from_bytes<B: AsRef<[u8]>>(bytes: B) -> Result<Self, LoadError> {
-        Bvh::from_reader(Cursor::new(bytes))
+        Bvh::from_lines(EnumeratedLines::from_bytes(bytes.as_ref()))
+    }
+
+    /// Parse a sequence of bytes as if it were an in-memory `Bvh` file, using
+    /// up to `num_threads` threads to parse the motion values. If `num_threads`
+    /// is `0`, then the number of available cores is used.
+    ///
+    /// The motion section is split at line boundaries, and each part is parsed
+    /// on its own thread, which can be much faster for large files. The result
+    /// (including any error) is the same as calling [`Bvh::from_bytes`]
+    /// [`Bvh::from_bytes`]. Small files, and files which do not store exactly
+    /// one frame per line, are parsed on the current thread.
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// # use bvh_anim::Bvh;
+    /// let bytes = std::fs::read("./path/to/big_anim.bvh")?;
+    /// let bvh = Bvh::from_bytes_parallel(&bytes[..], 0)?;
+    /// # let _ = bvh;
+    /// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+    /// ```
+    ///
+    /// [`Bvh::from_bytes`]: struct.Bvh.html#method.from_bytes
+    #[inline]
+    pub fn from_bytes_parallel<B: AsRef<[u8]>>(
+        bytes: B,
+        num_threads: usize,
+    ) -> Result<Self, LoadError> {
+        let num_threads = match num_threads {
+            0 => thread::available_parallelism().map_or(1, |n| n.get()),
+            n => n,
+        };
+        Bvh::from_bytes_parallel_impl(bytes.as_ref(), num_threads)
     }
 
     /// Loads the `Bvh` from the `reader`.
     #[inline]
     pub fn from_reader<R: BufReadExt>(mut reader: R) -> Result<Self, LoadError> {
-        #[inline(never)]
-        fn from_reader_(reader: &mut dyn BufReadExt) -> Result<Bvh, LoadError> {
-            let mut lines = CachedEnumerate::new(reader.byte_lines().enumerate());
+        Bvh::from_lines(EnumeratedLines::from_reader(&mut reader))
+    }
 
-            let mut bvh = Bvh::default();
+    /// Clears `self`, and then loads a new `Bvh` from `reader` into it.
+    ///
+    /// This gives the same result as [`Bvh::from_reader`][`Bvh::from_reader`], but
+    /// reuses the memory already allocated by `self` for its joints, joint names and
+    /// motion values. When loading many similar clips one after another, reusing the
+    /// same `Bvh` means that almost no allocations are made after the first clip.
+    ///
+    /// If an error is returned, then `self` is left empty.
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// # use bvh_anim::Bvh;
+    /// use std::{fs::File, io::BufReader};
+    ///
+    /// let mut bvh = Bvh::new();
+    /// for path in &["./path/to/anim1.bvh", "./path/to/anim2.bvh"] {
+    ///     bvh.parse_from(BufReader::new(File::open(path)?))?;
+    ///     // use bvh...
+    /// }
+    /// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+    /// ```
+    ///
+    /// [`Bvh::from_reader`]: struct.Bvh.html#method.from_reader
+    #[inline]
+    pub fn parse_from<R: BufReadExt>(&mut self, mut reader: R) -> Result<(), LoadError> {
+        self.reparse_lines(EnumeratedLines::from_reader(&mut reader))
+    }
 
-            bvh.read_joints(&mut lines)?;
-            bvh.read_motion(&mut lines)?;
+    /// Clears `self`, and then parses the in-memory `bytes` into it, reusing
+    /// the memory already allocated by `self`.
+    ///
+    /// See [`Bvh::parse_from`][`Bvh::parse_from`] for more information.
+    ///
+    /// [`Bvh::parse_from`]: struct.Bvh.html#method.parse_from
+    #[inline]
+    pub fn parse_from_bytes<B: AsRef<[u8]>>(&mut self, bytes: B) -> Result<(), LoadError> {
+        self.reparse_lines(EnumeratedLines::from_bytes(bytes.as_ref()))
+    }
 
-            Ok(bvh)
-        }
+    /// Loads the `Bvh` from the file at `path`.
+    ///
+    /// The file is read into memory in one go, and each line is then parsed
+    /// directly from that buffer without being copied. This gives the same result as calling
+    /// [`Bvh::from_reader`][`Bvh::from_reader`] on the file, but is usually faster.
+    ///
+    /// # Examples
+    ///
+    /// ```no_run
+    /// # use bvh_anim::Bvh;
+    /// let bvh = Bvh::from_path("./path/to/anim.bvh")?;
+    /// # let _ = bvh;
+    /// # Result::<(), bvh_anim::errors::LoadError>::Ok(())
+    /// ```
+    ///
+    /// [`Bvh::from_reader`]: struct.Bvh.html#method.from_reader
+    #[inline]
+    pub fn from_path<P: AsRef<Path>>(path: P) -> Result<Self, LoadError> {
+        let bytes = std::fs::read(path).map_err(LoadJointsError::Io)?;
+        Bvh::from_bytes(bytes)
+    }
+
+    /// Memory-maps `file` and parses the `Bvh` straight from the mapped bytes.
+    ///
+    /// This method is only available with the `mmap` feature. Unlike
+    /// [`Bvh::from_path`][`Bvh::from_path`], it does not copy the file into
+    /// memory first.
+    ///
+    /// # Safety
+    ///
+    /// The file must not be truncated or written to, by this process or by any
+    /// other, until this function returns. If it is, then the parser may read
+    /// values which change underneath it, or the process may be killed with
+    /// `SIGBUS` when it reads past the new end of the file.
+    ///
+    /// [`Bvh::from_path`]: struct.Bvh.html#method.from_path
+    #[cfg(feature = "mmap")]
+    #[allow(unsafe_code)]
+    pub unsafe fn from_mmap(file: &File) -> Result<Self, LoadError> {
+        // Safety: the caller guarantees that the file is not modified while
+        // it is mapped, and the mapping does not outlive this function.
+        let map = memmap2::Mmap::map(file).map_err(LoadJointsError::Io)?;
+        Bvh::from_bytes(&map[..])
+    }
 
-        from_reader_(reader.by_ref())
+    /// Returns a future which loads the `Bvh` from the asynchronous `reader`,
+    /// yielding to the executor regularly while the motion is parsed.
+    ///
+    /// This method is only available with the `async` feature. To change how
+    /// often the future yields, see the [`AsyncLoader`][`AsyncLoader`] type.
+    ///
+    /// [`AsyncLoader`]: parse/struct.AsyncLoader.html
+    #[cfg(feature = "async")]
+    #[inline]
+    pub fn from_async_reader<R>(reader: R) -> parse::LoadAsync<R>
+    where
+        R: futures_io::AsyncBufRead + Unpin,
+    {
+        parse::AsyncLoader::new().load(reader)
     }
 
     /// Writes the `Bvh` using the `bvh` file format to the `writer`, with
@@ -521,26 +686,76 @@ impl Bvh {
     /// ```
     #[inline]
     pub fn root_joint(&self) -> Option<Joint<'_>> {
-        if self.joints.is_empty() {
-            None
-        } else {
-            Some(Joint {
-                index: 0,
-                joints: &self.joints[..],
-            })
-        }
+        self.skeleton().root_joint()
     }
 
     /// Returns an iterator over all the `Joint`s in the `Bvh`.
     #[inline]
     pub fn joints(&self) -> Joints<'_> {
-        Joints::iter_root(&self.joints[..])
+        self.skeleton().joints()
     }
 
     /// Returns a mutable iterator over all the joints in the `Bvh`.
+    ///
+    /// If the skeleton of `self` is shared with another `Bvh`, then it is
+    /// copied first, so that the other `Bvh` is not modified.
     #[inline]
     pub fn joints_mut(&mut self) -> JointsMut<'_> {
-        JointsMut::iter_root(&mut self.joints[..])
+        JointsMut::iter_root(&mut self.skeleton_mut().joints_mut()[..])
+    }
+
+    /// Returns the skeleton of the `Bvh`, which may be shared with other
+    /// `Bvh`s.
+    ///
+    /// Two `Bvh`s which share a skeleton were recorded on the same rig, which
+    /// can be checked with [`Arc::ptr_eq`][`Arc::ptr_eq`]. Skeletons can be
+    /// shared between `Bvh`s with a [`SkeletonCache`][`SkeletonCache`].
+    ///
+    /// [`Arc::ptr_eq`]: https://doc.rust-lang.org/std/sync/struct.Arc.html#method.ptr_eq
+    /// [`SkeletonCache`]: joint/struct.SkeletonCache.html
+    #[inline]
+    pub fn skeleton(&self) -> &Arc<Skeleton> {
+        self.skeleton.as_ref().unwrap_or_else(|| Skeleton::empty())
+    }
+
+    /// Replaces the skeleton of the `Bvh` with `skeleton`, which is usually
+    /// equal to the current skeleton, but shared with another `Bvh`.
+    ///
+    /// # Errors
+    ///
+    /// If `skeleton` does not have the same number of channels as `self`,
+    /// then `self` is not modified, and `SetMotionError::ChannelCountMismatch`
+    /// is returned.
+    pub fn set_skeleton(&mut self, skeleton: Arc<Skeleton>) -> Result<(), SetMotionError> {
+        let num_channels = skeleton.num_channels();
+        if num_channels != self.num_channels {
+            return Err(SetMotionError::ChannelCountMismatch {
+                expected: self.num_channels,
+                actual: num_channels,
+            });
+        }
+
+        self.skeleton = Some(skeleton);
+        Ok(())
+    }
+
+    /// Returns the skeleton for modification, copying it first if it is
+    /// shared.
+    #[inline]
+    pub(crate) fn skeleton_mut(&mut self) -> &mut Skeleton {
+        Arc::make_mut(self.skeleton.get_or_insert_with(Arc::default))
+    }
+
+    /// Returns the skeleton so that it can be overwritten. Its memory is
+    /// reused if it is not shared, and otherwise it is replaced with a new
+    /// skeleton.
+    #[inline]
+    pub(crate) fn skeleton_to_overwrite(&mut self) -> &mut Skeleton {
+        let skeleton = self.skeleton.get_or_insert_with(Arc::default);
+        if Arc::get_mut(skeleton).is_none() {
+            *skeleton = Arc::default();
+        }
+        Arc::get_mut(skeleton).expect("the skeleton is not shared")
     }
 
     /// Returns a `Frames` iterator over the frames of the bvh.
@@ -560,13 +775,35 @@ impl Bvh {
     /// ```
     #[inline]
     pub fn frames(&self) -> Frames<'_> {
-        Frames {
-            chunks: NonZeroUsize::new(self.num_channels).map(|_| {
-                self.motion_values
-                    .as_slice()
-                    .chunks_exact(self.num_channels)
-            }),
-        }
+        Frames::new(self.motion.blocks(), self.motion.len(), self.num_channels)
+    }
+
+    /// Returns a [`ClipView`][`ClipView`] of the frames of the bvh in `range`,
+    /// which shares the skeleton and motion values of the bvh instead of
+    /// copying them.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the start of `range` is greater than its end, or if its end is
+    /// greater than the number of frames in the bvh.
+    ///
+    /// # Example
+    ///
+    /// ```
+    /// # use bvh_anim::Bvh;
+    /// const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    /// let bvh = Bvh::from_bytes(BVH_BYTES)?;
+    ///
+    /// let window = bvh.slice_frames(10..20);
+    /// assert_eq!(window.frames().len(), 10);
+    /// assert!(window.frames().eq(bvh.frames().skip(10).take(10)));
+    /// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+    /// ```
+    ///
+    /// [`ClipView`]: struct.ClipView.html
+    #[inline]
+    pub fn slice_frames<R: RangeBounds<usize>>(&self, range: R) -> ClipView<'_> {
+        ClipView::new(self, range)
     }
 
     /// Returns a mutable iterator over the frames of the bvh.
@@ -586,13 +823,81 @@ impl Bvh {
     /// ```
     #[inline]
     pub fn frames_mut(&mut self) -> FramesMut<'_> {
-        FramesMut {
-            chunks: NonZeroUsize::new(self.num_channels).map(move |_| {
-                self.motion_values
-                    .as_mut_slice()
-                    .chunks_exact_mut(self.num_channels)
-            }),
+        let num_values = self.motion.len();
+        FramesMut::new(
+            self.motion.blocks_mut(self.num_channels),
+            num_values,
+            self.num_channels,
+        )
+    }
+
+    /// Copies the motion values of the `Bvh` into a new [`ChannelMajorMotion`],
+    /// which stores the values of each channel together.
+    ///
+    /// This is useful for passes which process one channel at a time. To reuse
+    /// an existing `ChannelMajorMotion`, see
+    /// [`ChannelMajorMotion::copy_from_frame_major`][`ChannelMajorMotion::copy_from_frame_major`].
+    ///
+    /// [`ChannelMajorMotion`]: frames/struct.ChannelMajorMotion.html
+    /// [`ChannelMajorMotion::copy_from_frame_major`]: frames/struct.ChannelMajorMotion.html#method.copy_from_frame_major
+    #[inline]
+    pub fn to_channel_major(&self) -> ChannelMajorMotion {
+        ChannelMajorMotion::from_frame_major(&self.motion.values(), self.num_channels)
+    }
+
+    /// Replaces the motion values of the `Bvh` with the values in `motion`,
+    /// which may have a different number of frames.
+    ///
+    /// # Errors
+    ///
+    /// Returns `SetMotionError::ChannelCountMismatch` if `motion` does not have
+    /// the same number of channels as the `Bvh`. The `Bvh` is not modified in
+    /// this case.
+    pub fn set_channel_major_motion(
+        &mut self,
+        motion: &ChannelMajorMotion,
+    ) -> Result<(), SetMotionError> {
+        if motion.num_channels() != self.num_channels {
+            return Err(SetMotionError::ChannelCountMismatch {
+                expected: self.num_channels,
+                actual: motion.num_channels(),
+            });
         }
+
+        motion.to_frame_major_into(self.motion.vec_mut());
+        Ok(())
+    }
+
+    /// Copies the motion values of the `Bvh` into a new [`AlignedMotion`], in
+    /// which every frame starts on a cache line, and is padded with zeroes to a
+    /// whole number of cache lines.
+    ///
+    /// This is useful for per-frame kernels which use aligned SIMD loads.
+    ///
+    /// [`AlignedMotion`]: frames/struct.AlignedMotion.html
+    #[inline]
+    pub fn to_aligned_motion(&self) -> AlignedMotion {
+        AlignedMotion::from_frame_major(&self.motion.values(), self.num_channels)
+    }
+
+    /// Replaces the motion values of the `Bvh` with the values in `motion`,
+    /// which may have a different number of frames.
+    ///
+    /// # Errors
+    ///
+    /// Returns `SetMotionError::ChannelCountMismatch` if `motion` does not have
+    /// the same number of channels as the `Bvh`. The `Bvh` is not modified in
+    /// this case.
+    pub fn set_aligned_motion(&mut self, motion: &AlignedMotion) -> Result<(), SetMotionError> {
+        if motion.num_channels() != self.num_channels {
+            return Err(SetMotionError::ChannelCountMismatch {
+                expected: self.num_channels,
+                actual: motion.num_channels(),
+            });
+        }
+
+        motion.to_frame_major_into(self.motion.vec_mut());
+        Ok(())
     }
 
     /// Removes all frame data from the `Bvh`, returning the previous frames.
@@ -626,7 +931,7 @@ impl Bvh {
     /// ```
     #[inline]
     pub fn extract_frames(&mut self) -> Vec<f32> {
-        mem::take(&mut self.motion_values)
+        mem::take(self.motion.vec_mut())
     }
 
     /// Get the number of frames in the `Bvh`.
@@ -704,6 +1009,18 @@ impl Default for Bvh {
     }
 }
 
+impl PartialEq for Bvh {
+    /// Compares the skeletons by value, so that a `Bvh` without a skeleton is
+    /// equal to one with an empty skeleton.
+    #[inline]
+    fn eq(&self, other: &Self) -> bool {
+        self.num_channels == other.num_channels
+            && self.frame_time == other.frame_time
+            && self.skeleton() == other.skeleton()
+            && self.motion == other.motion
+    }
+}
+
 impl FromStr for Bvh {
     type Err = LoadError;
     #[inline]
@@ -419,6 +419,7 @@ pub struct BvhLiteralBuilder {
     pub current_channel_index: usize,
     pub current_depth: usize,
     pub current_index: usize,
+    pub last_index_at_depth: Vec<usize>,
 }
 
 #[doc(hidden)]
@@ -426,25 +427,20 @@ impl BvhLiteralBuilder {
     pub fn push_root(&mut self, name: &str) {
         let mut root = JointData::empty_root();
         root.set_name(name);
-        self.bvh.joints.push(root);
+        self.bvh.skeleton_mut().joints_mut().push(root);
+        self.last_index_at_depth.clear();
+        self.last_index_at_depth.push(self.current_index);
         self.current_index += 1;
     }
 
     pub fn push_joint(&mut self, name: &str) {
-        // @TODO: make this shared
-        #[inline]
-        fn get_parent_index(joints: &[JointData], for_depth: usize) -> usize {
-            joints
-                .iter()
-                .rev()
-                .find(|jd| jd.depth() == for_depth.saturating_sub(1))
-                .and_then(|jd| jd.private_data().map(|p| p.self_index))
-                .unwrap_or(0)
-        }
-
         let idx = self.current_index;
         let dpth = self.current_depth;
-        let parent = get_parent_index(&self.bvh.joints[..], dpth);
+        let parent = self
+            .last_index_at_depth
+            .get(dpth.saturating_sub(1))
+            .copied()
+            .unwrap_or(0);
 
         let mut joint = JointData::empty_child();
         joint.set_name(name);
@@ -454,7 +450,12 @@ impl BvhLiteralBuilder {
             private.parent_index = parent;
         };
 
-        self.bvh.joints.push(joint);
+        self.bvh.skeleton_mut().joints_mut().push(joint);
+
+        // The most recent joint at each depth is the parent of any joint
+        // pushed at the next depth down.
+        self.last_index_at_depth.resize(dpth, 0);
+        self.last_index_at_depth.push(idx);
 
         self.current_index += 1;
     }
@@ -489,7 +490,7 @@ impl BvhLiteralBuilder {
 
     #[inline]
     fn last_joint(&mut self) -> Option<&mut JointData> {
-        self.bvh.joints.last_mut()
+        self.bvh.skeleton_mut().joints_mut().last_mut()
     }
 }
 
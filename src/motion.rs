@@ -0,0 +1,594 @@
+//! Copy-on-write storage for the motion values of a `Bvh`.
+
+use std::{
+    borrow::Cow,
+    fmt, mem,
+    ops::Range,
+    slice::{self, Chunks, ChunksMut},
+    sync::Arc,
+};
+
+/// The number of frames in each block of motion values which is copied on
+/// write.
+pub(crate) const BLOCK_FRAMES: usize = 256;
+
+/// The motion values of a `Bvh`, stored so that cloning them is cheap.
+///
+/// The values are held in a reference-counted `base` buffer, which is shared
+/// by every clone. When a clone is modified while `base` is shared, the
+/// modified values are split into blocks of `BLOCK_FRAMES` frames, and only
+/// the blocks which are modified are copied into `blocks`. A clone therefore
+/// costs one reference count for `base` and one for each copied block.
+///
+/// Operations which change the number of frames first make the values
+/// contiguous and unshared again with [`Motion::vec_mut`], which copies a
+/// shared clip once.
+#[derive(Clone)]
+pub(crate) struct Motion {
+    /// The motion values, in frame-major order. `None` holds no values, so
+    /// that an empty `Motion` can be created without allocating.
+    base: Option<Arc<Vec<f32>>>,
+    /// Either empty, or one entry for each block of `base`. A block which has
+    /// been modified while `base` was shared holds its own copy of the values
+    /// of that block, which take the place of the values in `base`.
+    blocks: Vec<Option<Arc<Vec<f32>>>>,
+    /// The number of motion values in each block, if `blocks` is not empty.
+    block_len: usize,
+}
+
+impl Motion {
+    #[inline]
+    pub(crate) const fn new() -> Self {
+        Motion {
+            base: None,
+            blocks: Vec::new(),
+            block_len: 0,
+        }
+    }
+
+    #[inline]
+    pub(crate) fn from_vec(values: Vec<f32>) -> Self {
+        Motion {
+            base: Some(Arc::new(values)),
+            blocks: Vec::new(),
+            block_len: 0,
+        }
+    }
+
+    /// Returns the total number of motion values.
+    #[inline]
+    pub(crate) fn len(&self) -> usize {
+        self.base().len()
+    }
+
+    #[inline]
+    pub(crate) fn is_empty(&self) -> bool {
+        self.base().is_empty()
+    }
+
+    /// Returns the number of blocks which hold their own copy of their values.
+    #[cfg(test)]
+    #[inline]
+    pub(crate) fn num_copied_blocks(&self) -> usize {
+        self.blocks.iter().filter(|block| block.is_some()).count()
+    }
+
+    /// Returns all of the motion values in one slice, which is only copied if
+    /// some of the blocks have been copied.
+    pub(crate) fn values(&self) -> Cow<'_, [f32]> {
+        if self.blocks.iter().all(Option::is_none) {
+            return Cow::Borrowed(self.base());
+        }
+
+        let mut values = self.base().to_vec();
+        self.copy_blocks_into(&mut values);
+        Cow::Owned(values)
+    }
+
+    /// Returns the motion values in `range`, which must not cross the boundary
+    /// of a block. A range which holds a single frame never does.
+    #[inline]
+    pub(crate) fn range(&self, range: Range<usize>) -> &[f32] {
+        match self.copied_block(range.start) {
+            Some((block_start, block)) => {
+                &block[range.start - block_start..range.end - block_start]
+            }
+            None => &self.base()[range],
+        }
+    }
+
+    /// Returns the motion values in `range` for modification, which must not
+    /// cross the boundary of a block. If the values are shared, then only the
+    /// block containing `range` is copied.
+    pub(crate) fn range_mut(&mut self, range: Range<usize>, num_channels: usize) -> &mut [f32] {
+        if self.blocks.is_empty() {
+            if Arc::get_mut(self.base_mut()).is_some() {
+                return &mut Arc::get_mut(self.base_mut()).expect("the values are not shared")
+                    [range];
+            }
+            self.split_into_blocks(num_channels);
+        }
+
+        let index = range.start / self.block_len;
+        let block_start = index * self.block_len;
+        if self.blocks[index].is_none() {
+            if Arc::get_mut(self.base_mut()).is_some() {
+                return &mut Arc::get_mut(self.base_mut()).expect("the values are not shared")
+                    [range];
+            }
+
+            let block_end = (block_start + self.block_len).min(self.base().len());
+            self.blocks[index] = Some(Arc::new(self.base()[block_start..block_end].to_vec()));
+        }
+
+        let block = self.blocks[index]
+            .as_mut()
+            .expect("the block was copied above");
+        &mut Arc::make_mut(block)[range.start - block_start..range.end - block_start]
+    }
+
+    /// Returns the motion values as a single `Vec` which is not shared, so
+    /// that its length can be changed. The values are copied if they are
+    /// shared.
+    pub(crate) fn vec_mut(&mut self) -> &mut Vec<f32> {
+        if Arc::get_mut(self.base_mut()).is_none() {
+            let mut values = self.base().to_vec();
+            self.copy_blocks_into(&mut values);
+            self.base = Some(Arc::new(values));
+        } else if !self.blocks.is_empty() {
+            let base = Arc::get_mut(self.base_mut()).expect("the values are not shared");
+            let mut values = mem::take(base);
+            self.copy_blocks_into(&mut values);
+            *Arc::get_mut(self.base_mut()).expect("the values are not shared") = values;
+        }
+
+        self.blocks.clear();
+        self.block_len = 0;
+        Arc::get_mut(self.base_mut()).expect("the values are not shared")
+    }
+
+    /// Removes every motion value, reusing the memory of the values if they
+    /// are not shared.
+    #[inline]
+    pub(crate) fn clear(&mut self) {
+        self.blocks.clear();
+        self.block_len = 0;
+        match self.base.as_mut().and_then(Arc::get_mut) {
+            Some(values) => values.clear(),
+            None => self.base = None,
+        }
+    }
+
+    /// Returns an iterator over the blocks of motion values.
+    #[inline]
+    pub(crate) fn blocks(&self) -> Blocks<'_> {
+        Blocks {
+            base: self.base().chunks(self.chunk_len()),
+            copies: self.blocks.iter(),
+        }
+    }
+
+    /// Returns an iterator over the blocks of motion values for modification.
+    /// Shared blocks are copied as they are reached.
+    pub(crate) fn blocks_mut(&mut self, num_channels: usize) -> BlocksMut<'_> {
+        if self.blocks.is_empty() && Arc::get_mut(self.base_mut()).is_none() {
+            self.split_into_blocks(num_channels);
+        }
+
+        let chunk_len = self.chunk_len();
+        let len = self.base().len();
+        let Motion {
+            ref mut base,
+            ref mut blocks,
+            ..
+        } = *self;
+        let base = base.get_or_insert_with(Arc::default);
+
+        let base = if Arc::get_mut(base).is_some() {
+            BaseBlocksMut::Unique(
+                Arc::get_mut(base)
+                    .expect("the values are not shared")
+                    .chunks_mut(chunk_len),
+            )
+        } else {
+            BaseBlocksMut::Shared(base.chunks(chunk_len))
+        };
+
+        BlocksMut {
+            base,
+            copies: blocks.iter_mut(),
+            chunk_len,
+            remaining: len,
+        }
+    }
+
+    /// The length of each block yielded by `blocks` and `blocks_mut`. If
+    /// no blocks have been split off, then the values are yielded as one block.
+    #[inline]
+    fn chunk_len(&self) -> usize {
+        if self.blocks.is_empty() {
+            self.base().len().max(1)
+        } else {
+            self.block_len
+        }
+    }
+
+    /// Returns the values of `base`, which are empty if there is no `base`.
+    #[inline]
+    fn base(&self) -> &[f32] {
+        match self.base {
+            Some(ref base) => &base[..],
+            None => &[],
+        }
+    }
+
+    /// Returns `base` for modification, creating an empty one if there is
+    /// none.
+    #[inline]
+    fn base_mut(&mut self) -> &mut Arc<Vec<f32>> {
+        self.base.get_or_insert_with(Arc::default)
+    }
+
+    /// Returns the start of the block containing the value at `index`, and the
+    /// copy of that block, if it has been copied.
+    #[inline]
+    fn copied_block(&self, index: usize) -> Option<(usize, &[f32])> {
+        if self.blocks.is_empty() {
+            return None;
+        }
+
+        let block = index / self.block_len;
+        self.blocks[block]
+            .as_ref()
+            .map(|values| (block * self.block_len, &values[..]))
+    }
+
+    /// Creates an empty entry in `blocks` for each block of `BLOCK_FRAMES`
+    /// frames.
+    fn split_into_blocks(&mut self, num_channels: usize) {
+        self.block_len = BLOCK_FRAMES * num_channels.max(1);
+        let num_blocks = (self.base().len() + self.block_len - 1) / self.block_len;
+        self.blocks.clear();
+        self.blocks.resize(num_blocks, None);
+    }
+
+    /// Writes the values of each copied block over the same block of `values`.
+    fn copy_blocks_into(&self, values: &mut [f32]) {
+        for (index, block) in self.blocks.iter().enumerate() {
+            if let Some(ref block) = *block {
+                let start = index * self.block_len;
+                values[start..start + block.len()].copy_from_slice(block);
+            }
+        }
+    }
+}
+
+impl Default for Motion {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl PartialEq for Motion {
+    fn eq(&self, other: &Self) -> bool {
+        if self.len() != other.len() {
+            return false;
+        }
+
+        // The two sides may have been split into blocks at different points,
+        // so compare the overlapping parts of the current block of each side.
+        // Values which are shared between the two sides are still compared,
+        // so that a `NaN` is never equal to itself, as with a `Vec<f32>`.
+        let (mut lhs_blocks, mut rhs_blocks) = (self.blocks(), other.blocks());
+        let (mut lhs, mut rhs): (&[f32], &[f32]) = (&[], &[]);
+        loop {
+            if lhs.is_empty() {
+                lhs = match lhs_blocks.next() {
+                    Some(block) => block,
+                    None => return true,
+                };
+            }
+            if rhs.is_empty() {
+                rhs = match rhs_blocks.next() {
+                    Some(block) => block,
+                    None => return true,
+                };
+            }
+
+            let len = lhs.len().min(rhs.len());
+            let (lhs_part, lhs_rest) = lhs.split_at(len);
+            let (rhs_part, rhs_rest) = rhs.split_at(len);
+            if lhs_part != rhs_part {
+                return false;
+            }
+
+            lhs = lhs_rest;
+            rhs = rhs_rest;
+        }
+    }
+}
+
+impl fmt::Debug for Motion {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_list().entries(self.values().iter()).finish()
+    }
+}
+
+/// An iterator over the blocks of a `Motion`.
+#[derive(Clone, Debug)]
+pub(crate) struct Blocks<'a> {
+    base: Chunks<'a, f32>,
+    copies: slice::Iter<'a, Option<Arc<Vec<f32>>>>,
+}
+
+impl<'a> Blocks<'a> {
+    /// Returns the number of values in the next block.
+    #[inline]
+    pub(crate) fn peek_len(&self) -> Option<usize> {
+        self.base.clone().next().map(<[f32]>::len)
+    }
+
+    /// Returns the number of values in the last block.
+    #[inline]
+    pub(crate) fn peek_back_len(&self) -> Option<usize> {
+        self.base.clone().next_back().map(<[f32]>::len)
+    }
+}
+
+impl<'a> Iterator for Blocks<'a> {
+    type Item = &'a [f32];
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        let base = self.base.next()?;
+        match self.copies.next() {
+            Some(Some(block)) => Some(&block[..]),
+            _ => Some(base),
+        }
+    }
+}
+
+impl<'a> DoubleEndedIterator for Blocks<'a> {
+    #[inline]
+    fn next_back(&mut self) -> Option<Self::Item> {
+        let base = self.base.next_back()?;
+        match self.copies.next_back() {
+            Some(Some(block)) => Some(&block[..]),
+            _ => Some(base),
+        }
+    }
+}
+
+/// The blocks of the `base` of a `Motion`, which can only be modified in
+/// place if they are not shared.
+#[derive(Debug)]
+enum BaseBlocksMut<'a> {
+    Unique(ChunksMut<'a, f32>),
+    Shared(Chunks<'a, f32>),
+}
+
+/// An iterator over the blocks of a `Motion` for modification.
+#[derive(Debug)]
+pub(crate) struct BlocksMut<'a> {
+    base: BaseBlocksMut<'a>,
+    copies: slice::IterMut<'a, Option<Arc<Vec<f32>>>>,
+    /// The length of every block except the last.
+    chunk_len: usize,
+    /// The number of values in the blocks which have not been yielded.
+    remaining: usize,
+}
+
+impl<'a> BlocksMut<'a> {
+    /// Returns the number of values in the next block.
+    #[inline]
+    pub(crate) fn peek_len(&self) -> Option<usize> {
+        // Only the last block can be shorter than `chunk_len`.
+        match self.remaining {
+            0 => None,
+            remaining => Some(remaining.min(self.chunk_len)),
+        }
+    }
+
+    /// Skips the next block without copying it.
+    #[inline]
+    pub(crate) fn skip_block(&mut self) {
+        let len = match self.base {
+            BaseBlocksMut::Unique(ref mut base) => base.next().map_or(0, |b| b.len()),
+            BaseBlocksMut::Shared(ref mut base) => base.next().map_or(0, <[f32]>::len),
+        };
+        self.remaining -= len;
+        self.copies.next();
+    }
+
+    /// Returns the block yielded from `base`, preferring its copy in `copy` if
+    /// it has one, and copying it into `copy` if it is shared.
+    #[inline]
+    fn block(
+        base: Result<&'a mut [f32], &'a [f32]>,
+        copy: Option<&'a mut Option<Arc<Vec<f32>>>>,
+    ) -> &'a mut [f32] {
+        match (copy, base) {
+            (Some(&mut Some(ref mut block)), _) => &mut Arc::make_mut(block)[..],
+            (_, Ok(base)) => base,
+            (Some(copy), Err(base)) => {
+                let block = copy.get_or_insert_with(|| Arc::new(base.to_vec()));
+                &mut Arc::get_mut(block).expect("the block was just copied")[..]
+            }
+            (None, Err(_)) => unreachable!("shared values are always split into blocks"),
+        }
+    }
+}
+
+impl<'a> Iterator for BlocksMut<'a> {
+    type Item = &'a mut [f32];
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        let base = match self.base {
+            BaseBlocksMut::Unique(ref mut base) => Ok(base.next()?),
+            BaseBlocksMut::Shared(ref mut base) => Err(base.next()?),
+        };
+        self.remaining -= base.as_ref().map_or_else(|b| b.len(), |b| b.len());
+        Some(Self::block(base, self.copies.next()))
+    }
+}
+
+impl<'a> DoubleEndedIterator for BlocksMut<'a> {
+    #[inline]
+    fn next_back(&mut self) -> Option<Self::Item> {
+        let base = match self.base {
+            BaseBlocksMut::Unique(ref mut base) => Ok(base.next_back()?),
+            BaseBlocksMut::Shared(ref mut base) => Err(base.next_back()?),
+        };
+        self.remaining -= base.as_ref().map_or_else(|b| b.len(), |b| b.len());
+        Some(Self::block(base, self.copies.next_back()))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::{generate::GenerateOptions, Bvh};
+
+    const NUM_FRAMES: usize = BLOCK_FRAMES * 3 + 10;
+
+    fn generate() -> Bvh {
+        GenerateOptions::new()
+            .with_seed(7)
+            .with_num_joints(4)
+            .with_num_frames(NUM_FRAMES)
+            .generate()
+    }
+
+    fn to_vec(bvh: &Bvh) -> Vec<f32> {
+        bvh.frames().flat_map(|frame| frame.0.to_vec()).collect()
+    }
+
+    #[test]
+    fn frames_mut_copies_only_touched_blocks() {
+        let original = generate();
+        let expected = to_vec(&original);
+
+        let mut clone = original.clone();
+        assert!(Arc::ptr_eq(
+            original.motion.base.as_ref().unwrap(),
+            clone.motion.base.as_ref().unwrap()
+        ));
+
+        let index = BLOCK_FRAMES * 2 + 3;
+        for value in clone.frames_mut().nth(index).unwrap().0.iter_mut() {
+            *value += 1.0;
+        }
+        assert_eq!(clone.motion.num_copied_blocks(), 1);
+        assert_eq!(original.motion.num_copied_blocks(), 0);
+        assert_eq!(to_vec(&original), expected);
+
+        let mut model = expected.clone();
+        let num_channels = original.num_channels;
+        for value in &mut model[index * num_channels..(index + 1) * num_channels] {
+            *value += 1.0;
+        }
+        assert_eq!(to_vec(&clone), model);
+        assert_ne!(original, clone);
+
+        // Clones compare equal whether or not their blocks have been copied.
+        let mut copy = original.clone();
+        copy.frames_mut().nth(index).unwrap().0[0] += 0.0;
+        assert_eq!(copy.motion.num_copied_blocks(), 1);
+        assert_eq!(original, copy);
+
+        let mut contiguous = original.clone();
+        contiguous.motion.vec_mut();
+        assert!(contiguous.motion.blocks.is_empty());
+        assert_eq!(copy, contiguous);
+        assert_ne!(clone, contiguous);
+
+        // A `NaN` is not equal to itself, even in a shared buffer.
+        let mut with_nan = original.clone();
+        with_nan.frames_mut().nth(index).unwrap().0[0] = f32::NAN;
+        assert_ne!(with_nan, with_nan.clone());
+        let mut with_nan = contiguous;
+        with_nan.frames_mut().nth(index).unwrap().0[0] = f32::NAN;
+        assert_eq!(with_nan.motion.num_copied_blocks(), 0);
+        assert_ne!(with_nan, with_nan.clone());
+
+        // A second write to the same block reuses its copy.
+        clone.frames_mut().nth(index + 1).unwrap().0[0] = 0.0;
+        assert_eq!(clone.motion.num_copied_blocks(), 1);
+    }
+
+    #[test]
+    fn cursor_copies_only_touched_blocks() {
+        let original = generate();
+        let expected = to_vec(&original);
+        let num_channels = original.num_channels;
+
+        let mut clone = original.clone();
+        {
+            let mut cursor = clone.frame_cursor();
+            for _ in 0..BLOCK_FRAMES + 1 {
+                cursor.move_next();
+            }
+            cursor.peek_next_mut().unwrap().0[0] = -1.0;
+        }
+        assert_eq!(clone.motion.num_copied_blocks(), 1);
+        assert_eq!(to_vec(&original), expected);
+        assert_eq!(clone.frames().nth(BLOCK_FRAMES + 1).unwrap().0[0], -1.0);
+
+        // Inserting a frame makes the values contiguous, and leaves the
+        // original alone.
+        clone
+            .frame_cursor()
+            .try_insert_frame(&vec![2.0; num_channels][..])
+            .unwrap();
+        assert_eq!(clone.motion.num_copied_blocks(), 0);
+        assert_eq!(clone.frames().len(), NUM_FRAMES + 1);
+        assert_eq!(clone.frames().nth(BLOCK_FRAMES + 2).unwrap().0[0], -1.0);
+        assert_eq!(to_vec(&original), expected);
+    }
+
+    #[test]
+    fn frames_iterate_across_blocks() {
+        let original = generate();
+        let expected = to_vec(&original);
+        let num_channels = original.num_channels;
+
+        let mut clone = original.clone();
+        clone.frames_mut().nth(BLOCK_FRAMES).unwrap().0[0] = 5.0;
+        let mut model = expected.clone();
+        model[BLOCK_FRAMES * num_channels] = 5.0;
+
+        let frames = model.chunks_exact(num_channels).collect::<Vec<_>>();
+        let mut iter = clone.frames();
+        let mut front = 0;
+        let mut back = frames.len();
+        while front < back {
+            assert_eq!(iter.len(), back - front);
+            if front % 3 == 0 {
+                back -= 1;
+                assert_eq!(&iter.next_back().unwrap().0[..], frames[back]);
+            } else {
+                assert_eq!(&iter.next().unwrap().0[..], frames[front]);
+                front += 1;
+            }
+        }
+        assert!(iter.next().is_none());
+        assert!(iter.next_back().is_none());
+
+        let mut iter = clone.frames_mut();
+        assert_eq!(
+            &iter.nth(BLOCK_FRAMES - 1).unwrap().0[..],
+            frames[BLOCK_FRAMES - 1]
+        );
+        assert_eq!(&iter.next_back().unwrap().0[..], frames[frames.len() - 1]);
+        assert_eq!(
+            &iter.nth(BLOCK_FRAMES * 2).unwrap().0[..],
+            frames[BLOCK_FRAMES * 3]
+        );
+        assert_eq!(iter.len(), frames.len() - BLOCK_FRAMES * 3 - 2);
+        assert_eq!(iter.count(), frames.len() - BLOCK_FRAMES * 3 - 2);
+        assert_eq!(to_vec(&original), expected);
+    }
+}
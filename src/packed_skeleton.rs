@@ -0,0 +1,614 @@
+//! A compact, read-only copy of the skeleton of a `Bvh`.
+
+use crate::{
+    joint::{JointData, JointIndex, JointName, JointPrivateData, Offset, Skeleton},
+    Bvh, Channel, ChannelType,
+};
+use std::{
+    convert::TryFrom,
+    fmt,
+    iter::{ExactSizeIterator, FusedIterator, Iterator},
+    mem,
+    sync::Arc,
+};
+
+/// The value of `parents` for the root joint.
+const NO_PARENT: u32 = u32::MAX;
+/// The value of `end_sites` for joints without an end site.
+const NO_END_SITE: u32 = u32::MAX;
+
+/// A compact, read-only copy of the skeleton of a `Bvh`.
+///
+/// The joints of a [`Bvh`][`Bvh`] each store their own name, channels and
+/// indices, with room to spare for editing. A `PackedSkeleton` stores the same
+/// hierarchy in a handful of flat arrays instead:
+///
+/// * The names of every joint are stored one after the other in a single byte
+///   arena.
+/// * The parent of each joint, the start of its channels and the motion index
+///   of its first channel are stored as `u32`s, and the depth of each joint
+///   and its number of channels as `u16`s.
+/// * Offsets, parents, depths, and channel ranges are each stored in their
+///   own array, indexed by joint.
+/// * Channel types are packed into one byte each. The motion index of each
+///   channel is not stored, as it is always the motion index of the first
+///   channel of its joint plus its position among the channels of that joint.
+///
+/// This takes a fraction of the memory of the joints of a `Bvh`, and a small,
+/// fixed number of allocations regardless of the number of joints, which makes
+/// it suitable for keeping many skeletons resident at once.
+///
+/// The joints are read through [`PackedJoint`][`PackedJoint`], which provides
+/// the same methods as [`Joint`][`Joint`].
+///
+/// # Examples
+///
+/// ```
+/// # use bvh_anim::joint::PackedSkeleton;
+/// # let bvh = bvh_anim::from_path("./data/test_mocapbank.bvh")?;
+/// let skeleton = PackedSkeleton::from(&bvh);
+///
+/// for (packed, joint) in skeleton.joints().zip(bvh.joints()) {
+///     assert_eq!(packed.name(), joint.name());
+///     assert_eq!(packed.parent_index(), joint.parent_index());
+///     assert!(packed.channels().eq(joint.channels().iter().copied()));
+/// }
+///
+/// let hips = skeleton.joints().find_by_name("Hips").unwrap();
+/// assert!(hips.is_root());
+/// # Result::<(), bvh_anim::errors::LoadError>::Ok(())
+/// ```
+///
+/// [`Bvh`]: ../struct.Bvh.html
+/// [`PackedJoint`]: struct.PackedJoint.html
+/// [`Joint`]: struct.Joint.html
+#[derive(Clone, Default, PartialEq)]
+pub struct PackedSkeleton {
+    /// The names of every joint, one after the other.
+    names: Vec<u8>,
+    /// The end of the name of each joint in `names`.
+    name_ends: Vec<u32>,
+    /// The index of the parent of each joint, or `NO_PARENT`.
+    parents: Vec<u32>,
+    depths: Vec<u16>,
+    offsets: Vec<Offset>,
+    /// The index of the end site of each joint in `end_site_offsets`, or
+    /// `NO_END_SITE`.
+    end_sites: Vec<u32>,
+    end_site_offsets: Vec<Offset>,
+    /// The index of the first channel of each joint in `channel_types`.
+    channel_starts: Vec<u32>,
+    /// The motion index of the first channel of each joint.
+    motion_starts: Vec<u32>,
+    channel_counts: Vec<u16>,
+    /// The `ChannelType` of every channel, one byte each.
+    channel_types: Vec<u8>,
+}
+
+impl PackedSkeleton {
+    /// Returns the number of joints in the skeleton.
+    #[inline]
+    pub fn num_joints(&self) -> usize {
+        self.parents.len()
+    }
+
+    /// Returns the total number of channels of every joint in the skeleton.
+    #[inline]
+    pub fn num_channels(&self) -> usize {
+        self.channel_types.len()
+    }
+
+    /// Returns the root joint, or `None` if the skeleton is empty.
+    #[inline]
+    pub fn root_joint(&self) -> Option<PackedJoint<'_>> {
+        self.joint(0)
+    }
+
+    /// Returns the joint at `index`, or `None` if `index` is out of bounds.
+    #[inline]
+    pub fn joint(&self, index: usize) -> Option<PackedJoint<'_>> {
+        if index < self.num_joints() {
+            Some(PackedJoint {
+                index,
+                skeleton: self,
+            })
+        } else {
+            None
+        }
+    }
+
+    /// Returns an iterator over all the joints, in the same order as
+    /// [`Bvh::joints`][`Bvh::joints`].
+    ///
+    /// [`Bvh::joints`]: ../struct.Bvh.html#method.joints
+    #[inline]
+    pub fn joints(&self) -> PackedJoints<'_> {
+        PackedJoints {
+            skeleton: self,
+            range: 0..self.num_joints(),
+        }
+    }
+
+    /// Returns the approximate number of bytes of heap memory used by the
+    /// skeleton.
+    pub fn heap_size(&self) -> usize {
+        fn size<T>(v: &Vec<T>) -> usize {
+            v.capacity() * mem::size_of::<T>()
+        }
+
+        size(&self.names)
+            + size(&self.name_ends)
+            + size(&self.parents)
+            + size(&self.depths)
+            + size(&self.offsets)
+            + size(&self.end_sites)
+            + size(&self.end_site_offsets)
+            + size(&self.channel_starts)
+            + size(&self.motion_starts)
+            + size(&self.channel_counts)
+            + size(&self.channel_types)
+    }
+
+    /// Unpacks the skeleton into a new `Bvh`, which has no frames.
+    pub fn to_bvh(&self) -> Bvh {
+        let joints = self
+            .joints()
+            .map(|joint| {
+                let name = JointName(joint.name().into());
+                let offset = *joint.offset();
+                match joint.parent_index() {
+                    None => JointData::Root {
+                        name,
+                        offset,
+                        channels: joint.channels().collect(),
+                    },
+                    Some(parent_index) => JointData::Child {
+                        name,
+                        offset,
+                        channels: joint.channels().collect(),
+                        end_site_offset: joint.end_site().copied(),
+                        private: JointPrivateData::new(joint.index, parent_index, joint.depth()),
+                    },
+                }
+            })
+            .collect();
+
+        Bvh {
+            skeleton: Some(Arc::new(Skeleton {
+                joints,
+                joint_index: JointIndex::new(),
+            })),
+            num_channels: self.num_channels(),
+            ..Bvh::default()
+        }
+    }
+
+    #[inline]
+    fn name_range(&self, index: usize) -> (usize, usize) {
+        let start = index
+            .checked_sub(1)
+            .map_or(0, |prev| self.name_ends[prev] as usize);
+        (start, self.name_ends[index] as usize)
+    }
+}
+
+impl From<&'_ Bvh> for PackedSkeleton {
+    /// Packs the skeleton of `bvh`.
+    ///
+    /// # Panics
+    ///
+    /// Panics if `bvh` has more than `u32::MAX` joints, channels, or bytes of
+    /// joint names, a joint with more than `u16::MAX` channels, or a
+    /// hierarchy deeper than `u16::MAX` joints.
+    ///
+    /// Also panics if the motion indices of the channels of any joint are not
+    /// consecutive.
+    fn from(bvh: &Bvh) -> Self {
+        let num_joints = bvh.skeleton().joints.len();
+        let mut skeleton = PackedSkeleton {
+            names: Vec::with_capacity(bvh.skeleton().joints.iter().map(|j| j.name().len()).sum()),
+            name_ends: Vec::with_capacity(num_joints),
+            parents: Vec::with_capacity(num_joints),
+            depths: Vec::with_capacity(num_joints),
+            offsets: Vec::with_capacity(num_joints),
+            end_sites: Vec::with_capacity(num_joints),
+            end_site_offsets: Vec::new(),
+            channel_starts: Vec::with_capacity(num_joints),
+            motion_starts: Vec::with_capacity(num_joints),
+            channel_counts: Vec::with_capacity(num_joints),
+            channel_types: Vec::with_capacity(bvh.num_channels),
+        };
+
+        for joint in &bvh.skeleton().joints {
+            skeleton.names.extend_from_slice(joint.name());
+            skeleton.name_ends.push(narrow(skeleton.names.len()));
+            skeleton
+                .parents
+                .push(joint.parent_index().map_or(NO_PARENT, narrow));
+            skeleton.depths.push(narrow(joint.depth()));
+            skeleton.offsets.push(*joint.offset());
+
+            match joint.end_site() {
+                Some(end_site) => {
+                    skeleton
+                        .end_sites
+                        .push(narrow(skeleton.end_site_offsets.len()));
+                    skeleton.end_site_offsets.push(*end_site);
+                }
+                None => skeleton.end_sites.push(NO_END_SITE),
+            }
+
+            let channels = joint.channels();
+            let motion_start = channels
+                .first()
+                .map_or(skeleton.channel_types.len(), |c| c.motion_index());
+            assert!(
+                channels
+                    .iter()
+                    .enumerate()
+                    .all(|(i, c)| c.motion_index() == motion_start + i),
+                "the channels of a joint must have consecutive motion indices to be packed"
+            );
+            skeleton
+                .channel_starts
+                .push(narrow(skeleton.channel_types.len()));
+            skeleton.motion_starts.push(narrow(motion_start));
+            skeleton.channel_counts.push(narrow(channels.len()));
+            skeleton
+                .channel_types
+                .extend(channels.iter().map(|c| c.channel_type() as u8));
+        }
+
+        skeleton
+    }
+}
+
+impl fmt::Debug for PackedSkeleton {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_list().entries(self.joints()).finish()
+    }
+}
+
+/// A view of a joint in a [`PackedSkeleton`][`PackedSkeleton`].
+///
+/// This provides the same methods as [`Joint`][`Joint`].
+///
+/// [`PackedSkeleton`]: struct.PackedSkeleton.html
+/// [`Joint`]: struct.Joint.html
+#[derive(Clone, Copy)]
+pub struct PackedJoint<'a> {
+    index: usize,
+    skeleton: &'a PackedSkeleton,
+}
+
+impl<'a> PackedJoint<'a> {
+    /// Returns `true` if the `PackedJoint` is the root joint, or `false` if it
+    /// isn't.
+    #[inline]
+    pub fn is_root(&self) -> bool {
+        self.skeleton.parents[self.index] == NO_PARENT
+    }
+
+    /// Returns `true` if the `PackedJoint` is a child joint, or `false` if it
+    /// isn't.
+    #[inline]
+    pub fn is_child(&self) -> bool {
+        !self.is_root()
+    }
+
+    /// Returns the name of the joint.
+    #[inline]
+    pub fn name(&self) -> &'a [u8] {
+        let (start, end) = self.skeleton.name_range(self.index);
+        &self.skeleton.names[start..end]
+    }
+
+    /// Returns the offset of the joint from its parent.
+    #[inline]
+    pub fn offset(&self) -> &'a Offset {
+        &self.skeleton.offsets[self.index]
+    }
+
+    /// Returns the `end_site` position if this joint has an end site, or `None`
+    /// if it doesn't.
+    #[inline]
+    pub fn end_site(&self) -> Option<&'a Offset> {
+        match self.skeleton.end_sites[self.index] {
+            NO_END_SITE => None,
+            end_site => Some(&self.skeleton.end_site_offsets[end_site as usize]),
+        }
+    }
+
+    /// Returns `true` if the joint has an end site, or `false` if it doesn't.
+    #[inline]
+    pub fn has_end_site(&self) -> bool {
+        self.skeleton.end_sites[self.index] != NO_END_SITE
+    }
+
+    /// Returns an iterator over the ordered `Channel`s of this joint.
+    ///
+    /// As the channels are packed, they are returned by value, rather than as
+    /// a slice.
+    #[inline]
+    pub fn channels(&self) -> PackedChannels<'a> {
+        let start = self.skeleton.channel_starts[self.index] as usize;
+        let count = self.skeleton.channel_counts[self.index] as usize;
+        PackedChannels {
+            channel_types: self.skeleton.channel_types[start..start + count].iter(),
+            motion_index: self.skeleton.motion_starts[self.index] as usize,
+        }
+    }
+
+    /// Returns the index of this joint in the skeleton.
+    #[inline]
+    pub const fn index(&self) -> usize {
+        self.index
+    }
+
+    /// Returns the depth of the joint in the hierarchy. The root joint has a
+    /// depth of `0`.
+    #[inline]
+    pub fn depth(&self) -> usize {
+        self.skeleton.depths[self.index] as usize
+    }
+
+    /// Returns the index of this joint's parent, or `None` if this joint is the
+    /// root joint.
+    #[inline]
+    pub fn parent_index(&self) -> Option<usize> {
+        match self.skeleton.parents[self.index] {
+            NO_PARENT => None,
+            parent => Some(parent as usize),
+        }
+    }
+
+    /// Return the parent joint if it exists, or `None` if it doesn't.
+    #[inline]
+    pub fn parent(&self) -> Option<PackedJoint<'a>> {
+        self.parent_index().and_then(|idx| self.skeleton.joint(idx))
+    }
+
+    /// Returns an iterator over the direct children of `self`.
+    #[inline]
+    pub fn children(&self) -> PackedChildren<'a> {
+        PackedChildren {
+            parent: self.index,
+            skeleton: self.skeleton,
+            next: self.index + 1,
+        }
+    }
+}
+
+impl PartialEq for PackedJoint<'_> {
+    #[inline]
+    fn eq(&self, rhs: &Self) -> bool {
+        self.name() == rhs.name()
+            && self.offset() == rhs.offset()
+            && self.end_site() == rhs.end_site()
+            && self.parent_index() == rhs.parent_index()
+            && self.channels().eq(rhs.channels())
+    }
+}
+
+impl fmt::Debug for PackedJoint<'_> {
+    #[inline]
+    fn fmt(&self, fmtr: &mut fmt::Formatter<'_>) -> fmt::Result {
+        fmtr.debug_struct("PackedJoint")
+            .field("index", &self.index)
+            .field("name", &bstr::BStr::new(self.name()))
+            .field("offset", self.offset())
+            .field("end_site", &self.end_site())
+            .field("channels", &self.channels().collect::<Vec<_>>())
+            .finish()
+    }
+}
+
+/// An iterator over the joints of a [`PackedSkeleton`][`PackedSkeleton`].
+///
+/// [`PackedSkeleton`]: struct.PackedSkeleton.html
+#[derive(Clone, Debug)]
+pub struct PackedJoints<'a> {
+    skeleton: &'a PackedSkeleton,
+    range: std::ops::Range<usize>,
+}
+
+impl<'a> PackedJoints<'a> {
+    /// Finds the joint named `joint_name`, or `None` if it doesn't exist.
+    #[inline]
+    pub fn find_by_name<B>(&mut self, joint_name: &B) -> Option<PackedJoint<'a>>
+    where
+        B: ?Sized + AsRef<[u8]>,
+    {
+        self.find(|j| j.name() == joint_name.as_ref())
+    }
+}
+
+impl<'a> Iterator for PackedJoints<'a> {
+    type Item = PackedJoint<'a>;
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        let skeleton = self.skeleton;
+        self.range
+            .next()
+            .map(|index| PackedJoint { index, skeleton })
+    }
+
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.range.size_hint()
+    }
+}
+
+impl ExactSizeIterator for PackedJoints<'_> {}
+
+impl FusedIterator for PackedJoints<'_> {}
+
+/// An iterator over the direct children of a [`PackedJoint`][`PackedJoint`].
+///
+/// [`PackedJoint`]: struct.PackedJoint.html
+#[derive(Clone, Debug)]
+pub struct PackedChildren<'a> {
+    parent: usize,
+    skeleton: &'a PackedSkeleton,
+    next: usize,
+}
+
+impl<'a> Iterator for PackedChildren<'a> {
+    type Item = PackedJoint<'a>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        // Joints are stored depth first, so the descendants of the parent are
+        // the joints after it which are deeper than it.
+        let skeleton = self.skeleton;
+        let parent_depth = skeleton.depths[self.parent];
+        while self.next < skeleton.num_joints() && skeleton.depths[self.next] > parent_depth {
+            let index = self.next;
+            self.next += 1;
+            if skeleton.parents[index] as usize == self.parent {
+                return Some(PackedJoint { index, skeleton });
+            }
+        }
+
+        None
+    }
+}
+
+impl FusedIterator for PackedChildren<'_> {}
+
+/// An iterator over the channels of a [`PackedJoint`][`PackedJoint`].
+///
+/// [`PackedJoint`]: struct.PackedJoint.html
+#[derive(Clone, Debug)]
+pub struct PackedChannels<'a> {
+    channel_types: std::slice::Iter<'a, u8>,
+    motion_index: usize,
+}
+
+impl Iterator for PackedChannels<'_> {
+    type Item = Channel;
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        let channel_type = unpack_channel_type(*self.channel_types.next()?);
+        let channel = Channel::new(channel_type, self.motion_index);
+        self.motion_index += 1;
+        Some(channel)
+    }
+
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.channel_types.size_hint()
+    }
+}
+
+impl ExactSizeIterator for PackedChannels<'_> {}
+
+impl FusedIterator for PackedChannels<'_> {}
+
+#[inline]
+fn unpack_channel_type(channel_type: u8) -> ChannelType {
+    const TYPES: [ChannelType; 6] = [
+        ChannelType::PositionX,
+        ChannelType::PositionY,
+        ChannelType::PositionZ,
+        ChannelType::RotationX,
+        ChannelType::RotationY,
+        ChannelType::RotationZ,
+    ];
+    TYPES[channel_type as usize]
+}
+
+/// Converts `value` into a narrower index type.
+#[inline]
+fn narrow<T: TryFrom<usize>>(value: usize) -> T {
+    T::try_from(value)
+        .ok()
+        .expect("the skeleton is too large to be packed")
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn packing_round_trips() {
+        const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let skeleton = PackedSkeleton::from(&bvh);
+
+        assert_eq!(skeleton.num_joints(), bvh.joints().count());
+        assert_eq!(skeleton.num_channels(), bvh.num_channels());
+        for (packed, joint) in skeleton.joints().zip(bvh.joints()) {
+            assert_eq!(packed.name(), joint.name());
+            assert_eq!(packed.offset(), joint.offset());
+            assert_eq!(packed.end_site(), joint.end_site());
+            assert_eq!(packed.depth(), joint.data().depth());
+            assert!(packed.channels().eq(joint.channels().iter().copied()));
+        }
+
+        bvh.extract_frames();
+        bvh.set_frame_time(Default::default());
+        assert_eq!(skeleton.to_bvh(), bvh);
+
+        let unpacked_size = bvh.skeleton().joints.capacity() * mem::size_of::<JointData>();
+        assert!(skeleton.heap_size() < unpacked_size);
+    }
+
+    #[test]
+    fn packing_keeps_out_of_order_motion_indices() {
+        const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        bvh.extract_frames();
+        bvh.set_frame_time(Default::default());
+
+        // Lay out the motion values of the joints in reverse order.
+        let mut motion_start = bvh.num_channels();
+        for joint in bvh.skeleton_mut().joints_mut().iter_mut() {
+            let channels = joint.channels_mut();
+            motion_start -= channels.len();
+            for (i, channel) in channels.iter_mut().enumerate() {
+                *channel = Channel::new(channel.channel_type(), motion_start + i);
+            }
+        }
+        assert_eq!(motion_start, 0);
+
+        let skeleton = PackedSkeleton::from(&bvh);
+        for (packed, joint) in skeleton.joints().zip(bvh.joints()) {
+            assert!(packed.channels().eq(joint.channels().iter().copied()));
+        }
+        assert_eq!(skeleton.to_bvh(), bvh);
+    }
+
+    #[test]
+    #[should_panic(expected = "consecutive motion indices")]
+    fn packing_rejects_scattered_motion_indices() {
+        const BVH_BYTES: &[u8] = include_bytes!("../data/test_simple.bvh");
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+
+        let root = &mut bvh.skeleton_mut().joints_mut()[0];
+        let channels = root.channels_mut();
+        let last = channels.len() - 1;
+        channels.swap(0, last);
+
+        let _ = PackedSkeleton::from(&bvh);
+    }
+
+    #[test]
+    fn children_are_direct_descendants() {
+        const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+        let bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let skeleton = PackedSkeleton::from(&bvh);
+
+        for joint in skeleton.joints() {
+            let expected = skeleton
+                .joints()
+                .filter(|j| j.parent_index() == Some(joint.index()))
+                .map(|j| j.index())
+                .collect::<Vec<_>>();
+            let actual = joint.children().map(|j| j.index()).collect::<Vec<_>>();
+            assert_eq!(actual, expected);
+        }
+    }
+}
@@ -0,0 +1,256 @@
+//! Loading a `bvh` file from an asynchronous reader.
+
+use super::incremental::BvhParser;
+use crate::{errors::LoadError, Bvh};
+use bstr::ByteSlice;
+use futures_io::AsyncBufRead;
+use std::{
+    fmt,
+    future::Future,
+    io,
+    pin::Pin,
+    task::{Context, Poll},
+};
+
+/// The most bytes which are parsed between checks of whether to yield.
+const MAX_FEED_LEN: usize = 4096;
+
+/// Loads a `Bvh` from an [`AsyncBufRead`][`AsyncBufRead`] without blocking the
+/// executor.
+///
+/// The reader is parsed as data becomes available. While the motion section is
+/// being parsed, the returned future yields back to the executor after roughly
+/// every `frames_per_yield` frames, so that one large file does not hold up
+/// every other task which is running on the same thread.
+///
+/// This type is only available with the `async` feature.
+///
+/// # Examples
+///
+/// ```
+/// # use bvh_anim::parse::AsyncLoader;
+/// # async fn load() -> Result<(), bvh_anim::errors::LoadError> {
+/// # let bytes = std::fs::read("./data/test_mocapbank.bvh").unwrap();
+/// # let reader = &bytes[..];
+/// let bvh = AsyncLoader::new().with_frames_per_yield(64).load(reader).await?;
+/// # let _ = bvh;
+/// # Ok(())
+/// # }
+/// ```
+///
+/// [`AsyncBufRead`]: https://docs.rs/futures-io/0.3/futures_io/trait.AsyncBufRead.html
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct AsyncLoader {
+    /// The number of frames which are parsed before yielding to the executor.
+    ///
+    /// If this is `0`, then the future only yields when the reader has no data
+    /// ready.
+    pub frames_per_yield: usize,
+    /// The maximum number of bytes which the motion values of the file may
+    /// take up.
+    ///
+    /// If the file would take up more memory than this, including a line which
+    /// never ends, then loading stops with a `MotionLimitExceeded` error. This
+    /// is useful when loading files from untrusted sources. If this is `None`,
+    /// then there is no limit.
+    pub max_motion_bytes: Option<usize>,
+    #[doc(hidden)]
+    _nonexhaustive: (),
+}
+
+impl Default for AsyncLoader {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl AsyncLoader {
+    /// The default number of frames parsed before yielding, which is `256`.
+    pub const DEFAULT_FRAMES_PER_YIELD: usize = 256;
+
+    /// Create a new `AsyncLoader`, which yields after every `256` frames.
+    #[inline]
+    pub const fn new() -> Self {
+        AsyncLoader {
+            frames_per_yield: Self::DEFAULT_FRAMES_PER_YIELD,
+            max_motion_bytes: None,
+            _nonexhaustive: (),
+        }
+    }
+
+    /// Sets `frames_per_yield` on `self` to the new `frames_per_yield`.
+    #[inline]
+    pub fn with_frames_per_yield(self, frames_per_yield: usize) -> Self {
+        Self {
+            frames_per_yield,
+            ..self
+        }
+    }
+
+    /// Sets `max_motion_bytes` on `self` to the new limit.
+    #[inline]
+    pub fn with_max_motion_bytes<L>(self, max_motion_bytes: L) -> Self
+    where
+        L: Into<Option<usize>>,
+    {
+        Self {
+            max_motion_bytes: max_motion_bytes.into(),
+            ..self
+        }
+    }
+
+    /// Returns a future which loads the `Bvh` from `reader`.
+    ///
+    /// The result (including any error) is the same as calling
+    /// [`Bvh::from_reader`][`Bvh::from_reader`] on the same data.
+    ///
+    /// [`Bvh::from_reader`]: ../struct.Bvh.html#method.from_reader
+    #[inline]
+    pub fn load<R: AsyncBufRead + Unpin>(&self, reader: R) -> LoadAsync<R> {
+        LoadAsync {
+            reader,
+            parser: Some(BvhParser::new().with_max_motion_bytes(self.max_motion_bytes)),
+            frames_per_yield: self.frames_per_yield,
+            frames_at_last_yield: 0,
+        }
+    }
+}
+
+/// The future returned from [`AsyncLoader::load`][`AsyncLoader::load`].
+///
+/// [`AsyncLoader::load`]: struct.AsyncLoader.html#method.load
+#[must_use = "futures do nothing unless polled"]
+pub struct LoadAsync<R> {
+    reader: R,
+    /// The parser, which is taken once the future has completed.
+    parser: Option<BvhParser>,
+    frames_per_yield: usize,
+    frames_at_last_yield: usize,
+}
+
+impl<R: AsyncBufRead + Unpin> Future for LoadAsync<R> {
+    type Output = Result<Bvh, LoadError>;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let this = self.get_mut();
+
+        loop {
+            let parser = this
+                .parser
+                .as_mut()
+                .expect("LoadAsync polled after completion");
+
+            let chunk = match Pin::new(&mut this.reader).poll_fill_buf(cx) {
+                Poll::Ready(Ok(chunk)) => chunk,
+                Poll::Ready(Err(ref e)) if e.kind() == io::ErrorKind::Interrupted => continue,
+                Poll::Ready(Err(e)) => {
+                    let error = parser.io_error(e);
+                    this.parser = None;
+                    return Poll::Ready(Err(error));
+                }
+                Poll::Pending => return Poll::Pending,
+            };
+
+            if chunk.is_empty() {
+                let parser = this.parser.take().expect("the parser was checked above");
+                return Poll::Ready(parser.finish());
+            }
+
+            // Once the motion section is reached, each frame is fed on its own,
+            // so that the future yields as soon as enough frames are parsed.
+            let mut len = chunk.len().min(MAX_FEED_LEN);
+            if parser.header().is_some() {
+                if let Some(end) = chunk[..len].find_byte(b'\n') {
+                    len = end + 1;
+                }
+            }
+            let result = parser.feed(&chunk[..len]);
+            Pin::new(&mut this.reader).consume(len);
+            if let Err(e) = result {
+                this.parser = None;
+                return Poll::Ready(Err(e));
+            }
+
+            let num_frames = parser.num_frames_parsed();
+            if this.frames_per_yield != 0
+                && num_frames - this.frames_at_last_yield >= this.frames_per_yield
+            {
+                this.frames_at_last_yield = num_frames;
+                cx.waker().wake_by_ref();
+                return Poll::Pending;
+            }
+        }
+    }
+}
+
+impl<R> fmt::Debug for LoadAsync<R> {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("LoadAsync")
+            .field("parser", &self.parser)
+            .field("frames_per_yield", &self.frames_per_yield)
+            .finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::{
+        sync::Arc,
+        task::{Wake, Waker},
+    };
+
+    struct NoopWaker;
+
+    impl Wake for NoopWaker {
+        fn wake(self: Arc<Self>) {}
+    }
+
+    /// Polls `future` to completion, returning its output and the number of
+    /// times it returned `Poll::Pending`.
+    fn block_on<F: Future + Unpin>(mut future: F) -> (F::Output, usize) {
+        let waker = Waker::from(Arc::new(NoopWaker));
+        let mut cx = Context::from_waker(&waker);
+        let mut num_yields = 0;
+
+        loop {
+            match Pin::new(&mut future).poll(&mut cx) {
+                Poll::Ready(output) => return (output, num_yields),
+                Poll::Pending => num_yields += 1,
+            }
+        }
+    }
+
+    #[test]
+    fn yields_while_loading_motion() {
+        const BVH_BYTES: &[u8] = include_bytes!("../../data/test_mocapbank.bvh");
+        let expected = Bvh::from_bytes(BVH_BYTES).unwrap();
+
+        let (bvh, num_yields) =
+            block_on(AsyncLoader::new().with_frames_per_yield(10).load(BVH_BYTES));
+        assert_eq!(bvh.unwrap(), expected);
+        assert_eq!(num_yields, 455 / 10);
+
+        let (bvh, num_yields) =
+            block_on(AsyncLoader::new().with_frames_per_yield(0).load(BVH_BYTES));
+        assert_eq!(bvh.unwrap(), expected);
+        assert_eq!(num_yields, 0);
+    }
+
+    #[test]
+    fn reports_same_errors_as_from_bytes() {
+        const BVH_BYTES: &[u8] = include_bytes!("../../data/test_simple.bvh");
+
+        for len in &[0, 10, BVH_BYTES.len() - 10] {
+            let truncated = &BVH_BYTES[..*len];
+            let expected = Bvh::from_bytes(truncated).unwrap_err();
+            let (actual, _) = block_on(AsyncLoader::new().load(truncated));
+            assert_eq!(
+                format!("{:?}", actual.unwrap_err()),
+                format!("{:?}", expected)
+            );
+        }
+    }
+}
@@ -0,0 +1,313 @@
+//! Loading many `bvh` files at once on a pool of threads.
+
+use crate::{
+    errors::{LoadError, LoadErrorKind, LoadJointsError},
+    joint::SkeletonCache,
+    Bvh,
+};
+use std::{
+    any::Any,
+    fmt,
+    fs::{self, File},
+    io::Read,
+    panic::{self, AssertUnwindSafe},
+    path::{Path, PathBuf},
+    sync::{
+        atomic::{AtomicUsize, Ordering},
+        mpsc::{self, Receiver, Sender},
+        Arc,
+    },
+    thread,
+};
+
+/// Loads many `bvh` files in parallel on a pool of threads.
+///
+/// The files are sorted by size, and the largest files are loaded first.
+/// Each thread takes the next file from the shared queue as soon as it has
+/// finished its last one, so a thread which is stuck on a large file does not
+/// hold up the others, and the pool stays busy until the queue is empty.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use bvh_anim::parse::BatchLoader;
+/// # use std::fs;
+/// let paths = fs::read_dir("./path/to/clips")?
+///     .map(|entry| entry.map(|e| e.path()))
+///     .collect::<Result<Vec<_>, _>>()?;
+///
+/// for (path, result) in BatchLoader::new().load_many(paths) {
+///     match result {
+///         Ok(bvh) => println!("{}: {} frames", path.display(), bvh.frames().len()),
+///         Err(e) => eprintln!("{}: {}", path.display(), e),
+///     }
+/// }
+/// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+/// ```
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct BatchLoader {
+    /// The number of threads to load the files on.
+    ///
+    /// If this is `0`, then the number of available cores is used.
+    pub num_threads: usize,
+    /// Whether each thread should read every file into the same buffer.
+    ///
+    /// When this is `true`, each file is read in full into a buffer owned by
+    /// the thread, which is reused for the next file, and then parsed from
+    /// memory. When this is `false`, each file is loaded with
+    /// [`Bvh::from_path`][`Bvh::from_path`].
+    ///
+    /// [`Bvh::from_path`]: ../struct.Bvh.html#method.from_path
+    pub reuse_buffers: bool,
+    /// Whether files which have equal skeletons should share them.
+    ///
+    /// When this is `true`, the skeleton of each loaded file is deduplicated
+    /// with a [`SkeletonCache`][`SkeletonCache`], so the takes of a session
+    /// which were all recorded on one rig hold a single copy of its skeleton.
+    ///
+    /// [`SkeletonCache`]: ../joint/struct.SkeletonCache.html
+    pub dedupe_skeletons: bool,
+    #[doc(hidden)]
+    _nonexhaustive: (),
+}
+
+impl Default for BatchLoader {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl BatchLoader {
+    /// Create a new `BatchLoader`, which uses every available core, reuses
+    /// a buffer on each thread, and shares equal skeletons.
+    #[inline]
+    pub const fn new() -> Self {
+        BatchLoader {
+            num_threads: 0,
+            reuse_buffers: true,
+            dedupe_skeletons: true,
+            _nonexhaustive: (),
+        }
+    }
+
+    /// Sets `num_threads` on `self` to the new `num_threads`.
+    #[inline]
+    pub fn with_num_threads(self, num_threads: usize) -> Self {
+        Self {
+            num_threads,
+            ..self
+        }
+    }
+
+    /// Sets `reuse_buffers` on `self` to the new `reuse_buffers`.
+    #[inline]
+    pub fn with_reuse_buffers(self, reuse_buffers: bool) -> Self {
+        Self {
+            reuse_buffers,
+            ..self
+        }
+    }
+
+    /// Sets `dedupe_skeletons` on `self` to the new `dedupe_skeletons`.
+    #[inline]
+    pub fn with_dedupe_skeletons(self, dedupe_skeletons: bool) -> Self {
+        Self {
+            dedupe_skeletons,
+            ..self
+        }
+    }
+
+    /// Starts loading each of the files in `paths`, and returns an iterator
+    /// over the results in the order in which the files finish loading.
+    ///
+    /// Loading continues in the background while the iterator is alive.
+    /// If the iterator is dropped, the threads stop once the files they are
+    /// currently loading have finished.
+    pub fn load_many<I>(&self, paths: I) -> LoadMany
+    where
+        I: IntoIterator,
+        I::Item: Into<PathBuf>,
+    {
+        let mut jobs = paths
+            .into_iter()
+            .map(|path| {
+                let path = path.into();
+                // Files which cannot be read are sorted last, and their error
+                // is reported when they are loaded.
+                let len = fs::metadata(&path).map_or(0, |m| m.len());
+                (path, len)
+            })
+            .collect::<Vec<_>>();
+        jobs.sort_by(|a, b| b.1.cmp(&a.1));
+
+        let num_jobs = jobs.len();
+        let num_threads = match self.num_threads {
+            0 => thread::available_parallelism().map_or(1, |n| n.get()),
+            n => n,
+        }
+        .min(num_jobs);
+
+        let queue = Arc::new(Queue {
+            next: AtomicUsize::new(0),
+            paths: jobs.into_iter().map(|(path, _)| path).collect(),
+        });
+        let skeletons = if self.dedupe_skeletons {
+            Some(Arc::new(SkeletonCache::new()))
+        } else {
+            None
+        };
+        let (sender, receiver) = mpsc::channel();
+
+        for _ in 0..num_threads {
+            let queue = Arc::clone(&queue);
+            let skeletons = skeletons.clone();
+            let sender = sender.clone();
+            let reuse_buffers = self.reuse_buffers;
+            thread::spawn(move || load_queue(&queue, skeletons.as_deref(), &sender, reuse_buffers));
+        }
+
+        LoadMany {
+            receiver,
+            remaining: num_jobs,
+        }
+    }
+}
+
+/// The files waiting to be loaded, from largest to smallest.
+struct Queue {
+    next: AtomicUsize,
+    paths: Vec<PathBuf>,
+}
+
+/// Loads files from `queue` until it is empty, or the results are no longer
+/// wanted. If `skeletons` is given, then the skeleton of each file is shared
+/// with the other files through it.
+fn load_queue(
+    queue: &Queue,
+    skeletons: Option<&SkeletonCache>,
+    sender: &Sender<(PathBuf, Result<Bvh, LoadError>)>,
+    reuse_buffers: bool,
+) {
+    let mut buffer = Vec::new();
+
+    loop {
+        let index = queue.next.fetch_add(1, Ordering::Relaxed);
+        let path = match queue.paths.get(index) {
+            Some(path) => path,
+            None => return,
+        };
+
+        // A panic while loading one file is reported as that file's error,
+        // so that it does not stop the thread from loading the rest.
+        let loaded = panic::catch_unwind(AssertUnwindSafe(|| {
+            if reuse_buffers {
+                load_with_buffer(path, &mut buffer)
+            } else {
+                Bvh::from_path(path)
+            }
+        }));
+        let mut result = loaded.unwrap_or_else(|payload| {
+            buffer = Vec::new();
+            Err(LoadErrorKind::Panicked {
+                message: panic_message(&*payload),
+            }
+            .into())
+        });
+
+        if let (Some(skeletons), Ok(ref mut bvh)) = (skeletons, &mut result) {
+            skeletons.dedupe(bvh);
+        }
+
+        if sender.send((path.clone(), result)).is_err() {
+            return;
+        }
+    }
+}
+
+/// Returns the message of a panic with the given `payload`.
+fn panic_message(payload: &(dyn Any + Send)) -> String {
+    if let Some(message) = payload.downcast_ref::<&str>() {
+        (*message).to_owned()
+    } else if let Some(message) = payload.downcast_ref::<String>() {
+        message.clone()
+    } else {
+        String::from("no message")
+    }
+}
+
+/// Reads the file at `path` into `buffer`, and parses it.
+fn load_with_buffer(path: &Path, buffer: &mut Vec<u8>) -> Result<Bvh, LoadError> {
+    buffer.clear();
+    File::open(path)
+        .and_then(|mut file| file.read_to_end(buffer))
+        .map_err(LoadJointsError::Io)?;
+
+    Bvh::from_bytes(&buffer[..])
+}
+
+/// An iterator over the results of [`BatchLoader::load_many`]
+/// [`BatchLoader::load_many`], in the order in which the files finish loading.
+///
+/// [`BatchLoader::load_many`]: struct.BatchLoader.html#method.load_many
+pub struct LoadMany {
+    receiver: Receiver<(PathBuf, Result<Bvh, LoadError>)>,
+    remaining: usize,
+}
+
+impl Iterator for LoadMany {
+    type Item = (PathBuf, Result<Bvh, LoadError>);
+
+    #[inline]
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.remaining == 0 {
+            return None;
+        }
+
+        match self.receiver.recv() {
+            Ok(result) => {
+                self.remaining -= 1;
+                Some(result)
+            }
+            // Every loading thread has exited, so no more results will arrive.
+            Err(_) => {
+                self.remaining = 0;
+                None
+            }
+        }
+    }
+
+    /// There is at most one result for each file, but fewer are yielded if
+    /// the loading threads exit early.
+    #[inline]
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        (0, Some(self.remaining))
+    }
+}
+
+impl fmt::Debug for LoadMany {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("LoadMany")
+            .field("remaining", &self.remaining)
+            .finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn panics_become_panicked_errors() {
+        let payload = panic::catch_unwind(|| panic!("bad joint {}", 3)).unwrap_err();
+        assert_eq!(panic_message(&*payload), "bad joint 3");
+
+        let payload = panic::catch_unwind(|| panic!("static message")).unwrap_err();
+        let error = LoadError::from(LoadErrorKind::Panicked {
+            message: panic_message(&*payload),
+        });
+        assert_eq!(error.line(), None);
+        assert_eq!(error.to_string(), "The parser panicked: static message");
+    }
+}
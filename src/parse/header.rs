@@ -0,0 +1,124 @@
+//! Loading only the hierarchy and frame metadata of a `bvh` file.
+
+use super::lines::EnumeratedLines;
+use crate::{
+    errors::{LoadError, LoadJointsError},
+    joint::Skeleton,
+    Bvh, Joint, Joints,
+};
+use bstr::io::BufReadExt;
+use std::{fs::File, io::BufReader, path::Path, sync::Arc, time::Duration};
+
+/// The hierarchy and frame metadata of a `bvh` file, without its motion values.
+///
+/// Loading a `BvhHeader` stops as soon as the `Frame Time:` line has been read,
+/// so the time taken to load it only depends on the size of the hierarchy, and
+/// not on the number of frames in the file. This is useful when only the joints
+/// of many files need to be inspected, such as when indexing a library of clips.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use bvh_anim::BvhHeader;
+/// let header = BvhHeader::from_path("./path/to/anim.bvh")?;
+/// for joint in header.joints() {
+///     println!("{}", String::from_utf8_lossy(joint.name()));
+/// }
+/// println!("{} frames", header.num_frames());
+/// # Result::<(), bvh_anim::errors::LoadError>::Ok(())
+/// ```
+#[derive(Clone, Debug, PartialEq)]
+pub struct BvhHeader {
+    /// The hierarchy and frame time of the file, which never has any motion
+    /// values.
+    bvh: Bvh,
+    /// The number of frames promised by the `Frames:` line.
+    num_frames: usize,
+}
+
+impl BvhHeader {
+    /// Loads the `BvhHeader` from the start of `reader`. Only the lines up to and
+    /// including the `Frame Time:` line are read.
+    #[inline]
+    pub fn from_reader<R: BufReadExt>(mut reader: R) -> Result<Self, LoadError> {
+        BvhHeader::from_lines(&mut EnumeratedLines::from_reader(&mut reader))
+    }
+
+    /// Loads the `BvhHeader` from the start of `bytes`.
+    #[inline]
+    pub fn from_bytes<B: AsRef<[u8]>>(bytes: B) -> Result<Self, LoadError> {
+        BvhHeader::from_lines(&mut EnumeratedLines::from_bytes(bytes.as_ref()))
+    }
+
+    /// Loads the `BvhHeader` from the file at `path`. Only the start of the file
+    /// is read.
+    #[inline]
+    pub fn from_path<P: AsRef<Path>>(path: P) -> Result<Self, LoadError> {
+        let file = File::open(path).map_err(LoadJointsError::Io)?;
+        BvhHeader::from_reader(BufReader::new(file))
+    }
+
+    /// Parse the hierarchy and frame metadata from `lines`, leaving `lines` at
+    /// the start of the motion values.
+    pub(crate) fn from_lines(lines: &mut EnumeratedLines<'_>) -> Result<Self, LoadError> {
+        let mut bvh = Bvh::default();
+
+        bvh.read_joints(lines)?;
+        let num_frames = bvh.read_motion_header(lines)?;
+
+        Ok(BvhHeader::from_parts(bvh, num_frames))
+    }
+
+    /// Create a `BvhHeader` from a `bvh` which has no motion values.
+    #[inline]
+    pub(crate) fn from_parts(bvh: Bvh, num_frames: usize) -> Self {
+        debug_assert!(bvh.motion.is_empty());
+        BvhHeader { bvh, num_frames }
+    }
+
+    /// Returns the root `Joint` of the hierarchy, or `None` if it is empty.
+    #[inline]
+    pub fn root_joint(&self) -> Option<Joint<'_>> {
+        self.bvh.root_joint()
+    }
+
+    /// Returns an iterator over all the `Joint`s in the hierarchy.
+    #[inline]
+    pub fn joints(&self) -> Joints<'_> {
+        self.bvh.joints()
+    }
+
+    /// Returns the skeleton of the hierarchy, which is shared with the `Bvh`
+    /// returned from [`into_bvh`][`BvhHeader::into_bvh`].
+    ///
+    /// [`BvhHeader::into_bvh`]: struct.BvhHeader.html#method.into_bvh
+    #[inline]
+    pub fn skeleton(&self) -> &Arc<Skeleton> {
+        self.bvh.skeleton()
+    }
+
+    /// Get the number of channels in each frame.
+    #[inline]
+    pub fn num_channels(&self) -> usize {
+        self.bvh.num_channels()
+    }
+
+    /// Get the number of frames promised by the `Frames:` line of the file.
+    #[inline]
+    pub fn num_frames(&self) -> usize {
+        self.num_frames
+    }
+
+    /// Get the duration each frame should play for.
+    #[inline]
+    pub fn frame_time(&self) -> &Duration {
+        self.bvh.frame_time()
+    }
+
+    /// Converts the `BvhHeader` into a `Bvh` with the same hierarchy and frame
+    /// time, but no frames.
+    #[inline]
+    pub fn into_bvh(self) -> Bvh {
+        self.bvh
+    }
+}
@@ -0,0 +1,311 @@
+//! Parsing the `HIERARCHY` section of a `bvh` file, one line at a time.
+
+use crate::{
+    errors::LoadJointsError,
+    joint::{JointData, JointName},
+    Axis, Channel, ChannelType,
+};
+use bstr::ByteSlice;
+use lexical::parse;
+use smallvec::SmallVec;
+use std::{convert::TryFrom, mem};
+
+const HEIRARCHY_KEYWORD: &[u8] = b"HIERARCHY";
+
+const ROOT_KEYWORD: &[u8] = b"ROOT";
+const JOINT_KEYWORD: &[u8] = b"JOINT";
+const ENDSITE_KEYWORDS: &[&[u8]] = &[b"End", b"Site"];
+
+const OPEN_BRACE: &[u8] = b"{";
+const CLOSE_BRACE: &[u8] = b"}";
+
+const OFFSET_KEYWORD: &[u8] = b"OFFSET";
+const CHANNELS_KEYWORD: &[u8] = b"CHANNELS";
+
+#[derive(Debug, Eq, PartialEq)]
+enum ParseMode {
+    NotStarted,
+    InHeirarchy,
+    Finished,
+}
+
+#[allow(unused)]
+#[derive(Eq, PartialEq)]
+enum NextExpectedLine {
+    Hierarchy,
+    Channels,
+    Offset,
+    OpeningBrace,
+    ClosingBrace,
+    JointName,
+    RootName,
+}
+
+/// The state of the parser while it reads the `HIERARCHY` section.
+///
+/// Lines are passed in one at a time, so that the same logic can be used
+/// whether the whole file is available up front or not.
+pub(crate) struct HierarchyParser {
+    joints: Vec<JointData>,
+    curr_mode: ParseMode,
+    curr_channel: usize,
+    curr_index: usize,
+    curr_depth: usize,
+    next_expected_line: NextExpectedLine,
+    curr_joint: JointData,
+    in_end_site: bool,
+    pushed_end_site_joint: bool,
+    /// The index of the most recently pushed joint at each depth, which
+    /// is the parent of any joint pushed at the next depth down.
+    last_index_at_depth: Vec<usize>,
+    /// Names left over from a previously parsed hierarchy, in reverse order,
+    /// whose buffers are reused for the names of the new joints.
+    spare_names: Vec<JointName>,
+}
+
+impl HierarchyParser {
+    /// Create a new `HierarchyParser`, which expects the `HIERARCHY` keyword.
+    pub(crate) fn new() -> Self {
+        HierarchyParser::reusing(vec![])
+    }
+
+    /// Create a new `HierarchyParser` which stores the parsed joints in the
+    /// memory already allocated for `joints`, reusing the buffers of their
+    /// names where possible.
+    pub(crate) fn reusing(mut joints: Vec<JointData>) -> Self {
+        let spare_names = joints.drain(..).rev().map(JointData::into_name).collect();
+
+        HierarchyParser {
+            joints,
+            curr_mode: ParseMode::NotStarted,
+            curr_channel: 0,
+            curr_index: 0,
+            curr_depth: 0,
+            next_expected_line: NextExpectedLine::Hierarchy,
+            curr_joint: JointData::empty_root(),
+            in_end_site: false,
+            pushed_end_site_joint: false,
+            last_index_at_depth: vec![],
+            spare_names,
+        }
+    }
+
+    /// Parse the line `line_num` of the hierarchy, returning `true` once the
+    /// closing brace of the root joint has been reached.
+    pub(crate) fn parse_line(
+        &mut self,
+        line_num: usize,
+        line: &[u8],
+    ) -> Result<bool, LoadJointsError> {
+        let line = line.trim();
+
+        let mut tokens = line.fields_with(|c: char| c.is_ascii_whitespace() || c == ':');
+
+        let first_token = match tokens.next() {
+            Some(tok) => tok,
+            None => return Ok(false),
+        };
+
+        match first_token.as_bytes() {
+            HEIRARCHY_KEYWORD => {
+                if self.curr_mode != ParseMode::NotStarted {
+                    return Err(LoadJointsError::UnexpectedLine { line: line_num });
+                }
+                self.curr_mode = ParseMode::InHeirarchy;
+                self.next_expected_line = NextExpectedLine::RootName;
+            }
+            ROOT_KEYWORD => {
+                if self.curr_mode != ParseMode::InHeirarchy
+                    || self.next_expected_line != NextExpectedLine::RootName
+                {
+                    return Err(LoadJointsError::UnexpectedLine { line: line_num });
+                }
+
+                if let Some(name) = tokens.next() {
+                    self.set_curr_name(name);
+                } else {
+                    return Err(LoadJointsError::MissingJointName { line: line_num });
+                }
+            }
+            OPEN_BRACE => {
+                self.curr_depth += 1;
+            }
+            CLOSE_BRACE => {
+                // A brace which closes nothing, or which closes an end site
+                // without an opening brace, cannot be placed in the tree.
+                if self.curr_depth == 0 || (self.in_end_site && self.curr_depth == 1) {
+                    return Err(LoadJointsError::UnexpectedLine { line: line_num });
+                }
+                self.curr_depth -= 1;
+                if self.curr_depth == 0 {
+                    // We have closed the brace of the root joint.
+                    self.curr_mode = ParseMode::Finished;
+                }
+
+                if self.in_end_site {
+                    let parent_index = self.parent_index(self.curr_depth);
+                    if let JointData::Child {
+                        ref mut private, ..
+                    } = self.curr_joint
+                    {
+                        private.self_index = self.curr_index;
+                        private.parent_index = parent_index;
+                        private.depth = self.curr_depth - 1;
+                    }
+
+                    let new_joint = mem::replace(&mut self.curr_joint, JointData::empty_child());
+                    self.push_joint(new_joint);
+                    self.curr_index += 1;
+                    self.in_end_site = false;
+                    self.pushed_end_site_joint = true;
+                }
+            }
+            kw if kw == ENDSITE_KEYWORDS[0] => {
+                if tokens.next() == Some(ENDSITE_KEYWORDS[1]) {
+                    self.in_end_site = true;
+                } else {
+                    return Err(LoadJointsError::UnexpectedLine { line: line_num });
+                }
+            }
+            JOINT_KEYWORD => {
+                if self.curr_mode != ParseMode::InHeirarchy || self.curr_depth == 0 {
+                    return Err(LoadJointsError::UnexpectedLine { line: line_num });
+                }
+
+                if !self.pushed_end_site_joint {
+                    let parent_index = self.parent_index(self.curr_depth);
+                    if let JointData::Child {
+                        ref mut private, ..
+                    } = self.curr_joint
+                    {
+                        private.self_index = self.curr_index;
+                        private.parent_index = parent_index;
+                        private.depth = self.curr_depth - 1;
+                    }
+
+                    let new_joint = mem::replace(&mut self.curr_joint, JointData::empty_child());
+                    self.push_joint(new_joint);
+
+                    self.curr_index += 1;
+                } else {
+                    self.pushed_end_site_joint = false;
+                }
+
+                if let Some(name) = tokens.next() {
+                    self.set_curr_name(name);
+                } else {
+                    return Err(LoadJointsError::MissingJointName { line: line_num });
+                }
+            }
+            OFFSET_KEYWORD => {
+                if self.curr_mode != ParseMode::InHeirarchy {
+                    return Err(LoadJointsError::UnexpectedOffsetSection { line: line_num });
+                }
+
+                let mut offset = [0.0, 0.0, 0.0];
+
+                macro_rules! parse_axis {
+                    ($axis_field:literal, $axis_enum:ident) => {
+                        if let Some(tok) = tokens.next() {
+                            offset[$axis_field] =
+                                parse(tok).map_err(|e| LoadJointsError::ParseOffsetError {
+                                    parse_float_error: e,
+                                    axis: Axis::$axis_enum,
+                                    line: line_num,
+                                })?;
+                        } else {
+                            return Err(LoadJointsError::MissingOffsetAxis {
+                                axis: Axis::$axis_enum,
+                                line: line_num,
+                            });
+                        }
+                    };
+                }
+
+                parse_axis!(0, X);
+                parse_axis!(1, Y);
+                parse_axis!(2, Z);
+
+                self.curr_joint.set_offset(offset, self.in_end_site);
+            }
+            CHANNELS_KEYWORD => {
+                if self.curr_mode != ParseMode::InHeirarchy {
+                    return Err(LoadJointsError::UnexpectedChannelsSection { line: line_num });
+                }
+
+                let num_channels: usize = tokens
+                    .next()
+                    .ok_or(LoadJointsError::ParseNumChannelsError {
+                        error: None,
+                        line: line_num,
+                    })
+                    .and_then(|tok| match parse(tok) {
+                        Ok(c) => Ok(c),
+                        Err(e) => Err(LoadJointsError::ParseNumChannelsError {
+                            error: Some(e),
+                            line: line_num,
+                        }),
+                    })?;
+
+                let mut channels: SmallVec<[Channel; 6]> = Default::default();
+                channels.reserve(num_channels);
+
+                while let Some(tok) = tokens.next() {
+                    let channel_ty = ChannelType::try_from(tok).map_err(|e| {
+                        LoadJointsError::ParseChannelError {
+                            error: e,
+                            line: line_num,
+                        }
+                    })?;
+                    let channel = Channel::new(channel_ty, self.curr_channel);
+                    self.curr_channel += 1;
+                    channels.push(channel);
+                }
+
+                self.curr_joint.set_channels(channels);
+            }
+            _ => {}
+        }
+
+        Ok(self.curr_mode == ParseMode::Finished)
+    }
+
+    /// Returns the joints and the number of channels in the hierarchy.
+    ///
+    /// # Errors
+    ///
+    /// Returns a `MissingRoot` error if the hierarchy is incomplete.
+    pub(crate) fn finish(self) -> Result<(Vec<JointData>, usize), LoadJointsError> {
+        if self.curr_mode != ParseMode::Finished {
+            return Err(LoadJointsError::MissingRoot);
+        }
+
+        Ok((self.joints, self.curr_channel))
+    }
+
+    #[inline]
+    fn set_curr_name(&mut self, name: &[u8]) {
+        let mut new_name = self.spare_names.pop().unwrap_or_default();
+        new_name.0.clear();
+        new_name.0.extend_from_slice(name);
+        self.curr_joint.set_name(new_name);
+    }
+
+    #[inline]
+    fn parent_index(&self, for_depth: usize) -> usize {
+        self.last_index_at_depth
+            .get(for_depth.saturating_sub(2))
+            .copied()
+            .unwrap_or(0)
+    }
+
+    #[inline]
+    fn push_joint(&mut self, joint: JointData) {
+        let depth = joint.depth();
+        if self.last_index_at_depth.len() <= depth {
+            self.last_index_at_depth.resize(depth + 1, 0);
+        }
+        self.last_index_at_depth[depth] = joint.private_data().map_or(0, |p| p.self_index);
+        self.joints.push(joint);
+    }
+}
@@ -0,0 +1,404 @@
+//! Parsing a `bvh` file from chunks of bytes as they arrive.
+
+use super::{
+    header::BvhHeader,
+    hierarchy::HierarchyParser,
+    motion_header::MotionHeaderParser,
+    tokenize::{for_each_motion_value, parse_motion_line},
+};
+use crate::{
+    errors::{LoadError, LoadErrorKind, LoadJointsError, LoadMotionError},
+    motion::Motion,
+    Bvh,
+};
+use bstr::ByteSlice;
+use std::{fmt, io, mem};
+
+/// A push parser which is fed a `bvh` file in chunks of any size.
+///
+/// The chunk boundaries do not have to line up with lines or tokens: any
+/// incomplete line at the end of a chunk is held back until the rest of it
+/// arrives. Each complete line is parsed as soon as it is fed, so the hierarchy
+/// becomes available through [`header`][`BvhParser::header`] as soon as the
+/// `Frame Time:` line arrives, and each frame becomes available through
+/// [`frames`][`BvhParser::frames`] as soon as its row is complete.
+///
+/// Feeding every chunk of a file and then calling [`finish`][`BvhParser::finish`]
+/// gives the same result as calling [`Bvh::from_bytes`][`Bvh::from_bytes`] on the
+/// whole file.
+///
+/// # Examples
+///
+/// ```
+/// # use bvh_anim::BvhParser;
+/// # let bytes = std::fs::read("./data/test_mocapbank.bvh")?;
+/// let mut parser = BvhParser::new();
+/// let mut frames = vec![];
+///
+/// for chunk in bytes.chunks(1024) {
+///     parser.feed(chunk)?;
+///     parser.take_frames(&mut frames);
+/// }
+///
+/// let skeleton = parser.finish()?;
+/// assert_eq!(frames.len(), skeleton.num_channels() * 455);
+/// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+/// ```
+///
+/// [`BvhParser::header`]: struct.BvhParser.html#method.header
+/// [`BvhParser::frames`]: struct.BvhParser.html#method.frames
+/// [`BvhParser::finish`]: struct.BvhParser.html#method.finish
+/// [`Bvh::from_bytes`]: struct.Bvh.html#method.from_bytes
+pub struct BvhParser {
+    state: ParserState,
+    /// The joints parsed so far, which are moved into `header` once the
+    /// `Frame Time:` line has been parsed.
+    bvh: Bvh,
+    header: Option<BvhHeader>,
+    /// The start of a line whose end has not been fed yet.
+    partial_line: Vec<u8>,
+    /// The index of the next line to be parsed.
+    next_line: usize,
+    /// Motion values which have been parsed, but not yet taken.
+    motion_values: Vec<f32>,
+    /// The number of motion values which have been taken with `take_frames`.
+    values_taken: usize,
+    /// The maximum number of bytes of motion values in the file.
+    max_motion_bytes: Option<usize>,
+}
+
+enum ParserState {
+    Hierarchy(HierarchyParser),
+    MotionHeader(MotionHeaderParser),
+    Motion,
+    /// An error has been returned, on the given line if it had one.
+    Failed {
+        line: Option<usize>,
+    },
+}
+
+impl Default for BvhParser {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl BvhParser {
+    /// Create a new `BvhParser`, which expects the start of a `bvh` file.
+    #[inline]
+    pub fn new() -> Self {
+        BvhParser {
+            state: ParserState::Hierarchy(HierarchyParser::new()),
+            bvh: Bvh::default(),
+            header: None,
+            partial_line: Vec::new(),
+            next_line: 0,
+            motion_values: Vec::new(),
+            values_taken: 0,
+            max_motion_bytes: None,
+        }
+    }
+
+    /// Sets the maximum number of bytes which the motion values of the file
+    /// may take up, including any frames which have been taken with
+    /// [`take_frames`][`BvhParser::take_frames`].
+    ///
+    /// If the limit is exceeded, then `feed` returns a `MotionLimitExceeded`
+    /// error. The limit is checked before each value is stored, and it also
+    /// bounds the length of a line which is held back while waiting for its
+    /// end, so a single line which never ends cannot use unbounded memory. A
+    /// line of the hierarchy which is longer than the limit is reported as a
+    /// `LineTooLong` error instead. This is useful when parsing files from
+    /// untrusted sources.
+    ///
+    /// [`BvhParser::take_frames`]: struct.BvhParser.html#method.take_frames
+    #[inline]
+    pub fn with_max_motion_bytes<L>(self, max_motion_bytes: L) -> Self
+    where
+        L: Into<Option<usize>>,
+    {
+        BvhParser {
+            max_motion_bytes: max_motion_bytes.into(),
+            ..self
+        }
+    }
+
+    /// Parse every line which is completed by `chunk`.
+    ///
+    /// # Errors
+    ///
+    /// Returns the first error found in the lines completed by `chunk`. Once
+    /// an error has been returned, every later call to `feed` or `finish`
+    /// returns a `ParserFailed` error, which records the line of the first
+    /// error.
+    pub fn feed(&mut self, chunk: &[u8]) -> Result<(), LoadError> {
+        self.check_not_failed()?;
+
+        let result = self.feed_lines(chunk);
+        if let Err(ref e) = result {
+            self.state = ParserState::Failed { line: e.line() };
+        }
+        result
+    }
+
+    /// Returns a `ParserFailed` error if the parser has already returned an
+    /// error.
+    #[inline]
+    fn check_not_failed(&self) -> Result<(), LoadError> {
+        match self.state {
+            ParserState::Failed { line } => Err(LoadErrorKind::ParserFailed { line }.into()),
+            _ => Ok(()),
+        }
+    }
+
+    fn feed_lines(&mut self, mut chunk: &[u8]) -> Result<(), LoadError> {
+        if !self.partial_line.is_empty() {
+            let end = match chunk.find_byte(b'\n') {
+                Some(end) => end,
+                None => {
+                    self.check_line_len(self.partial_line.len() + chunk.len())?;
+                    self.partial_line.extend_from_slice(chunk);
+                    return Ok(());
+                }
+            };
+
+            self.check_line_len(self.partial_line.len() + end)?;
+            let mut line = mem::take(&mut self.partial_line);
+            line.extend_from_slice(&chunk[..end]);
+            let result = self.parse_line(strip_cr(&line));
+            line.clear();
+            self.partial_line = line;
+            result?;
+
+            chunk = &chunk[end + 1..];
+        }
+
+        while let Some(end) = chunk.find_byte(b'\n') {
+            self.parse_line(strip_cr(&chunk[..end]))?;
+            chunk = &chunk[end + 1..];
+        }
+
+        self.check_line_len(chunk.len())?;
+        self.partial_line.extend_from_slice(chunk);
+        Ok(())
+    }
+
+    /// Returns an error if a line of `len` bytes would be longer than the
+    /// limit on the size of the motion values. The error is a `LineTooLong`
+    /// error in the hierarchy, and a `MotionLimitExceeded` error after it.
+    #[inline]
+    fn check_line_len(&self, len: usize) -> Result<(), LoadError> {
+        let limit = match self.max_motion_bytes {
+            Some(limit) if len > limit => limit,
+            _ => return Ok(()),
+        };
+
+        let line = self.next_line;
+        match self.state {
+            ParserState::Hierarchy(_) => Err(LoadJointsError::LineTooLong { limit, line }.into()),
+            _ => Err(LoadMotionError::MotionLimitExceeded { limit, line }.into()),
+        }
+    }
+
+    fn parse_line(&mut self, line: &[u8]) -> Result<(), LoadError> {
+        let line_num = self.next_line;
+        self.next_line += 1;
+
+        match self.state {
+            ParserState::Hierarchy(ref mut hierarchy) => {
+                if hierarchy.parse_line(line_num, line)? {
+                    let failed = ParserState::Failed { line: None };
+                    let hierarchy = match mem::replace(&mut self.state, failed) {
+                        ParserState::Hierarchy(hierarchy) => hierarchy,
+                        _ => unreachable!(),
+                    };
+                    let (joints, num_channels) = hierarchy.finish()?;
+                    let skeleton = self.bvh.skeleton_to_overwrite();
+                    skeleton.joints = joints;
+                    skeleton.joint_index.rebuild_children(&skeleton.joints);
+                    self.bvh.num_channels = num_channels;
+                    self.state = ParserState::MotionHeader(MotionHeaderParser::new());
+                }
+            }
+            ParserState::MotionHeader(ref mut motion_header) => {
+                if motion_header.parse_line(line_num, line)? {
+                    let motion_header = match mem::replace(&mut self.state, ParserState::Motion) {
+                        ParserState::MotionHeader(motion_header) => motion_header,
+                        _ => unreachable!(),
+                    };
+                    let (num_frames, frame_time) = motion_header.finish();
+                    let mut bvh = mem::take(&mut self.bvh);
+                    bvh.frame_time = frame_time;
+                    self.header = Some(BvhHeader::from_parts(bvh, num_frames));
+                }
+            }
+            ParserState::Motion => match self.max_motion_bytes {
+                Some(limit) => {
+                    let max_values = limit / mem::size_of::<f32>();
+                    let values_taken = self.values_taken;
+                    let motion_values = &mut self.motion_values;
+                    for_each_motion_value(line, line_num, |value| {
+                        if values_taken + motion_values.len() == max_values {
+                            return Err(LoadMotionError::MotionLimitExceeded {
+                                limit,
+                                line: line_num,
+                            });
+                        }
+                        motion_values.push(value);
+                        Ok(())
+                    })?;
+                }
+                None => parse_motion_line(line, line_num, &mut self.motion_values)?,
+            },
+            ParserState::Failed { .. } => unreachable!(),
+        }
+
+        Ok(())
+    }
+
+    /// Converts an I/O error from the source of the chunks into a `LoadError`,
+    /// depending on which section of the file was being read.
+    pub(crate) fn io_error(&self, e: io::Error) -> LoadError {
+        match self.state {
+            ParserState::Hierarchy(_) => LoadJointsError::Io(e).into(),
+            _ => LoadMotionError::Io(e).into(),
+        }
+    }
+
+    /// Returns the hierarchy and frame metadata of the file, or `None` if the
+    /// `Frame Time:` line has not been fed yet.
+    #[inline]
+    pub fn header(&self) -> Option<&BvhHeader> {
+        self.header.as_ref()
+    }
+
+    /// Returns the motion values of every frame which has been completely
+    /// parsed, and not yet taken with [`take_frames`][`BvhParser::take_frames`].
+    ///
+    /// Frames are stored one after the other, in the same layout as the motion
+    /// values of a [`Bvh`][`Bvh`].
+    ///
+    /// [`BvhParser::take_frames`]: struct.BvhParser.html#method.take_frames
+    /// [`Bvh`]: struct.Bvh.html
+    #[inline]
+    pub fn frames(&self) -> &[f32] {
+        &self.motion_values[..self.num_completed_values()]
+    }
+
+    /// Moves the motion values of every completely parsed frame onto the end of
+    /// `out`, returning the number of frames moved.
+    ///
+    /// Frames which have been taken are not included in the `Bvh` returned from
+    /// [`finish`][`BvhParser::finish`], which means that the memory used while
+    /// parsing a clip can be kept bounded by taking frames after each call to
+    /// [`feed`][`BvhParser::feed`].
+    ///
+    /// [`BvhParser::finish`]: struct.BvhParser.html#method.finish
+    /// [`BvhParser::feed`]: struct.BvhParser.html#method.feed
+    pub fn take_frames(&mut self, out: &mut Vec<f32>) -> usize {
+        let num_values = self.num_completed_values();
+        out.extend(self.motion_values.drain(..num_values));
+        self.values_taken += num_values;
+
+        match self.header {
+            Some(ref header) if header.num_channels() != 0 => num_values / header.num_channels(),
+            _ => 0,
+        }
+    }
+
+    /// The number of values at the start of `motion_values` which make up
+    /// whole frames.
+    #[inline]
+    fn num_completed_values(&self) -> usize {
+        match self.header {
+            Some(ref header) if header.num_channels() != 0 => {
+                let len = self.motion_values.len();
+                len - len % header.num_channels()
+            }
+            _ => 0,
+        }
+    }
+
+    /// The number of frames which have been completely parsed, including any
+    /// frames which have been taken.
+    #[cfg(feature = "async")]
+    #[inline]
+    pub(crate) fn num_frames_parsed(&self) -> usize {
+        match self.header {
+            Some(ref header) if header.num_channels() != 0 => {
+                (self.values_taken + self.motion_values.len()) / header.num_channels()
+            }
+            _ => 0,
+        }
+    }
+
+    /// Parse the last line of the file, if it was not terminated by a newline,
+    /// and return the parsed `Bvh`.
+    ///
+    /// The returned `Bvh` only contains the frames which were not taken with
+    /// [`take_frames`][`BvhParser::take_frames`].
+    ///
+    /// # Errors
+    ///
+    /// As well as errors from parsing the last line, an error is returned if
+    /// the file is incomplete, or if the number of motion values does not match
+    /// the number of frames promised by the file. If a previous call to
+    /// `feed` returned an error, then a `ParserFailed` error is returned.
+    ///
+    /// [`BvhParser::take_frames`]: struct.BvhParser.html#method.take_frames
+    pub fn finish(mut self) -> Result<Bvh, LoadError> {
+        self.check_not_failed()?;
+
+        if !self.partial_line.is_empty() {
+            let line = mem::take(&mut self.partial_line);
+            self.parse_line(&line)?;
+        }
+
+        let last_line = self.next_line.checked_sub(1).unwrap_or(0);
+        match self.state {
+            ParserState::Hierarchy(_) => Err(LoadJointsError::MissingRoot.into()),
+            ParserState::MotionHeader(ref motion_header) => {
+                Err(motion_header.missing_line_error(last_line).into())
+            }
+            ParserState::Motion => {
+                let header = self.header.expect("the header is parsed before the motion");
+                let num_channels = header.num_channels();
+                let num_frames = header.num_frames();
+
+                let actual_total_motion_values = self.values_taken + self.motion_values.len();
+                let expected_total_motion_values = num_channels.saturating_mul(num_frames);
+                if actual_total_motion_values != expected_total_motion_values {
+                    return Err(LoadMotionError::MotionCountMismatch {
+                        actual_total_motion_values,
+                        expected_total_motion_values,
+                        expected_num_frames: num_frames,
+                        expected_num_clips: num_channels,
+                    }
+                    .into());
+                }
+
+                let mut bvh = header.into_bvh();
+                bvh.motion = Motion::from_vec(self.motion_values);
+                Ok(bvh)
+            }
+            ParserState::Failed { .. } => unreachable!(),
+        }
+    }
+}
+
+impl fmt::Debug for BvhParser {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("BvhParser")
+            .field("header", &self.header)
+            .field("next_line", &self.next_line)
+            .finish()
+    }
+}
+
+/// Strips the `\r` from a line which was terminated by `\r\n`.
+#[inline]
+fn strip_cr(line: &[u8]) -> &[u8] {
+    line.strip_suffix(b"\r").unwrap_or(line)
+}
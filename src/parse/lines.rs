@@ -0,0 +1,181 @@
+//! Line splitting for the `bvh` parser.
+
+use bstr::{io::BufReadExt, ByteSlice};
+use std::io;
+
+/// An enumerated sequence of lines which the parser consumes.
+///
+/// Lines are either borrowed directly from an in-memory slice, or read
+/// from a `BufReadExt` into a single buffer which is reused for every line.
+/// In both cases the line terminator (`\n` or `\r\n`) is stripped from the
+/// returned line, and no allocation is made per line.
+pub(crate) struct EnumeratedLines<'a> {
+    source: LineSource<'a>,
+    next_enumerator: usize,
+    last_enumerator: Option<usize>,
+}
+
+enum LineSource<'a> {
+    /// Lines are sliced out of a contiguous buffer without copying.
+    Bytes {
+        remaining: &'a [u8],
+        current: &'a [u8],
+    },
+    /// Lines are read from a reader into `buffer`, which holds the current
+    /// line (terminator included) in `buffer[..]`, and the current line
+    /// (terminator excluded) in `buffer[..line_len]`.
+    Reader {
+        reader: &'a mut dyn BufReadExt,
+        buffer: Vec<u8>,
+        line_len: usize,
+    },
+}
+
+impl<'a> EnumeratedLines<'a> {
+    /// Create a new `EnumeratedLines` which borrows each line from `bytes`.
+    #[inline]
+    pub(crate) fn from_bytes(bytes: &'a [u8]) -> Self {
+        EnumeratedLines {
+            source: LineSource::Bytes {
+                remaining: bytes,
+                current: &[],
+            },
+            next_enumerator: 0,
+            last_enumerator: None,
+        }
+    }
+
+    /// Create a new `EnumeratedLines` which reads each line from `reader`.
+    #[inline]
+    pub(crate) fn from_reader(reader: &'a mut dyn BufReadExt) -> Self {
+        EnumeratedLines::resume_reader(reader, Vec::new(), 0)
+    }
+
+    /// Create a new `EnumeratedLines` which carries on reading lines from
+    /// `reader`, where the next line has the index `next_enumerator`.
+    ///
+    /// The `buffer` is reused to hold each line, and can be retrieved again
+    /// with `into_reader_parts`.
+    #[inline]
+    pub(crate) fn resume_reader(
+        reader: &'a mut dyn BufReadExt,
+        buffer: Vec<u8>,
+        next_enumerator: usize,
+    ) -> Self {
+        EnumeratedLines {
+            source: LineSource::Reader {
+                reader,
+                buffer,
+                line_len: 0,
+            },
+            next_enumerator,
+            last_enumerator: next_enumerator.checked_sub(1),
+        }
+    }
+
+    /// Returns the index of the next line, and the line buffer, if the lines
+    /// are read from a reader.
+    #[inline]
+    pub(crate) fn into_reader_parts(self) -> Option<(usize, Vec<u8>)> {
+        match self.source {
+            LineSource::Reader { buffer, .. } => Some((self.next_enumerator, buffer)),
+            LineSource::Bytes { .. } => None,
+        }
+    }
+
+    /// Returns the index of the most recently returned line, or `None` if
+    /// no lines have been read yet.
+    #[inline]
+    pub(crate) fn last_enumerator(&self) -> Option<usize> {
+        self.last_enumerator
+    }
+
+    /// Returns the index of the next line, and every byte after the most
+    /// recently returned line, if the lines are borrowed from a slice.
+    #[inline]
+    pub(crate) fn remaining_bytes(&self) -> Option<(usize, &'a [u8])> {
+        match self.source {
+            LineSource::Bytes { remaining, .. } => Some((self.next_enumerator, remaining)),
+            LineSource::Reader { .. } => None,
+        }
+    }
+
+    /// Returns the next line along with its index, or `None` if there are no
+    /// more lines.
+    #[inline]
+    pub(crate) fn next_line(&mut self) -> Option<(usize, io::Result<&[u8]>)> {
+        match self.advance()? {
+            Ok(idx) => Some((idx, Ok(self.current()))),
+            Err((idx, e)) => Some((idx, Err(e))),
+        }
+    }
+
+    /// Moves on to the next line, returning its index.
+    fn advance(&mut self) -> Option<Result<usize, (usize, io::Error)>> {
+        let result = match self.source {
+            LineSource::Bytes {
+                ref mut remaining,
+                ref mut current,
+            } => {
+                if remaining.is_empty() {
+                    return None;
+                }
+
+                match remaining.find_byte(b'\n') {
+                    Some(end) => {
+                        let line = &remaining[..end];
+                        *current = line.strip_suffix(b"\r").unwrap_or(line);
+                        *remaining = &remaining[end + 1..];
+                    }
+                    None => {
+                        *current = remaining;
+                        *remaining = &[];
+                    }
+                }
+
+                Ok(())
+            }
+            LineSource::Reader {
+                ref mut reader,
+                ref mut buffer,
+                ref mut line_len,
+            } => {
+                buffer.clear();
+                match reader.read_until(b'\n', buffer) {
+                    Ok(0) => return None,
+                    Ok(_) => {
+                        let mut line = &buffer[..];
+                        if let Some(l) = line.strip_suffix(b"\n") {
+                            line = l.strip_suffix(b"\r").unwrap_or(l);
+                        }
+                        *line_len = line.len();
+                        Ok(())
+                    }
+                    Err(e) => {
+                        *line_len = 0;
+                        Err(e)
+                    }
+                }
+            }
+        };
+
+        let idx = self.next_enumerator;
+        self.next_enumerator += 1;
+        self.last_enumerator = Some(idx);
+
+        Some(result.map(|_| idx).map_err(|e| (idx, e)))
+    }
+
+    /// The most recently read line.
+    #[inline]
+    fn current(&self) -> &[u8] {
+        match self.source {
+            LineSource::Bytes { current, .. } => current,
+            LineSource::Reader {
+                ref buffer,
+                line_len,
+                ..
+            } => &buffer[..line_len],
+        }
+    }
+}
@@ -0,0 +1,216 @@
+//! Contains options for loading `bvh` files.
+
+use crate::{
+    errors::{LoadError, LoadJointsError, LoadMotionError},
+    joint::Skeleton,
+    motion::Motion,
+    Bvh,
+};
+use std::{mem, time::Duration};
+
+#[cfg(feature = "async")]
+pub use self::async_read::{AsyncLoader, LoadAsync};
+pub use self::batch::{BatchLoader, LoadMany};
+pub use self::header::BvhHeader;
+use self::hierarchy::HierarchyParser;
+pub use self::incremental::BvhParser;
+pub(crate) use self::lines::EnumeratedLines;
+use self::motion_header::MotionHeaderParser;
+pub use self::options::ParseOptions;
+pub use self::pipelined::{PipelineStats, PipelinedLoader};
+pub use self::stream::MotionStream;
+use self::tokenize::parse_motion_line;
+
+#[cfg(feature = "async")]
+mod async_read;
+mod batch;
+mod header;
+mod hierarchy;
+mod incremental;
+mod lines;
+mod motion_header;
+mod options;
+mod parallel;
+mod pipelined;
+mod stream;
+mod tokenize;
+
+/// The most motion values which are reserved up front when the size of the
+/// input is not known. Larger clips grow geometrically as they are parsed.
+const MAX_UNSIZED_RESERVATION: usize = 1 << 16;
+
+/// Returns the number of motion values to reserve space for before parsing
+/// the motion section, where the header claims that there are `expected`
+/// values, and `remaining_len` bytes of input are left, if that is known.
+///
+/// The header is not trusted: each value takes up at least two bytes of input
+/// (one digit and one separator), so no more than that is reserved.
+pub(crate) fn motion_reservation(expected: usize, remaining_len: Option<usize>) -> usize {
+    let max_values = match remaining_len {
+        Some(len) => len / 2 + 1,
+        None => MAX_UNSIZED_RESERVATION,
+    };
+    expected.min(max_values)
+}
+
+impl Bvh {
+    /// Parse a complete `Bvh` from the given `lines`.
+    #[inline(never)]
+    pub(crate) fn from_lines(mut lines: EnumeratedLines<'_>) -> Result<Self, LoadError> {
+        let mut bvh = Bvh::default();
+
+        bvh.read_joints(&mut lines)?;
+        bvh.read_motion(&mut lines)?;
+
+        Ok(bvh)
+    }
+
+    /// Clear `self`, and then parse a complete `Bvh` from `lines` into it,
+    /// reusing the memory of its joints and motion values. If an error is
+    /// returned, then `self` is left empty.
+    pub(crate) fn reparse_lines(
+        &mut self,
+        mut lines: EnumeratedLines<'_>,
+    ) -> Result<(), LoadError> {
+        self.motion.clear();
+        self.num_channels = 0;
+        self.frame_time = Duration::default();
+
+        let result = match self.read_joints(&mut lines) {
+            Ok(()) => self.read_motion(&mut lines).map_err(LoadError::from),
+            Err(e) => Err(e.into()),
+        };
+
+        if result.is_err() {
+            self.skeleton_to_overwrite().joints_mut().clear();
+            self.motion.clear();
+            self.num_channels = 0;
+            self.frame_time = Duration::default();
+        }
+
+        result
+    }
+
+    /// Parse a complete `Bvh` from `bytes`, parsing the motion values on up
+    /// to `num_threads` threads.
+    #[inline(never)]
+    pub(crate) fn from_bytes_parallel_impl(
+        bytes: &[u8],
+        num_threads: usize,
+    ) -> Result<Self, LoadError> {
+        let mut lines = EnumeratedLines::from_bytes(bytes);
+        let mut bvh = Bvh::default();
+
+        bvh.read_joints(&mut lines)?;
+        let num_frames = bvh.read_motion_header(&mut lines)?;
+
+        let (first_line, body) = lines
+            .remaining_bytes()
+            .expect("lines are always borrowed from a slice");
+        match parallel::parse_motion_values(body, first_line, bvh.num_channels, num_threads)? {
+            Some(motion_values) => {
+                bvh.motion = Motion::from_vec(motion_values);
+                bvh.check_motion_count(num_frames)?;
+            }
+            None => bvh.read_motion_values(&mut lines, num_frames)?,
+        }
+
+        Ok(bvh)
+    }
+
+    /// Logic for parsing the data from a `BufRead`.
+    pub(crate) fn read_joints(
+        &mut self,
+        lines: &mut EnumeratedLines<'_>,
+    ) -> Result<(), LoadJointsError> {
+        // The lookup tables are left empty if parsing fails, and their memory
+        // is reused if it succeeds.
+        let skeleton = self.skeleton_to_overwrite();
+        let mut joint_index = mem::take(&mut skeleton.joint_index);
+        let mut hierarchy = HierarchyParser::reusing(mem::take(&mut skeleton.joints));
+
+        while let Some((line_num, line)) = lines.next_line() {
+            if hierarchy.parse_line(line_num, line?)? {
+                break;
+            }
+        }
+
+        let (joints, num_channels) = hierarchy.finish()?;
+        joint_index.rebuild_children(&joints);
+        *skeleton = Skeleton {
+            joints,
+            joint_index,
+        };
+        self.num_channels = num_channels;
+
+        Ok(())
+    }
+
+    pub(crate) fn read_motion(
+        &mut self,
+        lines: &mut EnumeratedLines<'_>,
+    ) -> Result<(), LoadMotionError> {
+        let num_frames = self.read_motion_header(lines)?;
+        self.read_motion_values(lines, num_frames)
+    }
+
+    /// Reads the `MOTION`, `Frames:` and `Frame Time:` lines, and returns the
+    /// number of frames.
+    fn read_motion_header(
+        &mut self,
+        lines: &mut EnumeratedLines<'_>,
+    ) -> Result<usize, LoadMotionError> {
+        let mut header = MotionHeaderParser::new();
+
+        loop {
+            match lines.next_line() {
+                Some((line_num, line)) => {
+                    if header.parse_line(line_num, line?)? {
+                        break;
+                    }
+                }
+                None => return Err(header.missing_line_error(lines.last_enumerator().unwrap_or(0))),
+            }
+        }
+
+        let (num_frames, frame_time) = header.finish();
+        self.frame_time = frame_time;
+
+        Ok(num_frames)
+    }
+
+    /// Reads every remaining line as a row of motion values.
+    fn read_motion_values(
+        &mut self,
+        lines: &mut EnumeratedLines<'_>,
+        num_frames: usize,
+    ) -> Result<(), LoadMotionError> {
+        let remaining_len = lines.remaining_bytes().map(|(_, bytes)| bytes.len());
+        let reservation =
+            motion_reservation(self.num_channels.saturating_mul(num_frames), remaining_len);
+        let values = self.motion.vec_mut();
+        values.reserve(reservation);
+
+        while let Some((line_num, line)) = lines.next_line() {
+            let line = line?;
+            parse_motion_line(line, line_num, values)?;
+        }
+
+        self.check_motion_count(num_frames)
+    }
+
+    /// Checks that the number of motion values read matches the header.
+    fn check_motion_count(&self, num_frames: usize) -> Result<(), LoadMotionError> {
+        let expected_total_motion_values = self.num_channels.saturating_mul(num_frames);
+        if self.motion.len() != expected_total_motion_values {
+            return Err(LoadMotionError::MotionCountMismatch {
+                actual_total_motion_values: self.motion.len(),
+                expected_total_motion_values,
+                expected_num_frames: num_frames,
+                expected_num_clips: self.num_channels,
+            });
+        }
+
+        Ok(())
+    }
+}
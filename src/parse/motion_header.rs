@@ -0,0 +1,186 @@
+//! Parsing the `MOTION`, `Frames:` and `Frame Time:` lines of a `bvh` file.
+
+use crate::errors::LoadMotionError;
+use bstr::ByteSlice;
+use lexical::parse;
+use std::{str, time::Duration};
+
+const MOTION_KEYWORD: &[u8] = b"MOTION";
+const FRAMES_KEYWORD: &[u8] = b"Frames";
+const FRAME_TIME_KEYWORDS: &[&[u8]] = &[b"Frame", b"Time:"];
+
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+enum NextExpectedLine {
+    Motion,
+    NumFrames,
+    FrameTime,
+    Finished,
+}
+
+/// The state of the parser while it reads the lines between the hierarchy
+/// and the motion values.
+pub(crate) struct MotionHeaderParser {
+    next_expected_line: NextExpectedLine,
+    num_frames: usize,
+    frame_time: Duration,
+}
+
+impl MotionHeaderParser {
+    /// Create a new `MotionHeaderParser`, which expects the `MOTION` keyword.
+    pub(crate) fn new() -> Self {
+        MotionHeaderParser {
+            next_expected_line: NextExpectedLine::Motion,
+            num_frames: 0,
+            frame_time: Duration::default(),
+        }
+    }
+
+    /// Parse the line `line_num`, returning `true` once the `Frame Time:` line
+    /// has been parsed. Lines which only contain whitespace are skipped.
+    pub(crate) fn parse_line(
+        &mut self,
+        line_num: usize,
+        line: &[u8],
+    ) -> Result<bool, LoadMotionError> {
+        if line.trim().is_empty() {
+            return Ok(self.next_expected_line == NextExpectedLine::Finished);
+        }
+
+        self.next_expected_line = match self.next_expected_line {
+            NextExpectedLine::Motion => {
+                parse_motion_keyword(line_num, line)?;
+                NextExpectedLine::NumFrames
+            }
+            NextExpectedLine::NumFrames => {
+                self.num_frames = parse_num_frames(line_num, line)?;
+                NextExpectedLine::FrameTime
+            }
+            NextExpectedLine::FrameTime => {
+                self.frame_time = parse_frame_time(line_num, line)?;
+                NextExpectedLine::Finished
+            }
+            NextExpectedLine::Finished => NextExpectedLine::Finished,
+        };
+
+        Ok(self.next_expected_line == NextExpectedLine::Finished)
+    }
+
+    /// Returns the error to report if the input ends before the header is
+    /// complete, where `last_line` is the index of the last line read.
+    pub(crate) fn missing_line_error(&self, last_line: usize) -> LoadMotionError {
+        match self.next_expected_line {
+            NextExpectedLine::Motion => LoadMotionError::MissingMotionSection { line: last_line },
+            NextExpectedLine::NumFrames => LoadMotionError::MissingNumFrames {
+                parse_error: None,
+                line: last_line,
+            },
+            NextExpectedLine::FrameTime | NextExpectedLine::Finished => {
+                LoadMotionError::MissingFrameTime {
+                    parse_error: None,
+                    line: last_line,
+                }
+            }
+        }
+    }
+
+    /// Returns the number of frames and the frame time.
+    #[inline]
+    pub(crate) fn finish(self) -> (usize, Duration) {
+        (self.num_frames, self.frame_time)
+    }
+}
+
+fn parse_motion_keyword(line_num: usize, line: &[u8]) -> Result<(), LoadMotionError> {
+    let line = line.trim();
+    if line != MOTION_KEYWORD {
+        return Err(LoadMotionError::MissingMotionSection { line: line_num });
+    }
+
+    Ok(())
+}
+
+fn parse_num_frames(line_num: usize, line: &[u8]) -> Result<usize, LoadMotionError> {
+    let line = line.trim();
+    let mut tokens = line.fields_with(|c: char| c.is_ascii_whitespace() || c == ':');
+
+    if tokens.next() != Some(FRAMES_KEYWORD) {
+        return Err(LoadMotionError::MissingNumFrames {
+            parse_error: None,
+            line: line_num,
+        });
+    }
+
+    let parse_num_frames = |token: Option<&[u8]>| {
+        if let Some(num_frames) = token.and_then(|b| str::from_utf8(b).ok()) {
+            parse::<usize, _>(num_frames)
+                .map_err(|e| LoadMotionError::MissingNumFrames {
+                    parse_error: Some(e),
+                    line: line_num,
+                })
+                .map_err(Into::into)
+        } else {
+            Err(LoadMotionError::MissingNumFrames {
+                parse_error: None,
+                line: line_num,
+            })
+        }
+    };
+
+    match tokens.next() {
+        Some(tok) if tok == b":" => parse_num_frames(tokens.next()),
+        Some(tok) => parse_num_frames(Some(tok)),
+        None => Err(LoadMotionError::MissingNumFrames {
+            parse_error: None,
+            line: line_num,
+        }),
+    }
+}
+
+fn parse_frame_time(line_num: usize, line: &[u8]) -> Result<Duration, LoadMotionError> {
+    let mut tokens = line.fields();
+
+    let frame_time_kw = tokens.next();
+    if frame_time_kw == FRAME_TIME_KEYWORDS.get(0).map(|b| *b) {
+        // do nothing
+    } else {
+        return Err(LoadMotionError::MissingFrameTime {
+            parse_error: None,
+            line: line_num,
+        });
+    }
+
+    let frame_time_kw = tokens.next();
+    if frame_time_kw == FRAME_TIME_KEYWORDS.get(1).map(|b| *b) {
+        // do nothing
+    } else {
+        return Err(LoadMotionError::MissingFrameTime {
+            parse_error: None,
+            line: line_num,
+        });
+    }
+
+    let parse_frame_time = |token: Option<&[u8]>| {
+        if let Some(frame_time) = token {
+            let frame_time_secs =
+                parse::<f64, _>(frame_time).map_err(|e| LoadMotionError::MissingFrameTime {
+                    parse_error: Some(e),
+                    line: line_num,
+                })?;
+            Ok(Duration::from_secs_f64(frame_time_secs))
+        } else {
+            Err(LoadMotionError::MissingFrameTime {
+                parse_error: None,
+                line: line_num,
+            })
+        }
+    };
+
+    match tokens.next() {
+        Some(tok) if tok == b":" => parse_frame_time(tokens.next()),
+        Some(tok) => parse_frame_time(Some(tok)),
+        None => Err(LoadMotionError::MissingNumFrames {
+            parse_error: None,
+            line: line_num,
+        }),
+    }
+}
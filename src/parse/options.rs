@@ -0,0 +1,312 @@
+//! Options for loading a subset of a `bvh` file.
+
+use super::{
+    header::BvhHeader,
+    lines::EnumeratedLines,
+    motion_reservation,
+    tokenize::{for_each_motion_token, parse_motion_value},
+};
+use crate::{
+    errors::{LoadError, LoadMotionError},
+    Bvh, Channel, ChannelType,
+};
+use bstr::{io::BufReadExt, BString};
+use smallvec::SmallVec;
+use std::{mem, ops::Range};
+
+/// Specify which parts of a `bvh` file to load.
+///
+/// By default every frame and every channel is loaded, which gives the same
+/// result as [`Bvh::from_reader`][`Bvh::from_reader`]. Motion values which are
+/// not selected are skipped over without being parsed, and the loaded `Bvh`
+/// only stores the selected values, with the `motion_index` of each remaining
+/// `Channel` renumbered to match.
+///
+/// All joints are kept in the hierarchy, even if none of their channels are
+/// selected. Loading stops after the last selected frame, so the rest of the
+/// file is not read, and is not checked for errors.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use bvh_anim::{parse::ParseOptions, ChannelType};
+/// # use std::{fs::File, io::BufReader};
+/// // Load the root and spine joints, from every 4th frame.
+/// let bvh = ParseOptions::new()
+///     .with_joints(&["Hips", "Chest", "Chest2"])
+///     .with_frame_stride(4)
+///     .parse(BufReader::new(File::open("./path/to/anim.bvh")?))?;
+/// # let _ = bvh;
+/// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+/// ```
+///
+/// [`Bvh::from_reader`]: ../struct.Bvh.html#method.from_reader
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct ParseOptions {
+    /// The range of frames to load.
+    ///
+    /// If this is `None`, then frames are loaded up to the end of the file.
+    pub frames: Option<Range<usize>>,
+    /// Load every `frame_stride`th frame in `frames`, starting with the first.
+    ///
+    /// A stride of `0` is treated in the same way as a stride of `1`.
+    pub frame_stride: usize,
+    /// The names of the joints whose channels should be loaded.
+    ///
+    /// If this is `None`, then the channels of every joint are loaded.
+    pub joints: Option<Vec<BString>>,
+    /// The types of channel which should be loaded.
+    ///
+    /// If this is `None`, then every type of channel is loaded.
+    pub channel_types: Option<Vec<ChannelType>>,
+    /// The maximum number of bytes which the loaded motion values may take up.
+    ///
+    /// If loading the selected motion values would take up more memory than
+    /// this, then loading stops with a `MotionLimitExceeded` error. This is
+    /// useful when loading files from untrusted sources. If this is `None`,
+    /// then there is no limit.
+    pub max_motion_bytes: Option<usize>,
+    #[doc(hidden)]
+    _nonexhaustive: (),
+}
+
+impl Default for ParseOptions {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl ParseOptions {
+    /// Create a new `ParseOptions` which loads the whole file.
+    #[inline]
+    pub const fn new() -> Self {
+        ParseOptions {
+            frames: None,
+            frame_stride: 1,
+            joints: None,
+            channel_types: None,
+            max_motion_bytes: None,
+            _nonexhaustive: (),
+        }
+    }
+
+    /// Load the `Bvh` from `reader` with the given options.
+    #[inline]
+    pub fn parse<R: BufReadExt>(&self, mut reader: R) -> Result<Bvh, LoadError> {
+        self.parse_lines(EnumeratedLines::from_reader(&mut reader))
+    }
+
+    /// Load the `Bvh` from the in-memory `bytes` with the given options.
+    #[inline]
+    pub fn parse_bytes<B: AsRef<[u8]>>(&self, bytes: B) -> Result<Bvh, LoadError> {
+        self.parse_lines(EnumeratedLines::from_bytes(bytes.as_ref()))
+    }
+
+    /// Sets `frames` on `self` to the new range of frames.
+    #[inline]
+    pub fn with_frames<F>(self, frames: F) -> Self
+    where
+        F: Into<Option<Range<usize>>>,
+    {
+        Self {
+            frames: frames.into(),
+            ..self
+        }
+    }
+
+    /// Sets `frame_stride` on `self` to the new `frame_stride`.
+    #[inline]
+    pub fn with_frame_stride(self, frame_stride: usize) -> Self {
+        Self {
+            frame_stride,
+            ..self
+        }
+    }
+
+    /// Sets `joints` on `self` to the names in `joints`.
+    #[inline]
+    pub fn with_joints<I>(self, joints: I) -> Self
+    where
+        I: IntoIterator,
+        I::Item: AsRef<[u8]>,
+    {
+        Self {
+            joints: Some(
+                joints
+                    .into_iter()
+                    .map(|name| BString::from(name.as_ref()))
+                    .collect(),
+            ),
+            ..self
+        }
+    }
+
+    /// Sets `channel_types` on `self` to the types in `channel_types`.
+    #[inline]
+    pub fn with_channel_types<I>(self, channel_types: I) -> Self
+    where
+        I: IntoIterator<Item = ChannelType>,
+    {
+        Self {
+            channel_types: Some(channel_types.into_iter().collect()),
+            ..self
+        }
+    }
+
+    /// Sets `max_motion_bytes` on `self` to the new limit.
+    #[inline]
+    pub fn with_max_motion_bytes<L>(self, max_motion_bytes: L) -> Self
+    where
+        L: Into<Option<usize>>,
+    {
+        Self {
+            max_motion_bytes: max_motion_bytes.into(),
+            ..self
+        }
+    }
+
+    fn parse_lines(&self, mut lines: EnumeratedLines<'_>) -> Result<Bvh, LoadError> {
+        let header = BvhHeader::from_lines(&mut lines)?;
+        let num_frames = header.num_frames();
+        let mut bvh = header.into_bvh();
+
+        let num_channels = bvh.num_channels;
+        let selected_channels = self.select_channels(&mut bvh);
+
+        let frames = match self.frames {
+            Some(ref frames) => frames.start.min(num_frames)..frames.end.min(num_frames),
+            None => 0..num_frames,
+        };
+        let frame_stride = self.frame_stride.max(1);
+        let num_frames_in_range = frames.end.saturating_sub(frames.start);
+        let num_selected_frames =
+            num_frames_in_range / frame_stride + (num_frames_in_range % frame_stride != 0) as usize;
+
+        let max_motion_values = self
+            .max_motion_bytes
+            .map_or(usize::MAX, |limit| limit / mem::size_of::<f32>());
+        let remaining_len = lines.remaining_bytes().map(|(_, bytes)| bytes.len());
+        let reservation = motion_reservation(
+            num_selected_frames.saturating_mul(bvh.num_channels),
+            remaining_len,
+        )
+        .min(max_motion_values);
+        let values = bvh.motion.vec_mut();
+        values.reserve(reservation);
+
+        // Values past the last selected frame are never looked at.
+        let last_value = match num_selected_frames {
+            0 => 0,
+            n => (frames.start + (n - 1) * frame_stride + 1).saturating_mul(num_channels),
+        };
+
+        let mut value_index = 0usize;
+        let (mut frame, mut channel) = (0usize, 0usize);
+
+        while value_index < last_value || num_channels == 0 {
+            let (line_num, line) = match lines.next_line() {
+                Some((line_num, line)) => (line_num, line.map_err(LoadMotionError::Io)?),
+                None => {
+                    let expected_total_motion_values = num_channels.saturating_mul(num_frames);
+                    if value_index != expected_total_motion_values {
+                        return Err(LoadMotionError::MotionCountMismatch {
+                            actual_total_motion_values: value_index,
+                            expected_total_motion_values,
+                            expected_num_frames: num_frames,
+                            expected_num_clips: num_channels,
+                        }
+                        .into());
+                    }
+                    break;
+                }
+            };
+
+            let mut channel_index = 0;
+            for_each_motion_token(line, |token| -> Result<(), LoadMotionError> {
+                let frame_selected = frame >= frames.start
+                    && frame < frames.end
+                    && (frame - frames.start) % frame_stride == 0;
+
+                if frame_selected && selected_channels.get(channel) == Some(&true) {
+                    if values.len() == max_motion_values {
+                        return Err(LoadMotionError::MotionLimitExceeded {
+                            limit: self.max_motion_bytes.unwrap_or(usize::MAX),
+                            line: line_num,
+                        });
+                    }
+
+                    let motion = parse_motion_value(token).map_err(|e| {
+                        LoadMotionError::ParseMotionSection {
+                            parse_error: e,
+                            channel_index,
+                            line: line_num,
+                        }
+                    })?;
+                    values.push(motion);
+                }
+
+                value_index += 1;
+                channel_index += 1;
+                channel += 1;
+                if channel == num_channels {
+                    channel = 0;
+                    frame += 1;
+                }
+                Ok(())
+            })?;
+        }
+
+        Ok(bvh)
+    }
+
+    /// Removes the unselected channels from the joints of `bvh`, renumbering
+    /// the remaining channels. Returns whether each of the original channels
+    /// was selected.
+    fn select_channels(&self, bvh: &mut Bvh) -> Vec<bool> {
+        let mut selected_channels = vec![false; bvh.num_channels];
+
+        for joint in &bvh.skeleton().joints {
+            let joint_selected = match self.joints {
+                Some(ref names) => names.iter().any(|name| &name[..] == joint.name()),
+                None => true,
+            };
+
+            if !joint_selected {
+                continue;
+            }
+
+            for channel in joint.channels() {
+                selected_channels[channel.motion_index()] = match self.channel_types {
+                    Some(ref types) => types.contains(&channel.channel_type()),
+                    None => true,
+                };
+            }
+        }
+
+        let mut new_motion_indices = Vec::with_capacity(selected_channels.len());
+        let mut num_selected = 0;
+        for &selected in &selected_channels {
+            new_motion_indices.push(num_selected);
+            num_selected += selected as usize;
+        }
+
+        for joint in bvh.skeleton_mut().joints_mut() {
+            let channels = joint
+                .channels()
+                .iter()
+                .filter(|channel| selected_channels[channel.motion_index()])
+                .map(|channel| {
+                    Channel::new(
+                        channel.channel_type(),
+                        new_motion_indices[channel.motion_index()],
+                    )
+                })
+                .collect::<SmallVec<[Channel; 6]>>();
+            joint.set_channels(channels);
+        }
+
+        bvh.num_channels = num_selected;
+        selected_channels
+    }
+}
@@ -0,0 +1,184 @@
+//! Parsing the `MOTION` section of an in-memory `bvh` file on several threads.
+//!
+//! Each row of motion values is independent of the others, so the section is
+//! split at newlines into one chunk per thread. The newlines in each chunk
+//! are counted first, which gives the line number and the offset into
+//! `motion_values` where each chunk starts, and each chunk is then parsed
+//! straight into its own part of the output.
+//!
+//! This relies on every row holding exactly one frame. Files which spread
+//! frames over several lines (or contain blank lines between frames) are
+//! still valid, and are handed back to the sequential parser.
+
+use super::tokenize::for_each_motion_value;
+use crate::errors::LoadMotionError;
+use bstr::ByteSlice;
+use std::{mem, thread};
+
+/// Motion sections smaller than this are not worth splitting any further.
+const MIN_CHUNK_LEN: usize = 64 * 1024;
+
+/// Reasons why a chunk could not be parsed.
+enum ChunkError {
+    /// A motion value in the chunk could not be parsed.
+    Parse(LoadMotionError),
+    /// A row in the chunk did not contain exactly one frame.
+    Irregular,
+}
+
+impl From<LoadMotionError> for ChunkError {
+    #[inline]
+    fn from(e: LoadMotionError) -> Self {
+        ChunkError::Parse(e)
+    }
+}
+
+/// Parses the motion values in `body` using up to `num_threads` threads,
+/// where `first_line` is the line number of the start of `body`.
+///
+/// Returns `Ok(None)` if `body` is too small to be split, or is not laid out
+/// as one frame per row, in which case it must be parsed sequentially. An
+/// error is only returned where the sequential parser would return the same
+/// error.
+pub(crate) fn parse_motion_values(
+    body: &[u8],
+    mut first_line: usize,
+    num_channels: usize,
+    num_threads: usize,
+) -> Result<Option<Vec<f32>>, LoadMotionError> {
+    // Leading and trailing blank lines do not contain any values, so they
+    // can be skipped without changing the result.
+    let mut body = body.trim_end();
+    while let Some(end) = body.find_byte(b'\n') {
+        if !body[..end].trim().is_empty() {
+            break;
+        }
+        body = &body[end + 1..];
+        first_line += 1;
+    }
+
+    let num_chunks = num_threads.min(body.len() / MIN_CHUNK_LEN);
+    if num_chunks <= 1 || num_channels == 0 {
+        return Ok(None);
+    }
+
+    let chunks = split_at_newlines(body, num_chunks);
+
+    let num_rows = thread::scope(|scope| {
+        let handles = chunks
+            .iter()
+            .map(|chunk| scope.spawn(move || count_rows(chunk)))
+            .collect::<Vec<_>>();
+        handles
+            .into_iter()
+            .map(|handle| handle.join().unwrap())
+            .collect::<Vec<_>>()
+    });
+
+    // Each value takes up at least two bytes including its separator, so a
+    // larger count means that the rows cannot all be complete frames.
+    let total_rows = num_rows.iter().sum::<usize>();
+    match total_rows.checked_mul(num_channels) {
+        Some(total) if total <= body.len() => {}
+        _ => return Ok(None),
+    }
+
+    let mut motion_values = vec![0.0; total_rows * num_channels];
+
+    let results = thread::scope(|scope| {
+        let mut rest = &mut motion_values[..];
+        let mut chunk_first_line = first_line;
+        let mut handles = Vec::with_capacity(chunks.len());
+
+        for (chunk, &rows) in chunks.iter().zip(&num_rows) {
+            let (out, tail) = mem::take(&mut rest).split_at_mut(rows * num_channels);
+            rest = tail;
+
+            let line = chunk_first_line;
+            chunk_first_line += rows;
+
+            handles.push(scope.spawn(move || parse_chunk(chunk, line, num_channels, out)));
+        }
+
+        handles
+            .into_iter()
+            .map(|handle| handle.join().unwrap())
+            .collect::<Vec<_>>()
+    });
+
+    // Chunks are checked in order, so that the reported error is the first
+    // one in the file.
+    for result in results {
+        match result {
+            Ok(()) => {}
+            Err(ChunkError::Parse(e)) => return Err(e),
+            Err(ChunkError::Irregular) => return Ok(None),
+        }
+    }
+
+    Ok(Some(motion_values))
+}
+
+/// Splits `body` into at most `num_chunks` chunks of roughly equal length,
+/// where every chunk but the last ends with a newline.
+fn split_at_newlines(body: &[u8], num_chunks: usize) -> Vec<&[u8]> {
+    let mut chunks = Vec::with_capacity(num_chunks);
+    let mut rest = body;
+
+    for chunks_left in (1..=num_chunks).rev() {
+        if rest.is_empty() {
+            break;
+        }
+
+        let target = rest.len() / chunks_left;
+        let end = if chunks_left == 1 {
+            rest.len()
+        } else {
+            match rest[target..].find_byte(b'\n') {
+                Some(newline) => target + newline + 1,
+                None => rest.len(),
+            }
+        };
+
+        let (chunk, tail) = rest.split_at(end);
+        chunks.push(chunk);
+        rest = tail;
+    }
+
+    chunks
+}
+
+/// Returns the number of lines in `chunk`.
+#[inline]
+fn count_rows(chunk: &[u8]) -> usize {
+    let newlines = chunk.iter().filter(|&&b| b == b'\n').count();
+    if chunk.ends_with(b"\n") {
+        newlines
+    } else {
+        newlines + 1
+    }
+}
+
+/// Parses each row of `chunk` into the corresponding frame of `out`.
+fn parse_chunk(
+    chunk: &[u8],
+    first_line: usize,
+    num_channels: usize,
+    out: &mut [f32],
+) -> Result<(), ChunkError> {
+    let rows = chunk.lines().zip(out.chunks_mut(num_channels));
+    for (row_index, (line, frame)) in rows.enumerate() {
+        let mut channel = 0;
+        for_each_motion_value(line, first_line + row_index, |value| {
+            *frame.get_mut(channel).ok_or(ChunkError::Irregular)? = value;
+            channel += 1;
+            Result::<(), ChunkError>::Ok(())
+        })?;
+
+        if channel != num_channels {
+            return Err(ChunkError::Irregular);
+        }
+    }
+
+    Ok(())
+}
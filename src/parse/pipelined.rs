@@ -0,0 +1,285 @@
+//! Loading a `bvh` file with reading and parsing on separate threads.
+
+use super::incremental::BvhParser;
+use crate::{
+    errors::{LoadError, LoadJointsError},
+    Bvh,
+};
+use std::{
+    fs::File,
+    io::{self, Read},
+    path::Path,
+    sync::mpsc::{self, Receiver, SyncSender},
+    thread,
+    time::{Duration, Instant},
+};
+
+/// Loads a `Bvh` from a reader, reading on a dedicated I/O thread while the
+/// data which has already been read is parsed on the current thread.
+///
+/// The reader is read in large blocks, which are handed over to the parser
+/// through a bounded channel. While the parser is working on one block, the
+/// I/O thread reads the next, so on slow storage (such as a network mount or
+/// a spinning disk) the time spent waiting for reads overlaps with the time
+/// spent parsing. Blocks are recycled once they have been parsed, so only
+/// `num_blocks` blocks are ever allocated.
+///
+/// Alongside the `Bvh`, a [`PipelineStats`][`PipelineStats`] is returned,
+/// which records how long each side of the pipeline spent working and waiting.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use bvh_anim::parse::PipelinedLoader;
+/// let (bvh, stats) = PipelinedLoader::new().load_path("./path/to/anim.bvh")?;
+/// if stats.parse_wait_time > stats.parse_time {
+///     println!("Parsing was limited by I/O: {:?}", stats);
+/// }
+/// # let _ = bvh;
+/// # Result::<(), bvh_anim::errors::LoadError>::Ok(())
+/// ```
+///
+/// [`PipelineStats`]: struct.PipelineStats.html
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct PipelinedLoader {
+    /// The size in bytes of each block read from the reader.
+    ///
+    /// A block size of `0` is treated in the same way as a block size of `1`.
+    pub block_size: usize,
+    /// The number of blocks which may be in flight between the two threads.
+    ///
+    /// With `2` blocks, one block is read while the other is parsed. Values
+    /// lower than `2` are treated in the same way as `2`.
+    pub num_blocks: usize,
+    /// The maximum number of bytes which the motion values of the file may
+    /// take up.
+    ///
+    /// If the file would take up more memory than this, including a line which
+    /// never ends, then loading stops with a `MotionLimitExceeded` error. This
+    /// is useful when loading files from untrusted sources. If this is `None`,
+    /// then there is no limit.
+    pub max_motion_bytes: Option<usize>,
+    #[doc(hidden)]
+    _nonexhaustive: (),
+}
+
+/// Timings for each stage of a [`PipelinedLoader`][`PipelinedLoader`].
+///
+/// If `parse_wait_time` is large, then the parser was waiting for data, and
+/// loading was limited by I/O. If `read_wait_time` is large, then the reader
+/// was waiting for a free block, and loading was limited by parsing.
+///
+/// [`PipelinedLoader`]: struct.PipelinedLoader.html
+#[derive(Clone, Copy, Debug, Default, Eq, Hash, PartialEq)]
+pub struct PipelineStats {
+    /// The total number of bytes read from the reader.
+    pub bytes_read: usize,
+    /// The number of blocks which were read.
+    pub num_blocks: usize,
+    /// The time the I/O thread spent reading.
+    pub read_time: Duration,
+    /// The time the I/O thread spent waiting for a block to read into.
+    pub read_wait_time: Duration,
+    /// The time the parsing thread spent parsing.
+    pub parse_time: Duration,
+    /// The time the parsing thread spent waiting for a block to parse.
+    pub parse_wait_time: Duration,
+    #[doc(hidden)]
+    _nonexhaustive: (),
+}
+
+impl Default for PipelinedLoader {
+    #[inline]
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl PipelinedLoader {
+    /// The default size of each block, which is 1 MiB.
+    pub const DEFAULT_BLOCK_SIZE: usize = 1 << 20;
+
+    /// Create a new `PipelinedLoader`, which reads 1 MiB blocks, and double
+    /// buffers them.
+    #[inline]
+    pub const fn new() -> Self {
+        PipelinedLoader {
+            block_size: Self::DEFAULT_BLOCK_SIZE,
+            num_blocks: 2,
+            max_motion_bytes: None,
+            _nonexhaustive: (),
+        }
+    }
+
+    /// Sets `block_size` on `self` to the new `block_size`.
+    #[inline]
+    pub fn with_block_size(self, block_size: usize) -> Self {
+        Self { block_size, ..self }
+    }
+
+    /// Sets `num_blocks` on `self` to the new `num_blocks`.
+    #[inline]
+    pub fn with_num_blocks(self, num_blocks: usize) -> Self {
+        Self { num_blocks, ..self }
+    }
+
+    /// Sets `max_motion_bytes` on `self` to the new limit.
+    #[inline]
+    pub fn with_max_motion_bytes<L>(self, max_motion_bytes: L) -> Self
+    where
+        L: Into<Option<usize>>,
+    {
+        Self {
+            max_motion_bytes: max_motion_bytes.into(),
+            ..self
+        }
+    }
+
+    /// Loads the `Bvh` from the file at `path`.
+    #[inline]
+    pub fn load_path<P: AsRef<Path>>(&self, path: P) -> Result<(Bvh, PipelineStats), LoadError> {
+        let file = File::open(path).map_err(LoadJointsError::Io)?;
+        self.load(file)
+    }
+
+    /// Loads the `Bvh` from `reader`, which is read on a separate thread.
+    ///
+    /// The result (including any error) is the same as calling
+    /// [`Bvh::from_reader`][`Bvh::from_reader`] with a buffered `reader`.
+    ///
+    /// [`Bvh::from_reader`]: ../struct.Bvh.html#method.from_reader
+    pub fn load<R: Read + Send>(&self, reader: R) -> Result<(Bvh, PipelineStats), LoadError> {
+        let block_size = self.block_size.max(1);
+        let num_blocks = self.num_blocks.max(2);
+
+        let (full_sender, full_receiver) = mpsc::sync_channel(num_blocks);
+        let (free_sender, free_receiver) = mpsc::channel();
+        for _ in 0..num_blocks {
+            free_sender
+                .send(Vec::with_capacity(block_size))
+                .expect("the receiver is alive");
+        }
+
+        thread::scope(|scope| {
+            let io_thread =
+                scope.spawn(move || read_blocks(reader, block_size, free_receiver, full_sender));
+
+            let parser = BvhParser::new().with_max_motion_bytes(self.max_motion_bytes);
+            let result = parse_blocks(parser, full_receiver, free_sender);
+            let read_stats = io_thread.join().expect("the I/O thread panicked");
+
+            result.map(|(bvh, parse_stats)| {
+                let stats = PipelineStats {
+                    parse_time: parse_stats.parse_time,
+                    parse_wait_time: parse_stats.parse_wait_time,
+                    ..read_stats
+                };
+                (bvh, stats)
+            })
+        })
+    }
+}
+
+/// Reads blocks from `reader` into the buffers received from `free_blocks`,
+/// and sends them to `full_blocks` until the end of the reader is reached, or
+/// the parser hangs up.
+fn read_blocks<R: Read>(
+    mut reader: R,
+    block_size: usize,
+    free_blocks: Receiver<Vec<u8>>,
+    full_blocks: SyncSender<io::Result<Vec<u8>>>,
+) -> PipelineStats {
+    let mut stats = PipelineStats::default();
+
+    loop {
+        let wait_start = Instant::now();
+        let mut block = match free_blocks.recv() {
+            Ok(block) => block,
+            Err(_) => break,
+        };
+        stats.read_wait_time += wait_start.elapsed();
+
+        let read_start = Instant::now();
+        let result = fill_block(&mut reader, &mut block, block_size);
+        stats.read_time += read_start.elapsed();
+
+        // Any data read before an error is parsed before the error is reported.
+        let len = block.len();
+        if len != 0 {
+            stats.bytes_read += len;
+            stats.num_blocks += 1;
+            if full_blocks.send(Ok(block)).is_err() {
+                break;
+            }
+        }
+
+        match result {
+            Err(e) => {
+                let _ = full_blocks.send(Err(e));
+                break;
+            }
+            // A short block means that the end of the reader was reached.
+            Ok(()) if len < block_size => break,
+            Ok(()) => {}
+        }
+    }
+
+    stats
+}
+
+/// Reads from `reader` until `block` holds `block_size` bytes, or the end of
+/// the reader is reached. If an error occurs, `block` holds the bytes read
+/// before it.
+fn fill_block<R: Read>(reader: &mut R, block: &mut Vec<u8>, block_size: usize) -> io::Result<()> {
+    block.resize(block_size, 0);
+
+    let mut len = 0;
+    let result = loop {
+        if len == block_size {
+            break Ok(());
+        }
+
+        match reader.read(&mut block[len..]) {
+            Ok(0) => break Ok(()),
+            Ok(n) => len += n,
+            Err(ref e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => break Err(e),
+        }
+    };
+
+    block.truncate(len);
+    result
+}
+
+/// Feeds each block received from `full_blocks` to `parser`, and then
+/// sends it back to `free_blocks` to be reused.
+fn parse_blocks(
+    mut parser: BvhParser,
+    full_blocks: Receiver<io::Result<Vec<u8>>>,
+    free_blocks: mpsc::Sender<Vec<u8>>,
+) -> Result<(Bvh, PipelineStats), LoadError> {
+    let mut stats = PipelineStats::default();
+
+    loop {
+        let wait_start = Instant::now();
+        let block = match full_blocks.recv() {
+            Ok(Ok(block)) => block,
+            Ok(Err(e)) => return Err(parser.io_error(e)),
+            Err(_) => break,
+        };
+        stats.parse_wait_time += wait_start.elapsed();
+
+        let parse_start = Instant::now();
+        parser.feed(&block)?;
+        stats.parse_time += parse_start.elapsed();
+
+        // The I/O thread has finished if the block cannot be sent back.
+        let _ = free_blocks.send(block);
+    }
+
+    let parse_start = Instant::now();
+    let bvh = parser.finish()?;
+    stats.parse_time += parse_start.elapsed();
+
+    Ok((bvh, stats))
+}
@@ -0,0 +1,260 @@
+//! Reading the motion values of a `bvh` file one frame at a time.
+
+use super::{header::BvhHeader, lines::EnumeratedLines, tokenize::for_each_motion_value};
+use crate::{
+    errors::{LoadError, LoadMotionError},
+    Joint, Joints,
+};
+use bstr::io::BufReadExt;
+use std::{fmt, mem, time::Duration};
+
+/// A reader which parses the hierarchy of a `bvh` file up front, and then
+/// parses its motion values on demand.
+///
+/// Unlike [`Bvh::from_reader`][`Bvh::from_reader`], the motion values are never all
+/// held in memory at once: each call to [`read_frames`][`MotionStream::read_frames`]
+/// parses just enough of the file to fill the slice it is given. This means that the
+/// memory used while reading a clip is bounded by the size of one batch of frames,
+/// however long the clip is.
+///
+/// # Examples
+///
+/// ```no_run
+/// # use bvh_anim::MotionStream;
+/// use std::{fs::File, io::BufReader};
+///
+/// let file = BufReader::new(File::open("./path/to/anim.bvh")?);
+/// let mut stream = MotionStream::new(file)?;
+///
+/// let mut frame = vec![0.0; stream.num_channels()];
+/// while stream.read_frame(&mut frame)? {
+///     // use frame...
+/// }
+/// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+/// ```
+///
+/// [`Bvh::from_reader`]: struct.Bvh.html#method.from_reader
+/// [`MotionStream::read_frames`]: struct.MotionStream.html#method.read_frames
+pub struct MotionStream<R> {
+    reader: R,
+    header: BvhHeader,
+    /// The buffer which each line is read into.
+    line_buffer: Vec<u8>,
+    /// The index of the next line to be read.
+    next_line: usize,
+    /// Values from the last line read which did not fit in the caller's buffer.
+    pending: Vec<f32>,
+    /// The number of values in `pending` which have already been returned.
+    pending_start: usize,
+    /// The total number of motion values parsed so far.
+    values_read: usize,
+    /// Whether the end of the reader has been reached.
+    finished: bool,
+}
+
+impl<R: BufReadExt> MotionStream<R> {
+    /// Parses the hierarchy and the `Frames:` and `Frame Time:` lines from
+    /// `reader`, leaving it positioned at the first frame.
+    pub fn new(mut reader: R) -> Result<Self, LoadError> {
+        let mut lines = EnumeratedLines::from_reader(&mut reader);
+        let header = BvhHeader::from_lines(&mut lines)?;
+
+        let (next_line, line_buffer) = lines
+            .into_reader_parts()
+            .expect("lines are always read from a reader");
+
+        Ok(MotionStream {
+            reader,
+            header,
+            line_buffer,
+            next_line,
+            pending: Vec::new(),
+            pending_start: 0,
+            values_read: 0,
+            finished: false,
+        })
+    }
+
+    /// Parses the next frame into `frame`, returning `false` if there are no
+    /// more frames.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the length of `frame` is not equal to the number of channels.
+    #[inline]
+    pub fn read_frame(&mut self, frame: &mut [f32]) -> Result<bool, LoadMotionError> {
+        assert_eq!(
+            frame.len(),
+            self.num_channels(),
+            "The frame must have one value for each channel"
+        );
+        Ok(self.read_frames(frame)? != 0)
+    }
+
+    /// Parses as many frames as will fit into `frames`, returning the number
+    /// of frames read. If `frames` is not empty, then a return value of `0`
+    /// means that every frame has been read.
+    ///
+    /// Frames are stored one after the other in `frames`, in the same layout
+    /// as the motion values of a [`Bvh`][`Bvh`].
+    ///
+    /// # Errors
+    ///
+    /// As well as errors from parsing the motion values, an error is returned
+    /// when the end of the reader is reached if the number of motion values
+    /// does not match the number of frames promised by the file.
+    ///
+    /// # Panics
+    ///
+    /// Panics if the length of `frames` is not a multiple of the number of
+    /// channels.
+    ///
+    /// [`Bvh`]: struct.Bvh.html
+    pub fn read_frames(&mut self, frames: &mut [f32]) -> Result<usize, LoadMotionError> {
+        let num_channels = self.num_channels();
+        let frames = if num_channels == 0 {
+            &mut frames[..0]
+        } else {
+            assert!(
+                frames.len() % num_channels == 0,
+                "The buffer must hold a whole number of frames"
+            );
+            frames
+        };
+
+        let pending = &self.pending[self.pending_start..];
+        let mut filled = pending.len().min(frames.len());
+        frames[..filled].copy_from_slice(&pending[..filled]);
+        self.pending_start += filled;
+        if self.pending_start == self.pending.len() {
+            self.pending.clear();
+            self.pending_start = 0;
+        }
+
+        if !self.finished && (filled < frames.len() || num_channels == 0) {
+            self.read_lines(frames, &mut filled)?;
+        }
+
+        Ok(filled / num_channels.max(1))
+    }
+
+    /// Reads lines into `frames[*filled..]` until it is full or the end of
+    /// the reader is reached. Any values left over from the last line are
+    /// stored in `pending`.
+    fn read_lines(
+        &mut self,
+        frames: &mut [f32],
+        filled: &mut usize,
+    ) -> Result<(), LoadMotionError> {
+        let num_channels = self.num_channels();
+        let pending = &mut self.pending;
+        let values_read = &mut self.values_read;
+
+        let mut lines = EnumeratedLines::resume_reader(
+            &mut self.reader,
+            mem::take(&mut self.line_buffer),
+            self.next_line,
+        );
+
+        let result = loop {
+            if *filled == frames.len() && num_channels != 0 {
+                break Ok(());
+            }
+
+            let (line_num, line) = match lines.next_line() {
+                Some((line_num, Ok(line))) => (line_num, line),
+                Some((_, Err(e))) => break Err(LoadMotionError::Io(e)),
+                None => {
+                    self.finished = true;
+                    break Ok(());
+                }
+            };
+
+            let parsed = for_each_motion_value(line, line_num, |value| {
+                if *filled < frames.len() {
+                    frames[*filled] = value;
+                    *filled += 1;
+                } else if num_channels != 0 {
+                    pending.push(value);
+                }
+                *values_read += 1;
+                Result::<(), LoadMotionError>::Ok(())
+            });
+
+            if let Err(e) = parsed {
+                break Err(e);
+            }
+        };
+
+        let (next_line, line_buffer) = lines
+            .into_reader_parts()
+            .expect("lines are always read from a reader");
+        self.next_line = next_line;
+        self.line_buffer = line_buffer;
+        result?;
+
+        let num_frames = self.num_frames();
+        let expected_total_motion_values = num_channels.saturating_mul(num_frames);
+        if self.finished && self.values_read != expected_total_motion_values {
+            return Err(LoadMotionError::MotionCountMismatch {
+                actual_total_motion_values: self.values_read,
+                expected_total_motion_values,
+                expected_num_frames: num_frames,
+                expected_num_clips: num_channels,
+            });
+        }
+
+        Ok(())
+    }
+
+    /// Returns the hierarchy and frame metadata of the file.
+    #[inline]
+    pub fn header(&self) -> &BvhHeader {
+        &self.header
+    }
+
+    /// Returns the root `Joint` of the hierarchy, or `None` if it is empty.
+    #[inline]
+    pub fn root_joint(&self) -> Option<Joint<'_>> {
+        self.header.root_joint()
+    }
+
+    /// Returns an iterator over all the `Joint`s in the hierarchy.
+    #[inline]
+    pub fn joints(&self) -> Joints<'_> {
+        self.header.joints()
+    }
+
+    /// Get the number of channels in each frame.
+    #[inline]
+    pub fn num_channels(&self) -> usize {
+        self.header.num_channels()
+    }
+
+    /// Get the number of frames promised by the `Frames:` line of the file.
+    #[inline]
+    pub fn num_frames(&self) -> usize {
+        self.header.num_frames()
+    }
+
+    /// Get the duration each frame should play for.
+    #[inline]
+    pub fn frame_time(&self) -> &Duration {
+        self.header.frame_time()
+    }
+
+    /// Unwraps the underlying reader.
+    #[inline]
+    pub fn into_inner(self) -> R {
+        self.reader
+    }
+}
+
+impl<R> fmt::Debug for MotionStream<R> {
+    #[inline]
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("MotionStream")
+            .field("header", &self.header)
+            .finish()
+    }
+}
@@ -0,0 +1,295 @@
+//! A fast tokenizer for the rows of the `MOTION` section.
+//!
+//! Rows are split into tokens eight bytes at a time, by building a bitmap of
+//! the whitespace in each 64-byte block of the line. Tokens in the
+//! `-123.4567` form which most exporters write are then decoded directly;
+//! anything else is handed to `lexical`, so the results (and errors) are
+//! identical to parsing every token with `lexical::parse`.
+
+use crate::errors::LoadMotionError;
+use bstr::ByteSlice;
+use lexical::parse;
+
+/// Exact powers of ten which can be represented in an `f32`.
+const POWERS_OF_TEN: [f32; 11] = [1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10];
+
+/// The largest mantissa which can be exactly represented in an `f32`.
+const MAX_EXACT_MANTISSA: u32 = 1 << 24;
+
+const LO_BITS: u64 = 0x0101_0101_0101_0101;
+const HI_BITS: u64 = 0x8080_8080_8080_8080;
+
+/// Parses each whitespace-separated value on `line`, and appends it to `values`.
+///
+/// # Errors
+///
+/// Returns a `ParseMotionSection` error if any of the tokens is not a valid
+/// floating point number.
+#[inline]
+pub(crate) fn parse_motion_line(
+    line: &[u8],
+    line_num: usize,
+    values: &mut Vec<f32>,
+) -> Result<(), LoadMotionError> {
+    for_each_motion_value(line, line_num, |value| {
+        values.push(value);
+        Ok(())
+    })
+}
+
+/// Parses each whitespace-separated value on `line`, and calls `f` with it.
+///
+/// # Errors
+///
+/// Returns a `ParseMotionSection` error if any of the tokens is not a valid
+/// floating point number, or the first error returned by `f`.
+pub(crate) fn for_each_motion_value<E, F>(line: &[u8], line_num: usize, mut f: F) -> Result<(), E>
+where
+    E: From<LoadMotionError>,
+    F: FnMut(f32) -> Result<(), E>,
+{
+    let mut channel_index = 0;
+    for_each_motion_token(line, |token| {
+        let motion =
+            parse_motion_value(token).map_err(|e| LoadMotionError::ParseMotionSection {
+                parse_error: e,
+                channel_index,
+                line: line_num,
+            })?;
+        f(motion)?;
+        channel_index += 1;
+        Ok(())
+    })
+}
+
+/// Calls `f` with each whitespace-separated token on `line`, without
+/// parsing it.
+#[inline]
+pub(crate) fn for_each_motion_token<E, F>(line: &[u8], f: F) -> Result<(), E>
+where
+    F: FnMut(&[u8]) -> Result<(), E>,
+{
+    if line.is_ascii() {
+        for_each_token(line, f)
+    } else {
+        // Non-ascii lines may contain unicode whitespace, so fall back to
+        // the general splitting routine.
+        line.fields().try_for_each(f)
+    }
+}
+
+/// Parses a single motion value.
+#[inline]
+pub(crate) fn parse_motion_value(token: &[u8]) -> Result<f32, lexical::Error> {
+    match parse_fixed_decimal(token) {
+        Some(value) => Ok(value),
+        None => parse::<f32, _>(token),
+    }
+}
+
+/// Calls `f` with each whitespace-separated token of the ascii string `line`.
+fn for_each_token<E, F>(line: &[u8], mut f: F) -> Result<(), E>
+where
+    F: FnMut(&[u8]) -> Result<(), E>,
+{
+    let mut token_start = None;
+    let mut prev_is_whitespace = true;
+
+    for (block_index, block) in line.chunks(64).enumerate() {
+        let offset = block_index * 64;
+        let whitespace = whitespace_bitmap(block);
+
+        let carry = prev_is_whitespace as u64;
+        let starts = !whitespace & ((whitespace << 1) | carry);
+        let ends = whitespace & ((!whitespace << 1) | (1 - carry));
+
+        let mut boundaries = starts | ends;
+        while boundaries != 0 {
+            let bit = boundaries.trailing_zeros() as usize;
+            boundaries &= boundaries - 1;
+
+            if starts & (1 << bit) != 0 {
+                token_start = Some(offset + bit);
+            } else if let Some(start) = token_start.take() {
+                // Bits past the end of the line are marked as whitespace,
+                // so this is also where the last token is closed.
+                f(&line[start..(offset + bit).min(line.len())])?;
+            }
+        }
+
+        prev_is_whitespace = whitespace >> 63 != 0;
+    }
+
+    match token_start {
+        Some(start) => f(&line[start..]),
+        None => Ok(()),
+    }
+}
+
+/// Returns a bitmap where bit `i` is set if `block[i]` is whitespace. Bits
+/// past the end of `block` are also set.
+#[inline]
+fn whitespace_bitmap(block: &[u8]) -> u64 {
+    let mut bitmap = 0u64;
+    for (word_index, word) in block.chunks(8).enumerate() {
+        let mut bytes = [b' '; 8];
+        bytes[..word.len()].copy_from_slice(word);
+        let mask = whitespace_mask(u64::from_le_bytes(bytes));
+        bitmap |= compact_mask(mask) << (word_index * 8);
+    }
+
+    if block.len() < 64 {
+        bitmap |= !0u64 << block.len();
+    }
+
+    bitmap
+}
+
+/// Returns a mask with the high bit of each byte set if that byte is one
+/// of `' '`, `'\t'`, `'\n'`, `'\x0B'`, `'\x0C'` or `'\r'`.
+///
+/// Every byte of `word` must be ascii, which guarantees that none of the
+/// additions below carry into the next byte.
+#[inline]
+fn whitespace_mask(word: u64) -> u64 {
+    let spaces = word ^ (LO_BITS * u64::from(b' '));
+    let is_space = !(((spaces & !HI_BITS) + !HI_BITS) | spaces) & HI_BITS;
+
+    let at_least_tab = word + LO_BITS * (0x80 - u64::from(b'\t'));
+    let past_carriage_return = word + LO_BITS * (0x80 - u64::from(b'\r') - 1);
+    let is_control_whitespace = at_least_tab & !past_carriage_return & HI_BITS;
+
+    is_space | is_control_whitespace
+}
+
+/// Gathers the high bit of each byte in `mask` into the low 8 bits.
+#[inline]
+fn compact_mask(mask: u64) -> u64 {
+    ((mask >> 7).wrapping_mul(0x0102_0408_1020_4080)) >> 56
+}
+
+/// Decodes a number of the form `-?[0-9]+(\.[0-9]+)?`, if its value can be
+/// computed exactly with a single `f32` division.
+///
+/// Both the mantissa and the power of ten are exactly representable, so the
+/// division is correctly rounded, and gives the same result as a full parse.
+#[inline]
+fn parse_fixed_decimal(token: &[u8]) -> Option<f32> {
+    let (negative, digits) = match token.split_first() {
+        Some((b'-', rest)) => (true, rest),
+        _ => (false, token),
+    };
+
+    let mut mantissa = 0u32;
+    let (mut int_digits, mut frac_digits) = (0usize, 0usize);
+    let mut seen_point = false;
+
+    for &byte in digits {
+        match byte {
+            b'0'..=b'9' => {
+                mantissa = mantissa * 10 + u32::from(byte - b'0');
+                if mantissa > MAX_EXACT_MANTISSA {
+                    return None;
+                }
+
+                if seen_point {
+                    frac_digits += 1;
+                } else {
+                    int_digits += 1;
+                }
+            }
+            b'.' if !seen_point => seen_point = true,
+            _ => return None,
+        }
+    }
+
+    if int_digits == 0 || (seen_point && frac_digits == 0) {
+        return None;
+    }
+
+    let value = mantissa as f32 / *POWERS_OF_TEN.get(frac_digits)?;
+    Some(if negative { -value } else { value })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn reference_tokens(line: &[u8]) -> Vec<Vec<u8>> {
+        line.fields().map(<[u8]>::to_vec).collect()
+    }
+
+    #[test]
+    fn tokens_match_fields() {
+        let lines: &[&[u8]] = &[
+            b"",
+            b"   ",
+            b"1.0",
+            b" 1.0 -2.5\t3\x0b4\x0c5\r",
+            b"-48.0250 94.5063 230.2812 -1.09 -19.04 4.49 4.72 18.84 -2.92 4.75 18.81 -2.90 -0.18",
+            b"0123456789012345678901234567890123456789012345678901234567890123 4",
+            b"012345678901234567890123456789012345678901234567890123456789012 34",
+            b"01234567890123456789012345678901234567890123456789012345678901234",
+            b"\x1f1 2\x1c",
+        ];
+
+        for line in lines {
+            let mut tokens = vec![];
+            for_each_token(line, |tok| {
+                tokens.push(tok.to_vec());
+                Result::<(), ()>::Ok(())
+            })
+            .unwrap();
+            assert_eq!(tokens, reference_tokens(line), "{:?}", line.as_bstr());
+        }
+    }
+
+    #[test]
+    fn fixed_decimals_are_exact() {
+        let mut state = 0x2545_f491_4f6c_dd1du64;
+        for _ in 0..100_000 {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            let int_part = state % 100_000;
+            let frac_digits = ((state >> 20) % 7) as usize;
+            let frac_part = (state >> 24) % 10u64.pow(frac_digits as u32);
+            let sign = if state & (1 << 40) != 0 { "-" } else { "" };
+
+            let token = if frac_digits == 0 {
+                format!("{}{}", sign, int_part)
+            } else {
+                format!("{}{}.{:0w$}", sign, int_part, frac_part, w = frac_digits)
+            };
+
+            let expected = token.parse::<f32>().unwrap();
+            let actual = parse_motion_value(token.as_bytes()).unwrap();
+            assert_eq!(expected.to_bits(), actual.to_bits(), "{}", token);
+        }
+    }
+
+    #[test]
+    fn unusual_values_fall_back() {
+        for token in &[
+            "-0",
+            "-0.00",
+            "1e3",
+            "+1.5",
+            ".5",
+            "5.",
+            "0.033333333",
+            "16777217",
+        ] {
+            assert_eq!(parse_fixed_decimal(token.as_bytes()).is_some(), {
+                ["-0", "-0.00"].contains(token)
+            });
+        }
+        assert_eq!(
+            parse_motion_value(b"-0.00").unwrap().to_bits(),
+            (-0.0f32).to_bits()
+        );
+        assert!(parse_motion_value(b"1.0.0").is_err());
+        assert!(parse_motion_value(b"abc").is_err());
+    }
+}
@@ -0,0 +1,360 @@
+//! A skeleton hierarchy which can be shared between many clips.
+
+use crate::{
+    joint::{JointData, JointIndex},
+    Bvh, Joint, Joints,
+};
+use std::{
+    collections::{hash_map::DefaultHasher, HashMap},
+    hash::{Hash, Hasher},
+    sync::{Arc, Mutex, OnceLock},
+};
+
+/// The joint hierarchy of a [`Bvh`][`Bvh`], without any motion.
+///
+/// Each `Bvh` holds its skeleton in an [`Arc`][`Arc`], so clips which were
+/// recorded on the same rig can share a single copy of it. A shared skeleton
+/// is copied the first time one of the clips modifies its joints, so editing
+/// one clip never affects another.
+///
+/// Two skeletons are equal if they have the same joints. Comparing two
+/// references to the same skeleton is a pointer comparison, and comparing two
+/// different skeletons first compares their [`content_hash`][`content_hash`]es,
+/// so that only skeletons which are very likely to be equal are compared joint
+/// by joint.
+///
+/// # Examples
+///
+/// ```
+/// # use bvh_anim::Bvh;
+/// # use std::sync::Arc;
+/// const BVH_BYTES: &[u8] = include_bytes!("../data/test_simple.bvh");
+/// let first = Bvh::from_bytes(BVH_BYTES)?;
+/// let mut second = Bvh::from_bytes(BVH_BYTES)?;
+/// assert_eq!(first.skeleton(), second.skeleton());
+///
+/// second.set_skeleton(Arc::clone(first.skeleton()))?;
+/// assert!(Arc::ptr_eq(first.skeleton(), second.skeleton()));
+/// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+/// ```
+///
+/// [`Bvh`]: ../struct.Bvh.html
+/// [`Arc`]: https://doc.rust-lang.org/std/sync/struct.Arc.html
+/// [`content_hash`]: struct.Skeleton.html#method.content_hash
+#[derive(Clone, Debug, Default)]
+pub struct Skeleton {
+    /// The list of joints. If the root joint exists, it is always at
+    /// index `0`.
+    pub(crate) joints: Vec<JointData>,
+    /// Lookup tables over `joints`, which must be invalidated whenever
+    /// `joints` is modified.
+    pub(crate) joint_index: JointIndex,
+}
+
+impl Skeleton {
+    /// Create an empty `Skeleton`.
+    #[inline]
+    pub const fn new() -> Self {
+        Skeleton {
+            joints: Vec::new(),
+            joint_index: JointIndex::new(),
+        }
+    }
+
+    /// Returns the root joint if it exists, or `None` if the skeleton is empty.
+    #[inline]
+    pub fn root_joint(&self) -> Option<Joint<'_>> {
+        if self.joints.is_empty() {
+            None
+        } else {
+            Some(Joint {
+                index: 0,
+                joints: &self.joints[..],
+                joint_index: &self.joint_index,
+            })
+        }
+    }
+
+    /// Returns an iterator over all the `Joint`s in the skeleton.
+    #[inline]
+    pub fn joints(&self) -> Joints<'_> {
+        Joints::iter_root(&self.joints[..], &self.joint_index)
+    }
+
+    /// Returns the number of joints in the skeleton.
+    #[inline]
+    pub fn num_joints(&self) -> usize {
+        self.joints.len()
+    }
+
+    /// Returns the total number of channels of all the joints in the skeleton.
+    #[inline]
+    pub fn num_channels(&self) -> usize {
+        self.joints.iter().map(|joint| joint.channels().len()).sum()
+    }
+
+    /// Returns a hash of the joints in the skeleton.
+    ///
+    /// Equal skeletons always have the same hash. The hash is computed the
+    /// first time it is needed, and is cached until the joints are modified.
+    /// It is only stable within a single run of a program, so it should not
+    /// be stored.
+    #[inline]
+    pub fn content_hash(&self) -> u64 {
+        self.joint_index
+            .content_hash(|| hash_joints(&self.joints[..]))
+    }
+
+    /// Returns an empty skeleton which is shared by every `Bvh` without one.
+    #[inline]
+    pub(crate) fn empty() -> &'static Arc<Skeleton> {
+        static EMPTY: OnceLock<Arc<Skeleton>> = OnceLock::new();
+        EMPTY.get_or_init(Arc::default)
+    }
+
+    /// Returns the joints for modification, invalidating the lookup tables.
+    #[inline]
+    pub(crate) fn joints_mut(&mut self) -> &mut Vec<JointData> {
+        self.joint_index.invalidate();
+        &mut self.joints
+    }
+}
+
+impl PartialEq for Skeleton {
+    #[inline]
+    fn eq(&self, other: &Self) -> bool {
+        // The joints are compared even if `self` and `other` are the same
+        // skeleton, so that an offset of `NaN` is never equal to itself.
+        self.joints.len() == other.joints.len()
+            && self.content_hash() == other.content_hash()
+            && self.joints == other.joints
+    }
+}
+
+/// Hashes the parts of `joints` which are compared for equality, so that
+/// equal joints always have the same hash.
+fn hash_joints(joints: &[JointData]) -> u64 {
+    /// Hashes an offset so that `0.0` and `-0.0` have the same hash, as
+    /// they compare equal.
+    #[inline]
+    fn hash_offset<H: Hasher>(offset: &[f32; 3], state: &mut H) {
+        for &value in offset {
+            let bits = if value == 0.0 { 0 } else { value.to_bits() };
+            bits.hash(state);
+        }
+    }
+
+    let mut state = DefaultHasher::new();
+    joints.len().hash(&mut state);
+    for joint in joints {
+        joint.name().hash(&mut state);
+        joint.parent_index().hash(&mut state);
+        hash_offset(joint.offset(), &mut state);
+        match joint.end_site() {
+            Some(end_site) => {
+                true.hash(&mut state);
+                hash_offset(end_site, &mut state);
+            }
+            None => false.hash(&mut state),
+        }
+        joint.channels().hash(&mut state);
+    }
+    state.finish()
+}
+
+/// A set of shared skeletons, used to make clips which were recorded on the
+/// same rig share a single [`Skeleton`][`Skeleton`].
+///
+/// Skeletons are looked up by their [`content_hash`][`content_hash`], so
+/// deduplicating a clip only compares its skeleton joint by joint with
+/// skeletons which have the same hash. The cache can be shared between
+/// threads, and keeps each skeleton alive until it is cleared or dropped.
+///
+/// # Examples
+///
+/// ```
+/// # use bvh_anim::{joint::SkeletonCache, Bvh};
+/// # use std::sync::Arc;
+/// const BVH_BYTES: &[u8] = include_bytes!("../data/test_simple.bvh");
+/// let cache = SkeletonCache::new();
+///
+/// let mut first = Bvh::from_bytes(BVH_BYTES)?;
+/// let mut second = Bvh::from_bytes(BVH_BYTES)?;
+/// cache.dedupe(&mut first);
+/// cache.dedupe(&mut second);
+///
+/// assert!(Arc::ptr_eq(first.skeleton(), second.skeleton()));
+/// assert_eq!(cache.len(), 1);
+/// # Result::<(), Box<dyn std::error::Error>>::Ok(())
+/// ```
+///
+/// [`Skeleton`]: struct.Skeleton.html
+/// [`content_hash`]: struct.Skeleton.html#method.content_hash
+#[derive(Debug, Default)]
+pub struct SkeletonCache {
+    skeletons: Mutex<HashMap<u64, Vec<Arc<Skeleton>>>>,
+}
+
+impl SkeletonCache {
+    /// Create an empty `SkeletonCache`.
+    #[inline]
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Returns the skeleton in the cache which is equal to `skeleton`. If there
+    /// is no such skeleton, then `skeleton` is added to the cache, and returned.
+    pub fn intern(&self, skeleton: &Arc<Skeleton>) -> Arc<Skeleton> {
+        let hash = skeleton.content_hash();
+        let mut skeletons = self
+            .skeletons
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+        let candidates = skeletons.entry(hash).or_default();
+
+        // A skeleton is always found in the cache once it has been added,
+        // even if it is not equal to itself because of a `NaN` offset.
+        let is_equal =
+            |candidate: &&Arc<Skeleton>| Arc::ptr_eq(candidate, skeleton) || *candidate == skeleton;
+        match candidates.iter().find(is_equal) {
+            Some(candidate) => Arc::clone(candidate),
+            None => {
+                candidates.push(Arc::clone(skeleton));
+                Arc::clone(skeleton)
+            }
+        }
+    }
+
+    /// Replaces the skeleton of `bvh` with the equal skeleton in the cache,
+    /// adding it to the cache if there is none.
+    #[inline]
+    pub fn dedupe(&self, bvh: &mut Bvh) {
+        bvh.skeleton = Some(self.intern(bvh.skeleton()));
+    }
+
+    /// Returns the number of distinct skeletons in the cache.
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.skeletons
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .values()
+            .map(Vec::len)
+            .sum()
+    }
+
+    /// Returns `true` if the cache has no skeletons.
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// Removes every skeleton from the cache.
+    #[inline]
+    pub fn clear(&self) {
+        self.skeletons
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner())
+            .clear();
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+
+    #[test]
+    fn equal_skeletons_have_equal_hashes() {
+        let first = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let mut second = Bvh::from_bytes(BVH_BYTES).unwrap();
+        assert_eq!(first.skeleton(), second.skeleton());
+        assert_eq!(
+            first.skeleton().content_hash(),
+            second.skeleton().content_hash()
+        );
+
+        // A negative zero offset is still equal to a zero offset.
+        let offset = *second.root_joint().unwrap().offset();
+        let negated = [-offset[0], -offset[1], -offset[2]];
+        second.skeleton_mut().joints_mut()[0].set_offset(negated, false);
+        assert_eq!(offset, [0.0; 3]);
+        assert_eq!(first.skeleton(), second.skeleton());
+        assert_eq!(
+            first.skeleton().content_hash(),
+            second.skeleton().content_hash()
+        );
+
+        second.skeleton_mut().joints_mut()[1].set_offset([1.0, 2.0, 3.0], false);
+        assert_ne!(first.skeleton(), second.skeleton());
+        assert_ne!(
+            first.skeleton().content_hash(),
+            second.skeleton().content_hash()
+        );
+
+        // A `NaN` offset is not equal to itself, but is still only cached once.
+        second.skeleton_mut().joints_mut()[1].set_offset([f32::NAN; 3], false);
+        assert_ne!(second.skeleton(), second.skeleton());
+        let cache = SkeletonCache::new();
+        cache.dedupe(&mut second);
+        cache.dedupe(&mut second);
+        assert_eq!(cache.len(), 1);
+    }
+
+    #[test]
+    fn cache_shares_equal_skeletons() {
+        let cache = SkeletonCache::new();
+        let mut clips = (0..3)
+            .map(|_| Bvh::from_bytes(BVH_BYTES).unwrap())
+            .collect::<Vec<_>>();
+        let mut other = Bvh::from_bytes(include_bytes!("../data/test_simple.bvh")).unwrap();
+
+        for clip in clips.iter_mut().chain(Some(&mut other)) {
+            cache.dedupe(clip);
+        }
+        assert_eq!(cache.len(), 2);
+        assert!(Arc::ptr_eq(clips[0].skeleton(), clips[1].skeleton()));
+        assert!(Arc::ptr_eq(clips[0].skeleton(), clips[2].skeleton()));
+        assert!(!Arc::ptr_eq(clips[0].skeleton(), other.skeleton()));
+
+        // Editing a clip copies its skeleton, and leaves the others alone.
+        clips[1].skeleton_mut().joints_mut()[0].set_offset([1.0, 2.0, 3.0], false);
+        assert!(!Arc::ptr_eq(clips[0].skeleton(), clips[1].skeleton()));
+        assert_eq!(clips[0], clips[2]);
+        assert_ne!(clips[0], clips[1]);
+    }
+
+    #[test]
+    fn empty_bvhs_share_an_empty_skeleton() {
+        const EMPTY: Bvh = Bvh::new();
+
+        let mut bvh = EMPTY;
+        assert!(Arc::ptr_eq(bvh.skeleton(), Bvh::new().skeleton()));
+        assert_eq!(bvh.skeleton().num_joints(), 0);
+
+        // Writing to the skeleton gives the `Bvh` its own copy.
+        bvh.skeleton_to_overwrite();
+        assert!(!Arc::ptr_eq(bvh.skeleton(), Bvh::new().skeleton()));
+        assert_eq!(bvh, Bvh::new());
+        assert_eq!(Bvh::new().skeleton().num_joints(), 0);
+    }
+
+    #[test]
+    fn set_skeleton_checks_channel_count() {
+        use crate::errors::SetMotionError;
+
+        let mut bvh = Bvh::from_bytes(BVH_BYTES).unwrap();
+        let other = Bvh::from_bytes(include_bytes!("../data/test_simple.bvh")).unwrap();
+        let skeleton = Arc::clone(bvh.skeleton());
+
+        match bvh.set_skeleton(Arc::clone(other.skeleton())) {
+            Err(SetMotionError::ChannelCountMismatch { expected, actual }) => {
+                assert_eq!(expected, bvh.num_channels());
+                assert_eq!(actual, other.num_channels());
+            }
+            result => panic!("unexpected result: {:?}", result),
+        }
+        assert!(Arc::ptr_eq(bvh.skeleton(), &skeleton));
+    }
+}
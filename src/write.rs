@@ -1,6 +1,6 @@
 //! Contains options for `bvh` file formatting.
 
-use crate::{frames::Frames, Bvh, Joint, Joints};
+use crate::{frames::ClipFrames, ClipView, Joint, Joints};
 use smallvec::SmallVec;
 use std::{
     fmt,
@@ -54,13 +54,24 @@ impl WriteOptions {
     }
 
     /// Output the `Bvh` file to the `writer` with the given options.
-    pub fn write<W: Write>(&self, bvh: &Bvh, writer: &mut W) -> io::Result<()> {
+    ///
+    /// Either a `&Bvh` or a [`ClipView`][`ClipView`] of some of its frames
+    /// can be written.
+    ///
+    /// [`ClipView`]: ../struct.ClipView.html
+    pub fn write<'c, C, W>(&self, clip: C, writer: &mut W) -> io::Result<()>
+    where
+        C: Into<ClipView<'c>>,
+        W: Write,
+    {
+        let clip = clip.into();
         let mut curr_chunk = vec![];
         let mut curr_bytes_written = 0usize;
         let mut curr_string_len = 0usize;
         let mut iter_state = WriteOptionsIterState::new();
+        let num_frames = clip.frames().len();
 
-        while self.next_chunk(bvh, &mut curr_chunk, &mut iter_state) != false {
+        while self.next_chunk(clip, num_frames, &mut curr_chunk, &mut iter_state) != false {
             let bytes: &[u8] = curr_chunk.as_ref();
             curr_string_len += bytes.len();
             curr_bytes_written += writer.write(bytes)?;
@@ -76,18 +87,87 @@ impl WriteOptions {
     }
 
     /// Output the `Bvh` file to the `string` with the given options.
-    pub fn write_to_string(&self, bvh: &Bvh) -> Vec<u8> {
+    ///
+    /// Either a `&Bvh` or a [`ClipView`][`ClipView`] of some of its frames
+    /// can be written.
+    ///
+    /// [`ClipView`]: ../struct.ClipView.html
+    pub fn write_to_string<'c, C: Into<ClipView<'c>>>(&self, clip: C) -> Vec<u8> {
+        let clip = clip.into();
         let mut curr_chunk = vec![];
         let mut out_string = vec![];
         let mut iter_state = WriteOptionsIterState::new();
+        let num_frames = clip.frames().len();
 
-        while self.next_chunk(bvh, &mut curr_chunk, &mut iter_state) != false {
+        while self.next_chunk(clip, num_frames, &mut curr_chunk, &mut iter_state) != false {
             out_string.extend(curr_chunk.drain(..));
         }
 
         out_string
     }
 
+    /// Output the hierarchy of `skeleton` to the `writer`, followed by the
+    /// `MOTION`, `Frames:` and `Frame Time:` lines, where the file is declared
+    /// to have `num_frames` frames. Any frames in `skeleton` are not written.
+    ///
+    /// The frames can then be written one at a time with [`write_frame`]
+    /// [`WriteOptions::write_frame`], so that a `bvh` file can be written
+    /// without holding all of its frames in memory at once.
+    ///
+    /// [`WriteOptions::write_frame`]: struct.WriteOptions.html#method.write_frame
+    pub fn write_header<'c, C, W>(
+        &self,
+        skeleton: C,
+        num_frames: usize,
+        writer: &mut W,
+    ) -> io::Result<()>
+    where
+        C: Into<ClipView<'c>>,
+        W: Write,
+    {
+        let skeleton = skeleton.into();
+        let mut curr_chunk = vec![];
+        let mut iter_state = WriteOptionsIterState::new();
+
+        loop {
+            if let WriteOptionsIterState::WriteFrames { .. } = iter_state {
+                break;
+            }
+
+            self.next_chunk(skeleton, num_frames, &mut curr_chunk, &mut iter_state);
+            writer.write_all(&curr_chunk)?;
+        }
+
+        Ok(())
+    }
+
+    /// Output a single line of motion values to the `writer`.
+    ///
+    /// This is used after [`write_header`][`WriteOptions::write_header`] to
+    /// write each frame of the file. The values are formatted straight into
+    /// `writer` without allocating, so `writer` should usually be buffered.
+    ///
+    /// [`WriteOptions::write_header`]: struct.WriteOptions.html#method.write_header
+    pub fn write_frame<W: Write>(&self, frame: &[f32], writer: &mut W) -> io::Result<()> {
+        for (i, motion) in frame.iter().enumerate() {
+            if i != 0 {
+                writer.write_all(b" ")?;
+            }
+            match self.motion_values_significant_figures {
+                Some(sf) => write!(writer, "{:.*}", sf, motion)?,
+                None => write!(writer, "{:.}", motion)?,
+            }
+        }
+        writer.write_all(self.line_terminator.as_bytes())
+    }
+
+    /// Writes the motion values in `frame`, and a line terminator, to `chunk`.
+    #[inline]
+    pub(crate) fn frame_chunk(&self, frame: &[f32], chunk: &mut Vec<u8>) {
+        // Writing to a `Vec` cannot fail.
+        let _ = self.write_frame(frame, chunk);
+    }
+
     /// Sets `indent` on `self` to the new `IndentStyle`.
     #[inline]
     pub const fn with_indent(self, indent: IndentStyle) -> Self {
@@ -153,7 +233,8 @@ impl WriteOptions {
     /// `false` when all lines have been extracted.
     fn next_chunk<'a, 'b: 'a>(
         &self,
-        bvh: &'b Bvh,
+        clip: ClipView<'b>,
+        num_frames: usize,
         chunk: &mut Vec<u8>,
         iter_state: &'a mut WriteOptionsIterState<'b>,
     ) -> bool {
@@ -168,7 +249,7 @@ impl WriteOptions {
                     chunk.extend_from_slice(self.line_terminator.as_bytes());
                     *written = true;
                 } else {
-                    let mut joints = bvh.joints();
+                    let mut joints = clip.joints();
                     *iter_state = WriteOptionsIterState::WriteJoints {
                         current_joint: joints.next(),
                         joints,
@@ -307,7 +388,7 @@ impl WriteOptions {
             }
             WriteOptionsIterState::WriteNumFrames { ref mut written } => {
                 if !*written {
-                    *chunk = format!("Frames: {}", bvh.frames().len()).into_bytes();
+                    *chunk = format!("Frames: {}", num_frames).into_bytes();
                     chunk.extend_from_slice(terminator);
                     *written = true;
                 } else {
@@ -318,17 +399,16 @@ impl WriteOptions {
                 if !*written {
                     *chunk = match self.frame_time_significant_figures {
                         Some(sf) => {
-                            format!("Frame Time: {:.*}", sf, bvh.frame_time().as_secs_f64())
+                            format!("Frame Time: {:.*}", sf, clip.frame_time().as_secs_f64())
                                 .into_bytes()
                         }
-                        None => {
-                            format!("Frame Time: {:.}", bvh.frame_time().as_secs_f64()).into_bytes()
-                        }
+                        None => format!("Frame Time: {:.}", clip.frame_time().as_secs_f64())
+                            .into_bytes(),
                     };
                     chunk.extend_from_slice(terminator);
                     *written = true;
                 } else {
-                    let frames = bvh.frames();
+                    let frames = clip.frames();
                     *iter_state = WriteOptionsIterState::WriteFrames { frames };
                 }
             }
@@ -336,17 +416,7 @@ impl WriteOptions {
                 return frames
                     .next()
                     .map(|frame| {
-                        let motion_values = frame
-                            .as_slice()
-                            .iter()
-                            .map(|motion| match self.motion_values_significant_figures {
-                                Some(sf) => format!("{:.*}", sf, motion),
-                                None => format!("{:.}", motion),
-                            })
-                            .collect::<Vec<_>>()
-                            .join(" ");
-                        *chunk = motion_values.into_bytes();
-                        chunk.extend_from_slice(terminator);
+                        self.frame_chunk(frame.as_slice(), chunk);
                         true
                     })
                     .unwrap_or_default();
@@ -378,7 +448,7 @@ enum WriteOptionsIterState<'a> {
         written: bool,
     },
     WriteFrames {
-        frames: Frames<'a>,
+        frames: ClipFrames<'a>,
     },
 }
 
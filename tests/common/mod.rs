@@ -0,0 +1,27 @@
+//! Test data shared between the integration tests and the benchmarks.
+
+#![allow(dead_code)]
+
+/// The mocap clip used as the basis of the long clips.
+pub const BVH_BYTES: &[u8] = include_bytes!("../../data/test_mocapbank.bvh");
+
+/// Returns `test_mocapbank.bvh` with its frames repeated until the clip is
+/// `num_frames` frames long.
+pub fn with_num_frames(num_frames: usize) -> Vec<u8> {
+    let text = std::str::from_utf8(BVH_BYTES).unwrap();
+    let frame_time_line = text.find("Frame Time:").unwrap();
+    let motion_start = frame_time_line + text[frame_time_line..].find('\n').unwrap() + 1;
+
+    let header = text[..motion_start].replace("Frames:\t455", &format!("Frames:\t{}", num_frames));
+    let mut out = header.into_bytes();
+    for line in text[motion_start..].lines().cycle().take(num_frames) {
+        out.extend_from_slice(line.as_bytes());
+        out.push(b'\n');
+    }
+    out
+}
+
+/// Returns `test_mocapbank.bvh` with its motion section repeated `times` times.
+pub fn repeat_motion(times: usize) -> Vec<u8> {
+    with_num_frames(455 * times)
+}
@@ -1,6 +1,12 @@
+mod common;
+
 use bvh_anim;
 use pretty_assertions::assert_eq;
-use std::{fs::File, io::BufReader};
+use std::{
+    error::Error,
+    fs::File,
+    io::{BufReader, Cursor},
+};
 
 #[test]
 fn load_success() {
@@ -11,6 +17,590 @@ fn load_success() {
     let _bvh = bvh_anim::from_reader(reader).unwrap();
 }
 
+#[test]
+fn load_from_path() {
+    let reader = File::open("./data/test_mocapbank.bvh")
+        .map(BufReader::new)
+        .unwrap();
+
+    let from_reader = bvh_anim::from_reader(reader).unwrap();
+    let from_path = bvh_anim::from_path("./data/test_mocapbank.bvh").unwrap();
+
+    assert_eq!(from_reader, from_path);
+}
+
+#[test]
+fn bytes_and_reader_agree() {
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_simple.bvh");
+
+    let inputs: &[&[u8]] = &[
+        BVH_BYTES,
+        &BVH_BYTES[..BVH_BYTES.len() / 2],
+        &BVH_BYTES[..BVH_BYTES.len() - 4],
+        b"HIERARCHY\r\nROOT Base\r\n{\r\nOFFSET 0.0 x 0.0\r\n",
+        b"",
+    ];
+
+    for input in inputs {
+        let from_bytes = bvh_anim::from_bytes(input);
+        let from_reader = bvh_anim::from_reader(Cursor::new(input));
+
+        match (from_bytes, from_reader) {
+            (Ok(b), Ok(r)) => assert_eq!(b, r),
+            (Err(b), Err(r)) => {
+                assert_eq!(b.line(), r.line());
+                assert_eq!(b.to_string(), r.to_string());
+            }
+            (b, r) => panic!("results differ: {:?} vs {:?}", b, r),
+        }
+    }
+}
+
+#[test]
+fn parallel_matches_sequential() {
+    let bvh = String::from_utf8(common::repeat_motion(4)).unwrap();
+    let three_quarters = bvh.len() * 3 / 4;
+    let line_start = three_quarters + bvh[three_quarters..].find('\n').unwrap() + 1;
+
+    let mut bad_value = bvh.clone();
+    bad_value.insert_str(line_start + 1, "x");
+    let mut blank_line = bvh.clone();
+    blank_line.insert_str(line_start, "\r\n");
+    let mut split_frame = bvh.clone();
+    let first_space = line_start + bvh[line_start..].find(' ').unwrap();
+    split_frame.replace_range(first_space..first_space + 1, "\n");
+    let mut missing_frame = bvh.clone();
+    missing_frame.truncate(bvh.trim_end().rfind('\n').unwrap());
+
+    let inputs = &[bvh, bad_value, blank_line, split_frame, missing_frame];
+
+    for input in inputs {
+        let sequential = bvh_anim::Bvh::from_bytes(input);
+        let parallel = bvh_anim::Bvh::from_bytes_parallel(input, 4);
+
+        match (sequential, parallel) {
+            (Ok(s), Ok(p)) => assert_eq!(s, p),
+            (Err(s), Err(p)) => {
+                assert_eq!(s.line(), p.line());
+                assert_eq!(s.to_string(), p.to_string());
+            }
+            (s, p) => panic!("results differ: {:?} vs {:?}", s, p),
+        }
+    }
+}
+
+#[test]
+fn motion_stream_matches_bvh() {
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    let bvh = bvh_anim::from_bytes(BVH_BYTES).unwrap();
+
+    let mut stream = bvh_anim::MotionStream::new(Cursor::new(BVH_BYTES)).unwrap();
+    assert_eq!(stream.num_channels(), bvh.num_channels());
+    assert_eq!(stream.num_frames(), bvh.frames().len());
+    assert_eq!(stream.frame_time(), bvh.frame_time());
+    assert!(stream
+        .joints()
+        .map(|j| j.name().to_vec())
+        .eq(bvh.joints().map(|j| j.name().to_vec())));
+
+    // 455 frames do not divide evenly into batches of 8.
+    let mut batch = vec![0.0; 8 * stream.num_channels()];
+    let mut streamed = vec![];
+    loop {
+        let num_frames = stream.read_frames(&mut batch).unwrap();
+        if num_frames == 0 {
+            break;
+        }
+        streamed.extend_from_slice(&batch[..num_frames * stream.num_channels()]);
+    }
+
+    let expected = bvh
+        .frames()
+        .flat_map(|f| f.as_slice().to_vec())
+        .collect::<Vec<_>>();
+    assert_eq!(streamed, expected);
+}
+
+#[test]
+fn motion_stream_checks_frame_count() {
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_simple.bvh");
+    // Drop the last motion value.
+    let truncated = &BVH_BYTES[..BVH_BYTES.len() - 5];
+
+    let mut stream = bvh_anim::MotionStream::new(Cursor::new(truncated)).unwrap();
+    let mut frame = vec![0.0; stream.num_channels()];
+    let result = (0..).try_for_each(|_| match stream.read_frame(&mut frame) {
+        Ok(true) => Ok(()),
+        Ok(false) => panic!("stream ended without an error"),
+        Err(e) => Err(e),
+    });
+
+    let expected = bvh_anim::from_bytes(truncated).unwrap_err();
+    assert_eq!(
+        result.unwrap_err().to_string(),
+        expected.source().unwrap().to_string()
+    );
+}
+
+#[test]
+fn header_ignores_motion_values() {
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    let bvh = bvh_anim::from_bytes(BVH_BYTES).unwrap();
+
+    let text = std::str::from_utf8(BVH_BYTES).unwrap();
+    let frame_time_line = text.find("Frame Time:").unwrap();
+    let motion_start = frame_time_line + text[frame_time_line..].find('\n').unwrap() + 1;
+    let bad_motion = format!("{}not a motion value\n", &text[..motion_start]);
+
+    for input in &[BVH_BYTES, bad_motion.as_bytes()] {
+        let header = bvh_anim::BvhHeader::from_bytes(input).unwrap();
+        assert_eq!(header.num_channels(), bvh.num_channels());
+        assert_eq!(header.num_frames(), bvh.frames().len());
+        assert_eq!(header.frame_time(), bvh.frame_time());
+        assert_eq!(header.joints().count(), bvh.joints().count());
+
+        let from_reader = bvh_anim::BvhHeader::from_reader(Cursor::new(input)).unwrap();
+        assert_eq!(header, from_reader);
+    }
+
+    let from_path = bvh_anim::BvhHeader::from_path("./data/test_mocapbank.bvh").unwrap();
+    assert_eq!(from_path.skeleton(), bvh.skeleton());
+    let mut without_frames = bvh.clone();
+    without_frames.extract_frames();
+    assert_eq!(from_path.into_bvh(), without_frames);
+}
+
+#[test]
+fn chunked_parser_matches_bvh() {
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    let crlf = String::from_utf8(BVH_BYTES.to_vec())
+        .unwrap()
+        .replace('\n', "\r\n");
+
+    for input in &[BVH_BYTES, crlf.as_bytes()] {
+        let bvh = bvh_anim::from_bytes(input).unwrap();
+        let motion_values = bvh.clone().extract_frames();
+
+        for &chunk_size in &[1, 7, 4096] {
+            let mut parser = bvh_anim::BvhParser::new();
+            for chunk in input.chunks(chunk_size) {
+                parser.feed(chunk).unwrap();
+            }
+            assert_eq!(parser.frames(), &motion_values[..]);
+            assert_eq!(parser.finish().unwrap(), bvh);
+
+            let mut parser = bvh_anim::BvhParser::new();
+            let mut frames = vec![];
+            for chunk in input.chunks(chunk_size) {
+                parser.feed(chunk).unwrap();
+                parser.take_frames(&mut frames);
+                assert_eq!(frames.len() % bvh.num_channels(), 0);
+            }
+            let skeleton = parser.finish().unwrap();
+            assert_eq!(skeleton.joints().count(), bvh.joints().count());
+            assert_eq!(frames, motion_values);
+        }
+    }
+
+    // Incomplete files give the same errors as loading them in one go.
+    let text = std::str::from_utf8(BVH_BYTES).unwrap();
+    for &end in &[
+        text.find("End Site").unwrap(),
+        text.find("MOTION").unwrap(),
+        text.find("Frame Time:").unwrap(),
+        BVH_BYTES.len() - 10,
+    ] {
+        let truncated = &BVH_BYTES[..end];
+        let expected = bvh_anim::from_bytes(truncated).unwrap_err();
+
+        let mut parser = bvh_anim::BvhParser::new();
+        let result = truncated
+            .chunks(7)
+            .try_for_each(|chunk| parser.feed(chunk))
+            .and_then(|_| parser.finish());
+        assert_eq!(result.unwrap_err().to_string(), expected.to_string());
+    }
+
+    // Using the parser after an error returns an error rather than panicking.
+    let corrupt = text.replacen("OFFSET", "OFFSET x", 1);
+    let mut parser = bvh_anim::BvhParser::new();
+    let first = parser.feed(corrupt.as_bytes()).unwrap_err();
+    assert!(first.line().is_some());
+    for later in vec![
+        parser.feed(b"\n").unwrap_err(),
+        parser.finish().unwrap_err(),
+    ] {
+        match later.into_kind() {
+            bvh_anim::errors::LoadErrorKind::ParserFailed { line } => {
+                assert_eq!(line, first.line())
+            }
+            kind => panic!("unexpected error: {:?}", kind),
+        }
+    }
+}
+
+#[test]
+fn pipelined_loader_matches_bvh() {
+    use bvh_anim::parse::PipelinedLoader;
+    use std::io::{self, Read};
+
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    let bvh = bvh_anim::from_bytes(BVH_BYTES).unwrap();
+
+    for &(block_size, num_blocks) in &[(1, 2), (100, 3), (1 << 20, 2)] {
+        let loader = PipelinedLoader::new()
+            .with_block_size(block_size)
+            .with_num_blocks(num_blocks);
+        let (loaded, stats) = loader.load(BVH_BYTES).unwrap();
+        assert_eq!(loaded, bvh);
+        assert_eq!(stats.bytes_read, BVH_BYTES.len());
+        assert_eq!(
+            stats.num_blocks,
+            (BVH_BYTES.len() + block_size - 1) / block_size
+        );
+    }
+
+    let (from_path, _) = PipelinedLoader::new()
+        .load_path("./data/test_mocapbank.bvh")
+        .unwrap();
+    assert_eq!(from_path, bvh);
+
+    // A reader which fails part of the way through the motion section.
+    struct FailingReader(&'static [u8]);
+    impl Read for FailingReader {
+        fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+            match self.0.read(buf)? {
+                0 => Err(io::Error::new(io::ErrorKind::Other, "disconnected")),
+                n => Ok(n),
+            }
+        }
+    }
+
+    let err = PipelinedLoader::new()
+        .with_block_size(1024)
+        .load(FailingReader(&BVH_BYTES[..BVH_BYTES.len() / 2]))
+        .unwrap_err();
+    match err.into_kind() {
+        bvh_anim::errors::LoadErrorKind::Motion(bvh_anim::errors::LoadMotionError::Io(_)) => {}
+        kind => panic!("unexpected error: {:?}", kind),
+    }
+
+    let limited = PipelinedLoader::new()
+        .with_max_motion_bytes(100 * 60 * 4)
+        .load(BVH_BYTES);
+    match limited.unwrap_err().into_kind() {
+        bvh_anim::errors::LoadErrorKind::Motion(
+            bvh_anim::errors::LoadMotionError::MotionLimitExceeded { .. },
+        ) => {}
+        kind => panic!("unexpected error: {:?}", kind),
+    }
+}
+
+#[test]
+fn huge_frame_count_is_not_trusted() {
+    use bvh_anim::{
+        errors::{LoadErrorKind, LoadMotionError},
+        parse::ParseOptions,
+        BvhParser,
+    };
+
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    let text = std::str::from_utf8(BVH_BYTES).unwrap();
+
+    for frames in &["999999999999", "18446744073709551615"] {
+        let corrupt = text.replace("Frames:\t455", &format!("Frames:\t{}", frames));
+
+        let results = vec![
+            bvh_anim::from_bytes(corrupt.as_bytes()),
+            bvh_anim::from_reader(Cursor::new(corrupt.as_bytes())),
+            ParseOptions::new().parse_bytes(corrupt.as_bytes()),
+        ];
+        for result in results {
+            match result.unwrap_err().into_kind() {
+                LoadErrorKind::Motion(LoadMotionError::MotionCountMismatch {
+                    actual_total_motion_values,
+                    ..
+                }) => assert_eq!(actual_total_motion_values, 455 * 60),
+                kind => panic!("unexpected error: {:?}", kind),
+            }
+        }
+
+        let limit = 100 * 60 * 4;
+        let limited = ParseOptions::new()
+            .with_max_motion_bytes(limit)
+            .parse_bytes(corrupt.as_bytes());
+        let mut parser = BvhParser::new().with_max_motion_bytes(limit);
+        let fed = parser
+            .feed(corrupt.as_bytes())
+            .map(|_| parser.header().cloned());
+
+        for result in vec![limited.map(|_| ()), fed.map(|_| ())] {
+            match result.unwrap_err().into_kind() {
+                LoadErrorKind::Motion(LoadMotionError::MotionLimitExceeded { limit: l, line }) => {
+                    assert_eq!(l, limit);
+                    assert!(line > 100);
+                }
+                kind => panic!("unexpected error: {:?}", kind),
+            }
+        }
+    }
+
+    // A limit which the clip fits within does not change the result.
+    let bvh = ParseOptions::new()
+        .with_max_motion_bytes(455 * 60 * 4)
+        .parse_bytes(BVH_BYTES)
+        .unwrap();
+    assert_eq!(bvh, bvh_anim::from_bytes(BVH_BYTES).unwrap());
+
+    let mut parser = BvhParser::new().with_max_motion_bytes(455 * 60 * 4);
+    parser.feed(BVH_BYTES).unwrap();
+    assert_eq!(parser.finish().unwrap(), bvh);
+}
+
+#[test]
+fn parser_limits_long_lines() {
+    use bvh_anim::{
+        errors::{LoadErrorKind, LoadJointsError, LoadMotionError},
+        BvhParser,
+    };
+
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    let text = std::str::from_utf8(BVH_BYTES).unwrap();
+    let motion_start = text.find("Frame Time:").unwrap();
+    let motion_start = motion_start + text[motion_start..].find('\n').unwrap() + 1;
+    let limit = 1024;
+
+    // A line which never ends is rejected once it is longer than the limit.
+    let mut parser = BvhParser::new().with_max_motion_bytes(limit);
+    parser.feed(&BVH_BYTES[..motion_start]).unwrap();
+    let mut result = Ok(());
+    for _ in 0..limit {
+        result = parser.feed(b"1.0 ");
+        if result.is_err() {
+            break;
+        }
+    }
+    match result.unwrap_err().into_kind() {
+        LoadErrorKind::Motion(LoadMotionError::MotionLimitExceeded { limit: l, .. }) => {
+            assert_eq!(l, limit)
+        }
+        kind => panic!("unexpected error: {:?}", kind),
+    }
+
+    // A single complete row is checked before its values are stored.
+    let mut parser = BvhParser::new().with_max_motion_bytes(limit);
+    parser.feed(&BVH_BYTES[..motion_start]).unwrap();
+    let row = "1 ".repeat(limit / 2);
+    assert!(parser.feed(format!("{}\n", row).as_bytes()).is_err());
+    assert!(parser.frames().len() * 4 <= limit);
+
+    // A long line in the hierarchy is not blamed on the motion values.
+    let mut parser = BvhParser::new().with_max_motion_bytes(limit);
+    let name = "Joint".repeat(limit);
+    let long_name = text.replacen("JOINT ", &format!("JOINT {}", name), 1);
+    let error = long_name
+        .as_bytes()
+        .chunks(64)
+        .map(|chunk| parser.feed(chunk))
+        .find_map(Result::err)
+        .unwrap();
+    match error.into_kind() {
+        LoadErrorKind::Joints(LoadJointsError::LineTooLong { limit: l, line }) => {
+            assert_eq!(l, limit);
+            assert!(line < text[..motion_start].lines().count());
+        }
+        kind => panic!("unexpected error: {:?}", kind),
+    }
+}
+
+#[test]
+fn load_many_loads_largest_first() {
+    use bvh_anim::{
+        errors::{LoadErrorKind, LoadJointsError},
+        parse::BatchLoader,
+    };
+    use std::path::PathBuf;
+
+    let paths = vec![
+        "./data/test_simple.bvh",
+        "./data/does_not_exist.bvh",
+        "./data/test_mocapbank.bvh",
+    ];
+
+    for &reuse_buffers in &[true, false] {
+        // With a single thread, the completion order is the order of the queue.
+        let results = BatchLoader::new()
+            .with_num_threads(1)
+            .with_reuse_buffers(reuse_buffers)
+            .load_many(paths.clone())
+            .collect::<Vec<_>>();
+
+        let order = results.iter().map(|(p, _)| p.clone()).collect::<Vec<_>>();
+        assert_eq!(
+            order,
+            vec![
+                PathBuf::from("./data/test_mocapbank.bvh"),
+                PathBuf::from("./data/test_simple.bvh"),
+                PathBuf::from("./data/does_not_exist.bvh"),
+            ]
+        );
+
+        for (path, result) in results {
+            if path.ends_with("does_not_exist.bvh") {
+                match result.unwrap_err().into_kind() {
+                    LoadErrorKind::Joints(LoadJointsError::Io(_)) => {}
+                    kind => panic!("unexpected error: {:?}", kind),
+                }
+            } else {
+                assert_eq!(result.unwrap(), bvh_anim::from_path(&path).unwrap());
+            }
+        }
+    }
+
+    let mut loaded = bvh_anim::load_many(paths.iter().cycle().take(30))
+        .map(|(path, result)| (path, result.is_ok()))
+        .collect::<Vec<_>>();
+    loaded.sort();
+    assert_eq!(loaded.len(), 30);
+    assert_eq!(loaded.iter().filter(|&&(_, ok)| ok).count(), 20);
+}
+
+#[test]
+fn malformed_hierarchies_are_errors() {
+    use bvh_anim::{
+        errors::{LoadErrorKind, LoadJointsError},
+        parse::BatchLoader,
+    };
+    use std::path::PathBuf;
+
+    const BVH_STRING: &str = include_str!("../data/test_simple.bvh");
+    let malformed = vec![
+        BVH_STRING.replacen("HIERARCHY", "HIERARCHY\nHIERARCHY", 1),
+        BVH_STRING.replacen("ROOT Base", "ROOT", 1),
+        BVH_STRING.replacen("JOINT End", "JOINT", 1),
+        BVH_STRING.replacen("End Site", "End", 1),
+        BVH_STRING.replacen("{", "JOINT Early\n{", 1),
+        BVH_STRING.replacen("HIERARCHY", "HIERARCHY\n}", 1),
+        BVH_STRING.replacen("ROOT Base", "JOINT Base", 1),
+    ];
+
+    for text in &malformed {
+        match bvh_anim::from_str(text).unwrap_err().into_kind() {
+            LoadErrorKind::Joints(LoadJointsError::UnexpectedLine { .. })
+            | LoadErrorKind::Joints(LoadJointsError::MissingJointName { .. }) => {}
+            kind => panic!("unexpected error: {:?}", kind),
+        }
+    }
+
+    // Every file still gets its own result when loading in a batch.
+    let dir = std::env::temp_dir().join(format!("bvh_anim_malformed_{}", std::process::id()));
+    std::fs::create_dir_all(&dir).unwrap();
+    let mut paths = vec![PathBuf::from("./data/test_simple.bvh")];
+    for (i, text) in malformed.iter().enumerate() {
+        let path = dir.join(format!("{}.bvh", i));
+        std::fs::write(&path, text).unwrap();
+        paths.push(path);
+    }
+
+    let results = BatchLoader::new()
+        .with_num_threads(2)
+        .load_many(paths)
+        .collect::<Vec<_>>();
+    assert_eq!(results.len(), malformed.len() + 1);
+    assert_eq!(results.iter().filter(|(_, r)| r.is_ok()).count(), 1);
+    std::fs::remove_dir_all(&dir).unwrap();
+}
+
+#[test]
+fn load_many_shares_skeletons() {
+    use bvh_anim::parse::BatchLoader;
+    use std::sync::Arc;
+
+    let paths = vec![
+        "./data/test_mocapbank.bvh",
+        "./data/test_simple.bvh",
+        "./data/test_mocapbank.bvh",
+        "./data/test_simple.bvh",
+    ];
+
+    for &dedupe_skeletons in &[true, false] {
+        let mut clips = BatchLoader::new()
+            .with_num_threads(2)
+            .with_dedupe_skeletons(dedupe_skeletons)
+            .load_many(paths.clone())
+            .map(|(path, result)| (path, result.unwrap()))
+            .collect::<Vec<_>>();
+        clips.sort_by(|a, b| a.0.cmp(&b.0));
+
+        for pair in clips.chunks(2) {
+            assert_eq!(pair[0].1, pair[1].1);
+            assert_eq!(
+                Arc::ptr_eq(pair[0].1.skeleton(), pair[1].1.skeleton()),
+                dedupe_skeletons
+            );
+        }
+        assert!(!Arc::ptr_eq(clips[0].1.skeleton(), clips[2].1.skeleton()));
+    }
+}
+
+#[test]
+fn parse_options_select_subset() {
+    use bvh_anim::{parse::ParseOptions, ChannelType};
+
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    let bvh = bvh_anim::from_bytes(BVH_BYTES).unwrap();
+
+    let all = ParseOptions::new().parse_bytes(BVH_BYTES).unwrap();
+    assert_eq!(all, bvh);
+
+    let options = ParseOptions::new()
+        .with_frames(10..100)
+        .with_frame_stride(4)
+        .with_joints(&["Hips", "Chest"])
+        .with_channel_types(vec![ChannelType::RotationX, ChannelType::RotationY]);
+    let subset = options.parse(Cursor::new(BVH_BYTES)).unwrap();
+    assert_eq!(subset, options.parse_bytes(BVH_BYTES).unwrap());
+
+    let selected = bvh
+        .joints()
+        .filter(|j| j.name() == b"Hips" || j.name() == b"Chest")
+        .flat_map(|j| j.channels().to_vec())
+        .filter(|c| {
+            options
+                .channel_types
+                .as_ref()
+                .unwrap()
+                .contains(&c.channel_type())
+        })
+        .collect::<Vec<_>>();
+    assert_eq!(subset.num_channels(), selected.len());
+    assert_eq!(subset.joints().count(), bvh.joints().count());
+
+    let motion_indices = subset
+        .joints()
+        .flat_map(|j| {
+            j.channels()
+                .iter()
+                .map(|c| c.motion_index())
+                .collect::<Vec<_>>()
+        })
+        .collect::<Vec<_>>();
+    assert_eq!(motion_indices, (0..selected.len()).collect::<Vec<_>>());
+
+    let expected_frames = bvh
+        .frames()
+        .skip(10)
+        .take(90)
+        .step_by(4)
+        .map(|f| selected.iter().map(|c| f[c]).collect::<Vec<_>>())
+        .collect::<Vec<_>>();
+    let subset_frames = subset
+        .frames()
+        .map(|f| f.as_slice().to_vec())
+        .collect::<Vec<_>>();
+    assert_eq!(subset_frames, expected_frames);
+}
+
 #[test]
 fn string_parse_small() {
     const BVH_BYTES: &[u8] = include_bytes!("../data/test_simple.bvh");
@@ -0,0 +1,108 @@
+//! These tests are in their own file because they install a counting global
+//! allocator. Allocations are counted per thread, so that the tests in this file
+//! do not see each other's allocations.
+
+mod common;
+
+use bvh_anim;
+use std::{
+    alloc::{GlobalAlloc, Layout, System},
+    cell::Cell,
+    io::{BufReader, Cursor},
+};
+
+struct CountingAllocator;
+
+thread_local! {
+    static NUM_ALLOCATIONS: Cell<usize> = const { Cell::new(0) };
+}
+
+fn count_allocation() {
+    let _ = NUM_ALLOCATIONS.try_with(|n| n.set(n.get() + 1));
+}
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        count_allocation();
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        count_allocation();
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAllocator = CountingAllocator;
+
+fn count_allocations<F: FnOnce()>(f: F) -> usize {
+    let before = NUM_ALLOCATIONS.with(Cell::get);
+    f();
+    NUM_ALLOCATIONS.with(Cell::get) - before
+}
+
+#[test]
+fn parse_allocations_do_not_scale_with_lines() {
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    let long_bvh_bytes = common::repeat_motion(10);
+
+    let short_from_bytes = count_allocations(|| {
+        bvh_anim::from_bytes(BVH_BYTES).unwrap();
+    });
+    let long_from_bytes = count_allocations(|| {
+        let bvh = bvh_anim::from_bytes(&long_bvh_bytes[..]).unwrap();
+        assert_eq!(bvh.frames().len(), 4550);
+    });
+
+    let short_from_reader = count_allocations(|| {
+        bvh_anim::from_reader(Cursor::new(BVH_BYTES)).unwrap();
+    });
+    let long_from_reader = count_allocations(|| {
+        bvh_anim::from_reader(BufReader::new(Cursor::new(&long_bvh_bytes[..]))).unwrap();
+    });
+
+    // The only allocations are the growth of the `joints` vector, the single
+    // reservation for the motion values, and (for readers) the line buffer.
+    // Readers do not know the size of their input, so only reserve a limited
+    // number of motion values up front, which then grow geometrically.
+    assert_eq!(short_from_bytes, long_from_bytes);
+    assert!(short_from_bytes < 16, "{} allocations", short_from_bytes);
+    assert!(
+        long_from_reader <= short_from_reader + 6,
+        "{} allocations vs {} allocations",
+        long_from_reader,
+        short_from_reader,
+    );
+    assert!(long_from_reader < 32, "{} allocations", long_from_reader);
+}
+
+#[test]
+fn reparse_reuses_allocations() {
+    const BVH_BYTES: &[u8] = include_bytes!("../data/test_mocapbank.bvh");
+    let long_bvh_bytes = common::repeat_motion(2);
+
+    let mut bvh = bvh_anim::Bvh::new();
+    bvh.parse_from_bytes(&long_bvh_bytes[..]).unwrap();
+
+    let reparse_bytes = count_allocations(|| {
+        bvh.parse_from_bytes(BVH_BYTES).unwrap();
+    });
+    assert_eq!(bvh, bvh_anim::from_bytes(BVH_BYTES).unwrap());
+
+    // Only the small tables used while parsing the hierarchy are allocated when
+    // parsing bytes, and readers also grow their line buffer.
+    assert!(reparse_bytes <= 4, "{} allocations", reparse_bytes);
+
+    let reparse_reader = count_allocations(|| {
+        bvh.parse_from(Cursor::new(BVH_BYTES)).unwrap();
+    });
+    assert!(reparse_reader <= 12, "{} allocations", reparse_reader);
+
+    assert!(bvh.parse_from_bytes(&BVH_BYTES[..100]).is_err());
+    assert_eq!(bvh, bvh_anim::Bvh::new());
+}
@@ -55,3 +55,41 @@ fn test_load_write_is_identical() {
 
     assert_eq!(bvh_string, BVH_STRING);
 }
+
+#[test]
+fn test_write_clip_view() {
+    const BVH_STRING: &str = include_str!("../data/test_mocapbank.bvh");
+    let bvh = bvh_anim::from_str(BVH_STRING).unwrap();
+    let view = bvh.slice_frames(20..120).with_stride(5);
+    let options = WriteOptions::new().with_indent(IndentStyle::with_spaces(2));
+
+    let mut written = Vec::new();
+    options.write(view, &mut written).unwrap();
+    assert_eq!(written, options.write_to_string(&view.to_bvh()));
+
+    let reloaded = bvh_anim::from_bytes(&written).unwrap();
+    assert_eq!(reloaded.frames().len(), 20);
+    assert_eq!(*reloaded.frame_time(), *bvh.frame_time() * 5);
+    assert_eq!(reloaded.skeleton(), bvh.skeleton());
+    for (written, original) in reloaded.frames().zip(bvh.frames().skip(20).step_by(5)) {
+        for (&a, &b) in written.as_slice().iter().zip(original.as_slice()) {
+            assert!((a - b).abs() <= 1e-4 * b.abs().max(1.0));
+        }
+    }
+}
+
+#[test]
+fn test_write_header_and_frames() {
+    const BVH_STRING: &str = include_str!("../data/test_mocapbank.bvh");
+    let bvh = bvh_anim::from_str(BVH_STRING).unwrap();
+    let options = WriteOptions::new().with_motion_values_significant_figures(3);
+
+    let mut written = Vec::new();
+    options
+        .write_header(&bvh, bvh.frames().len(), &mut written)
+        .unwrap();
+    for frame in bvh.frames() {
+        options.write_frame(frame.as_slice(), &mut written).unwrap();
+    }
+    assert_eq!(written, options.write_to_string(&bvh));
+}